@@ -0,0 +1,48 @@
+#!/bin/bash
+#
+# bench-crawl.sh - measures the crawler's throughput against siteserver
+#
+# Starts siteserver on this machine, crawls its whole site with the
+# crawler pointed at it (--connect-to, no politeness delay, no
+# checkpoints), and prints the crawler's --stats: pages/sec, bytes/sec,
+# and percentiles of the time each fetch took.
+#
+# Settings come from the environment (`make bench-crawl` passes them on):
+#   PORT (8090), PAGES (1000), FANOUT (8), PAGEBYTES (4096),
+#   LATENCY (10, milliseconds per response), ERRORS (0, percent of pages
+#   answering 500), CRAWLFLAGS ("-e 32", crawler options to measure)
+#
+# Hugo Fang, 3/3/2024
+
+PORT=${PORT:-8090}
+PAGES=${PAGES:-1000}
+FANOUT=${FANOUT:-8}
+PAGEBYTES=${PAGEBYTES:-4096}
+LATENCY=${LATENCY:-10}
+ERRORS=${ERRORS:-0}
+CRAWLFLAGS=${CRAWLFLAGS--e 32}
+
+crawler=../crawler/crawler
+seed=http://cs50tse.cs.dartmouth.edu/tse/bench/index.html
+
+./siteserver -p "$PORT" -n "$PAGES" -f "$FANOUT" -s "$PAGEBYTES" \
+             -l "$LATENCY" -e "$ERRORS" &
+server=$!
+pageDir=$(mktemp -d)
+trap 'kill $server 2>/dev/null; rm -rf "$pageDir"' EXIT
+
+# wait for the server to be listening
+for try in $(seq 50); do
+  (exec 3<>/dev/tcp/127.0.0.1/"$PORT") 2>/dev/null && break
+  sleep 0.1
+done
+
+echo "site: $PAGES pages, fanout $FANOUT, $PAGEBYTES bytes," \
+     "${LATENCY}ms latency, $ERRORS% errors"
+echo "crawler flags: $CRAWLFLAGS"
+# deep enough to reach every page of the tree
+$crawler -d 0 -c 0 --connect-to 127.0.0.1:"$PORT" --stats $CRAWLFLAGS \
+         "$seed" "$pageDir" 1000000
+status=$?
+echo "pages saved: $(ls "$pageDir" | grep -c '^[0-9]*$')"
+exit $status
@@ -0,0 +1,396 @@
+/*
+ * siteserver.c    Hugo Fang    3/3/2024
+ *
+ * A small HTTP server that makes up a website as it is asked for pages,
+ * for measuring the crawler without a real server (or its politeness
+ * delay) in the way. The site lives under /tse/bench/: index.html is
+ * page 0, and N.html is page N, for N from 1 to numPages - 1. Every page
+ * links to the next `fanout` pages after it in a tree (page N to pages
+ * N*fanout + 1 through N*fanout + fanout, wrapping around), so each page
+ * is reachable from the index, plus one external link; the rest of the
+ * page is words, padding it to about pageBytes.
+ *
+ * Each response is sent latencyMillis after its request arrives, on a
+ * thread of its own per connection, so slow responses overlap as they
+ * would from a real server. errorPercent percent of the pages (other
+ * than the index, and the same ones every run) answer 500 instead.
+ * Connections are kept alive unless the client asks otherwise.
+ *
+ * Usage: siteserver [-p port] [-n numPages] [-f fanout] [-s pageBytes]
+ *                   [-l latencyMillis] [-e errorPercent]
+ *
+ * Defaults: port 8090, 1000 pages, fanout 8, 4096 bytes, no latency,
+ * no errors. Runs until killed.
+ *
+ * Exits with:
+ *   errno 1 if error parsing arguments
+ *   errno 2 if the port can't be listened on
+ */
+
+#define _POSIX_C_SOURCE 200809L   // nanosleep, strtok_r
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/* Local types */
+/*
+ * Options read from the command line; see parseArgs()
+ */
+typedef struct siteOptions {
+  int port;
+  int numPages;
+  int fanout;
+  int pageBytes;
+  int latencyMillis;
+  int errorPercent;
+} siteOptions_t;
+
+/* Local constants */
+static const int REQUEST_MAX = 16384;   // bytes of request headers accepted
+static const char* WORDS[] = {
+  "search", "engine", "crawler", "index", "query", "page", "link", "word",
+  "tiny", "web", "server", "client", "socket", "thread", "queue", "depth",
+  "frontier", "document", "score", "rank", "hash", "table", "counter",
+  "alpha", "beta", "gamma", "delta", "epsilon", "dartmouth", "hanover",
+};
+static const int NUM_WORDS = sizeof(WORDS) / sizeof(WORDS[0]);
+
+/* Global variables */
+static siteOptions_t opts;      // set once, before any thread starts
+
+/* Private functions */
+static void parseArgs(const int argc, char* argv[]);
+static bool str2int(const char* string, int* num_p);
+static void* serveConnection(void* arg);
+static bool respond(const int fd, const char* request, bool* keepAlive);
+static char* makePage(const int pageNum, size_t* len);
+static int pageNumber(const char* path);
+static bool isError(const int pageNum);
+static bool sendAll(const int fd, const char* buf, size_t len);
+static uint32_t mix(uint32_t x);
+
+int main(const int argc, char* argv[])
+{
+  parseArgs(argc, argv);
+  signal(SIGPIPE, SIG_IGN);
+
+  int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(opts.port);
+  if (listenFd < 0
+      || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+      || bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0
+      || listen(listenFd, 128) != 0) {
+    fprintf(stderr, "siteserver: can't listen on port %d: %s\n", opts.port,
+            strerror(errno));
+    exit(2);
+  }
+  fprintf(stderr, "siteserver: serving %d pages on port %d\n",
+          opts.numPages, opts.port);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  while (true) {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    int* arg = malloc(sizeof(int));
+    pthread_t thread;
+    if (arg == NULL) {
+      close(fd);
+      continue;
+    }
+    *arg = fd;
+    if (pthread_create(&thread, &attr, serveConnection, arg) != 0) {
+      close(fd);
+      free(arg);
+    }
+  }
+  return 0;
+}
+
+/*
+ * reads the options (see the usage above) into opts; prints an error to
+ * stderr and exits 1 on an invalid one
+ */
+static void parseArgs(const int argc, char* argv[])
+{
+  opts = (siteOptions_t) {
+    .port = 8090,
+    .numPages = 1000,
+    .fanout = 8,
+    .pageBytes = 4096,
+    .latencyMillis = 0,
+    .errorPercent = 0,
+  };
+  for (int arg = 1; arg < argc; arg += 2) {
+    int* value = NULL;
+    int min = 0, max = 0;
+    if (strcmp(argv[arg], "-p") == 0) {
+      value = &opts.port, min = 1, max = 65535;
+    } else if (strcmp(argv[arg], "-n") == 0) {
+      value = &opts.numPages, min = 1, max = 100000000;
+    } else if (strcmp(argv[arg], "-f") == 0) {
+      value = &opts.fanout, min = 0, max = 1000;
+    } else if (strcmp(argv[arg], "-s") == 0) {
+      value = &opts.pageBytes, min = 0, max = 64 * 1024 * 1024;
+    } else if (strcmp(argv[arg], "-l") == 0) {
+      value = &opts.latencyMillis, min = 0, max = 60000;
+    } else if (strcmp(argv[arg], "-e") == 0) {
+      value = &opts.errorPercent, min = 0, max = 100;
+    }
+    if (value == NULL || arg + 1 >= argc || !str2int(argv[arg + 1], value)
+        || *value < min || *value > max) {
+      fprintf(stderr, "Usage: %s [-p port] [-n numPages] [-f fanout] "
+              "[-s pageBytes] [-l latencyMillis] [-e errorPercent]\n",
+              argv[0]);
+      exit(1);
+    }
+  }
+}
+
+/*
+ * converts string to integer and stores in num_p
+ * 
+ * Returns false if string is NULL or empty, fails to convert, or has
+ * extra characters at the end
+ */
+static bool str2int(const char* string, int* num_p)
+{
+  char extra;
+  return string != NULL && sscanf(string, "%d%c", num_p, &extra) == 1;
+}
+
+/*
+ * Body of each connection's thread: answers requests on the connection,
+ * in turn, until the client closes it or asks for it to be closed
+ * 
+ * Input:
+ *   arg: malloc'd int holding the connection's socket, freed here
+ */
+static void* serveConnection(void* arg)
+{
+  int fd = *(int*)arg;
+  free(arg);
+  char* buf = malloc(REQUEST_MAX + 1);
+  size_t filled = 0;
+  bool keepAlive = buf != NULL;
+  while (keepAlive) {
+    // a request ends at the first blank line; bodies are not expected
+    char* end;
+    buf[filled] = '\0';
+    while ((end = strstr(buf, "\r\n\r\n")) == NULL) {
+      ssize_t got = filled < (size_t)REQUEST_MAX
+                    ? read(fd, buf + filled, REQUEST_MAX - filled) : 0;
+      if (got <= 0) {
+        keepAlive = false;
+        break;
+      }
+      filled += got;
+      buf[filled] = '\0';
+    }
+    if (end == NULL) {
+      break;
+    }
+    *end = '\0';
+    end += 4;
+    if (!respond(fd, buf, &keepAlive)) {
+      break;
+    }
+    // keep any request sent behind this one
+    filled -= end - buf;
+    memmove(buf, end, filled);
+  }
+  free(buf);
+  close(fd);
+  return NULL;
+}
+
+/*
+ * Answers one request, after the configured latency
+ * 
+ * Inputs:
+ *   fd: the connection
+ *   request: the request line and headers, without the blank line
+ *   keepAlive: set to false if the client asked to close the connection
+ * 
+ * Returns:
+ *   false if the response could not be sent
+ */
+static bool respond(const int fd, const char* request, bool* keepAlive)
+{
+  char method[16], path[1024], version[16];
+  if (sscanf(request, "%15s %1023s %15s", method, path, version) != 3) {
+    *keepAlive = false;
+    const char* bad = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n"
+                      "Connection: close\r\n\r\n";
+    return sendAll(fd, bad, strlen(bad));
+  }
+  *keepAlive = strcmp(version, "HTTP/1.0") != 0;
+  for (const char* line = strstr(request, "\r\n"); line != NULL;
+       line = strstr(line + 2, "\r\n")) {
+    if (strncasecmp(line + 2, "Connection:", 11) == 0) {
+      const char* value = line + 13;
+      while (*value == ' ') {
+        value++;
+      }
+      *keepAlive = strncasecmp(value, "close", 5) != 0;
+    }
+  }
+
+  if (opts.latencyMillis > 0) {
+    struct timespec delay = { opts.latencyMillis / 1000,
+                              (opts.latencyMillis % 1000) * 1000000L };
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+  }
+
+  int pageNum = pageNumber(path);
+  int status = 200;
+  const char* reason = "OK";
+  char* body = NULL;
+  size_t bodyLen = 0;
+  if (strcmp(method, "GET") != 0) {
+    status = 405, reason = "Method Not Allowed";
+  } else if (pageNum < 0) {
+    status = 404, reason = "Not Found";
+  } else if (isError(pageNum)) {
+    status = 500, reason = "Internal Server Error";
+  } else if ((body = makePage(pageNum, &bodyLen)) == NULL) {
+    status = 503, reason = "Service Unavailable";
+  }
+
+  char header[256];
+  int headerLen = snprintf(header, sizeof(header),
+                           "HTTP/1.1 %d %s\r\n"
+                           "Content-Type: text/html\r\n"
+                           "Content-Length: %zu\r\n"
+                           "%s\r\n",
+                           status, reason, bodyLen,
+                           *keepAlive ? "" : "Connection: close\r\n");
+  bool sent = sendAll(fd, header, headerLen) && sendAll(fd, body, bodyLen);
+  free(body);
+  return sent;
+}
+
+/*
+ * Makes up page pageNum
+ * 
+ * Returns the html, setting *len to its length, or NULL on memory
+ * allocation failure; caller needs to free() it
+ */
+static char* makePage(const int pageNum, size_t* len)
+{
+  // room for the links and the tags around them, then the words
+  size_t size = opts.pageBytes + 64 * (opts.fanout + 4) + 32;
+  char* html = malloc(size);
+  if (html == NULL) {
+    return NULL;
+  }
+  size_t used = snprintf(html, size, "<html><head><title>page %d</title>"
+                         "</head><body>\n", pageNum);
+  for (int i = 1; i <= opts.fanout; i++) {
+    long target = ((long)pageNum * opts.fanout + i) % opts.numPages;
+    if (target == 0) {
+      used += snprintf(html + used, size - used,
+                       "<a href=\"index.html\">page 0</a>\n");
+    } else {
+      used += snprintf(html + used, size - used,
+                       "<a href=\"%ld.html\">page %ld</a>\n", target, target);
+    }
+  }
+  used += snprintf(html + used, size - used,
+                   "<a href=\"http://www.example.com/\">elsewhere</a>\n<p>");
+
+  // the same words for the same page on every request
+  uint32_t state = mix(pageNum + 1);
+  size_t tail = strlen("</p></body></html>\n");
+  while (used + tail < (size_t)opts.pageBytes && used + tail + 16 < size) {
+    state = mix(state);
+    const char* word = WORDS[state % NUM_WORDS];
+    used += snprintf(html + used, size - used, "%s ", word);
+  }
+  used += snprintf(html + used, size - used, "</p></body></html>\n");
+  *len = used;
+  return html;
+}
+
+/*
+ * Returns the page number a path names, or -1 if it names none
+ */
+static int pageNumber(const char* path)
+{
+  const char* prefix = "/tse/bench/";
+  size_t prefixLen = strlen(prefix);
+  if (strncmp(path, prefix, prefixLen) != 0) {
+    return -1;
+  }
+  const char* name = path + prefixLen;
+  if (*name == '\0' || strcmp(name, "index.html") == 0) {
+    return 0;
+  }
+  int pageNum, used;
+  if (sscanf(name, "%d.html%n", &pageNum, &used) != 1
+      || name[used] != '\0' || pageNum < 1 || pageNum >= opts.numPages) {
+    return -1;
+  }
+  return pageNum;
+}
+
+/*
+ * Returns true if page pageNum is one that answers with an error
+ */
+static bool isError(const int pageNum)
+{
+  return pageNum > 0 && (int)(mix(pageNum) % 100) < opts.errorPercent;
+}
+
+/*
+ * Writes all len bytes of buf to fd; returns false on error
+ */
+static bool sendAll(const int fd, const char* buf, size_t len)
+{
+  while (len > 0) {
+    ssize_t sent = write(fd, buf, len);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    buf += sent;
+    len -= sent;
+  }
+  return true;
+}
+
+/*
+ * Scrambles x (a 32-bit finalizer); used both to pick each page's words
+ * and to pick the pages that answer with errors
+ */
+static uint32_t mix(uint32_t x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352dU;
+  x ^= x >> 15;
+  x *= 0x846ca68bU;
+  x ^= x >> 16;
+  return x;
+}
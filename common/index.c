@@ -14,6 +14,7 @@
 #include "hashtable.h"
 #include "counters.h"
 #include "file.h"
+#include "webpage.h"
 
 // common.a
 #include "word.h"
@@ -24,6 +25,16 @@ typedef struct index {
   hashtable_t* ht;
 } index_t;
 
+/* Local types */
+// passes the index to merge into, and the word, to mergeCounterEntry()
+typedef struct mergeArg {
+  index_t* idx;
+  const char* word;
+} mergeArg_t;
+
+/* Local constants */
+static const int PAGE_SLOTS = 200;  // slots for the words of one page
+
 
 /* Private function prototypes */
 static void counterDelete(void *item);
@@ -31,7 +42,11 @@ static bool str2int(const char* string, int* num_p);
 static void index_setWordDocCount(index_t* idx, const char* word,
                                 const int docID, const int count);
 static index_t* index_newWithNumSlots(const int numSlots);
+static void removeDocEntry(void* arg, const char* key, void* item);
 static void saveHashtableEntry(void* arg, const char* key, void* item);
+static void countNonzero(void* arg, const int key, const int count);
+static void mergeHashtableEntry(void* arg, const char* key, void* item);
+static void mergeCounterEntry(void* arg, const int key, const int count);
 static void saveCounterEntry(void* arg, const int key, const int item);
 
 /* Getters */
@@ -90,6 +105,95 @@ void index_addWord(index_t* idx, char* word, const int docID)
   counters_add(counter, docID); // `word` appeared in docID once more
 }
 
+void index_merge(index_t* idx, const index_t* other)
+{
+  if (idx == NULL || other == NULL) {
+    return;
+  }
+  mergeArg_t arg = { idx, NULL };
+  hashtable_iterate(other->ht, &arg, mergeHashtableEntry);
+}
+
+void index_addPage(index_t* idx, const webpage_t* page, const int docID)
+{
+  if (idx == NULL || page == NULL || docID <= 0) {
+    return;
+  }
+  // count the page's words on their own first: a word's counter in idx
+  // may hold many pages, so is then updated once, not once per occurence
+  index_t* pageIdx = index_newWithNumSlots(PAGE_SLOTS);
+  if (pageIdx == NULL) {
+    return;
+  }
+  char* word;
+  int pos = 0;
+  // webpage_getNextWord() only reads the page
+  while ((word = webpage_getNextWord((webpage_t*)page, &pos)) != NULL) {
+    index_addWord(pageIdx, word, docID);
+    free(word);
+  }
+  index_merge(idx, pageIdx);
+  index_delete(pageIdx);
+}
+
+/*
+ * Internal function to merge the counters in one hashtable entry
+ *
+ * Inputs:
+ *   arg: index_merge() will pass in the mergeArg_t* naming the index
+ *   key: the word saved as a key in the hashtable
+ *   item: the counter saved as an item in the hashtable
+ */
+void mergeHashtableEntry(void* arg, const char* key, void* item)
+{
+  mergeArg_t* merge = arg;
+  merge->word = key;
+  counters_iterate(item, merge, mergeCounterEntry);
+}
+
+/*
+ * Internal function to set one (docID, count) pair of a word being
+ * merged
+ *
+ * Inputs:
+ *   arg: the mergeArg_t* naming the index and word
+ *   key: the docID saved as a key in the counter
+ *   count: number of occurences of word in docID
+ */
+void mergeCounterEntry(void* arg, const int key, const int count)
+{
+  mergeArg_t* merge = arg;
+  index_setWordDocCount(merge->idx, merge->word, key, count);
+}
+
+void index_removeDoc(index_t* idx, const int docID)
+{
+  if (idx == NULL || docID <= 0) {
+    return;
+  }
+  // counters can't remove a key, so set its count to 0, which
+  // index_saveToFile() skips
+  int id = docID;
+  hashtable_iterate(idx->ht, &id, removeDocEntry);
+}
+
+/*
+ * Internal function to zero a docID's count in one hashtable entry
+ *
+ * Inputs:
+ *   arg: index_removeDoc() will pass in the int* docID
+ *   key: the word saved as a key in the hashtable
+ *   item: the counter saved as an item in the hashtable
+ */
+void removeDocEntry(void* arg, const char* key, void* item)
+{
+  int docID = *(int*)arg;
+  counters_t* counter = item;
+  if (counters_get(counter, docID) > 0) {
+    counters_set(counter, docID, 0);
+  }
+}
+
 index_t* index_readIndexFile(const char* filePath)
 {
   if (filePath == NULL) {
@@ -238,6 +342,12 @@ void saveHashtableEntry(void* arg, const char* key, void* item)
 {
   FILE* fp = arg;
   counters_t* counter = item;
+  // skip a word whose pages have all been removed
+  int nonzero = 0;
+  counters_iterate(counter, &nonzero, countNonzero);
+  if (nonzero == 0) {
+    return;
+  }
   // print the word, start a newline if not at the beginning of the file
   if (ftell(fp) != 0) {
     fputc('\n', fp);
@@ -259,7 +369,24 @@ void saveHashtableEntry(void* arg, const char* key, void* item)
 void saveCounterEntry(void* arg, const int key, const int count)
 {
   FILE* fp = arg;
-  fprintf(fp, " %d %d", key, count);
+  if (count > 0) {
+    fprintf(fp, " %d %d", key, count);
+  }
+}
+
+/*
+ * Internal function to count the nonzero entries in a counter.
+ *
+ * Inputs:
+ *   arg: int* count to increment
+ *   key: a docID saved as a key in the counter
+ *   count: number of occurences of word in docID
+ */
+void countNonzero(void* arg, const int key, const int count)
+{
+  if (count > 0) {
+    (*(int*)arg)++;
+  }
 }
 
 /*
@@ -18,6 +18,7 @@
 
 // libcs50.a
 #include "counters.h"
+#include "webpage.h"
 
 /* Public types */
 typedef struct index index_t;
@@ -58,6 +59,40 @@ void index_delete(index_t* idx);
  */
 void index_addWord(index_t* idx, char* word, const int docID);
 
+/*
+ * Update the index with every word in a page's html, as index_addWord()
+ * does for each one. The page's words are counted on their own, then
+ * merged into the index, so each word's counter in the index is updated
+ * once per page, however often the word occurs
+ *
+ * Input:
+ *   idx: index to update
+ *   page: webpage_t* containing the html
+ *   docID: file corresponding to `page`
+ */
+void index_addPage(index_t* idx, const webpage_t* page, const int docID);
+
+/*
+ * Merge one index into another: each (docID, count) pair of each word
+ * in `other` is set in `idx`, replacing any count `idx` had for that
+ * word and docID; `other` is unchanged
+ *
+ * Input:
+ *   idx: index to update
+ *   other: index to merge from, e.g. one holding a single page
+ */
+void index_merge(index_t* idx, const index_t* other);
+
+/*
+ * Remove a page from the index, e.g. before indexing a new copy of it;
+ * words found in no other page are left out when the index is saved
+ *
+ * Input:
+ *   idx: the index
+ *   docID: the page to remove
+ */
+void index_removeDoc(index_t* idx, const int docID);
+
 /*
  * Read a file, in the format written by index_saveToFile(), into an index_t
  *
@@ -0,0 +1,201 @@
+/*
+ * linkgraph.c    Hugo Fang    3/6/2024
+ *
+ * See linkgraph.h for details
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "linkgraph.h"
+
+/* Local constants */
+static const char LINKS_MAGIC[8] = { 'T', 'S', 'E', 'L', 'I', 'N', 'K', '1' };
+static const char SCORES_MAGIC[8] = { 'T', 'S', 'E', 'R', 'A', 'N', 'K', '1' };
+
+/* Private function prototypes */
+static FILE* openTmp(const char* pageDirectory, const char* name,
+                     char** tmpPath_p, char** path_p);
+static bool closeTmp(FILE* fp, bool ok, char* tmpPath, char* path);
+static FILE* openFile(const char* pageDirectory, const char* name,
+                      const char* magic, int32_t* count_p);
+
+/* Public functions */
+bool linkgraph_save(const char* pageDirectory, const int numDocs,
+                    const linkedge_t* edges, const int numEdges)
+{
+  if (pageDirectory == NULL || numDocs < 0 || numEdges < 0
+      || (numEdges > 0 && edges == NULL)) {
+    return false;
+  }
+  char* tmpPath;
+  char* path;
+  FILE* fp = openTmp(pageDirectory, ".links", &tmpPath, &path);
+  if (fp == NULL) {
+    return false;
+  }
+  int32_t n = numDocs;
+  int32_t m = numEdges;
+  bool ok = fwrite(LINKS_MAGIC, sizeof(LINKS_MAGIC), 1, fp) == 1
+            && fwrite(&n, sizeof(n), 1, fp) == 1
+            && fwrite(&m, sizeof(m), 1, fp) == 1
+            && fwrite(edges, sizeof(linkedge_t), numEdges, fp)
+               == (size_t)numEdges;
+  return closeTmp(fp, ok, tmpPath, path);
+}
+
+linkedge_t* linkgraph_load(const char* pageDirectory, int* numDocs_p,
+                           int* numEdges_p)
+{
+  if (pageDirectory == NULL || numDocs_p == NULL || numEdges_p == NULL) {
+    return NULL;
+  }
+  int32_t n, m;
+  FILE* fp = openFile(pageDirectory, ".links", LINKS_MAGIC, &n);
+  if (fp == NULL) {
+    return NULL;
+  }
+  if (fread(&m, sizeof(m), 1, fp) != 1 || m < 0) {
+    fclose(fp);
+    return NULL;
+  }
+  linkedge_t* edges = malloc(sizeof(linkedge_t) * (m > 0 ? m : 1));
+  bool ok = edges != NULL
+            && fread(edges, sizeof(linkedge_t), m, fp) == (size_t)m
+            && fgetc(fp) == EOF;
+  fclose(fp);
+  for (int32_t i = 0; ok && i < m; i++) {
+    ok = edges[i].from >= 1 && edges[i].from <= n
+         && edges[i].to >= 1 && edges[i].to <= n;
+  }
+  if (!ok) {
+    free(edges);
+    return NULL;
+  }
+  *numDocs_p = n;
+  *numEdges_p = m;
+  return edges;
+}
+
+bool linkgraph_saveScores(const char* pageDirectory, const double* scores,
+                          const int numDocs)
+{
+  if (pageDirectory == NULL || numDocs < 0
+      || (numDocs > 0 && scores == NULL)) {
+    return false;
+  }
+  char* tmpPath;
+  char* path;
+  FILE* fp = openTmp(pageDirectory, ".pagerank", &tmpPath, &path);
+  if (fp == NULL) {
+    return false;
+  }
+  int32_t n = numDocs;
+  bool ok = fwrite(SCORES_MAGIC, sizeof(SCORES_MAGIC), 1, fp) == 1
+            && fwrite(&n, sizeof(n), 1, fp) == 1
+            && fwrite(scores, sizeof(double), numDocs, fp) == (size_t)numDocs;
+  return closeTmp(fp, ok, tmpPath, path);
+}
+
+double* linkgraph_loadScores(const char* pageDirectory, int* numDocs_p)
+{
+  if (pageDirectory == NULL || numDocs_p == NULL) {
+    return NULL;
+  }
+  int32_t n;
+  FILE* fp = openFile(pageDirectory, ".pagerank", SCORES_MAGIC, &n);
+  if (fp == NULL) {
+    return NULL;
+  }
+  double* scores = malloc(sizeof(double) * (n > 0 ? n : 1));
+  bool ok = scores != NULL
+            && fread(scores, sizeof(double), n, fp) == (size_t)n
+            && fgetc(fp) == EOF;
+  fclose(fp);
+  if (!ok) {
+    free(scores);
+    return NULL;
+  }
+  *numDocs_p = n;
+  return scores;
+}
+
+/*
+ * Opens "pageDirectory/name.tmp" for writing, setting *tmpPath_p to its
+ * path and *path_p to that of the file it will replace
+ *
+ * Returns:
+ *   the open file, or NULL on error (nothing is then left to free)
+ */
+static FILE* openTmp(const char* pageDirectory, const char* name,
+                     char** tmpPath_p, char** path_p)
+{
+  size_t len = strlen(pageDirectory) + strlen(name) + strlen("/.tmp") + 1;
+  char* tmpPath = malloc(len);
+  char* path = malloc(len);
+  FILE* fp = NULL;
+  if (tmpPath != NULL && path != NULL) {
+    sprintf(tmpPath, "%s/%s.tmp", pageDirectory, name);
+    sprintf(path, "%s/%s", pageDirectory, name);
+    fp = fopen(tmpPath, "wb");
+  }
+  if (fp == NULL) {
+    free(tmpPath);
+    free(path);
+    return NULL;
+  }
+  *tmpPath_p = tmpPath;
+  *path_p = path;
+  return fp;
+}
+
+/*
+ * Closes a file opened by openTmp() and, if it was written completely
+ * (ok), renames it into place, else removes it; frees both paths
+ *
+ * Returns:
+ *   true if the new file is in place
+ */
+static bool closeTmp(FILE* fp, bool ok, char* tmpPath, char* path)
+{
+  ok = (fclose(fp) == 0) && ok;
+  if (ok) {
+    ok = rename(tmpPath, path) == 0;
+  }
+  if (!ok) {
+    remove(tmpPath);
+  }
+  free(tmpPath);
+  free(path);
+  return ok;
+}
+
+/*
+ * Opens "pageDirectory/name" for reading, and reads its magic and the
+ * count that follows it into *count_p
+ *
+ * Returns:
+ *   the open file, positioned after the count, or NULL if it is missing
+ *   or does not start as it should
+ */
+static FILE* openFile(const char* pageDirectory, const char* name,
+                      const char* magic, int32_t* count_p)
+{
+  char path[strlen(pageDirectory) + strlen(name) + 2];
+  sprintf(path, "%s/%s", pageDirectory, name);
+  FILE* fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return NULL;
+  }
+  char found[sizeof(LINKS_MAGIC)];
+  if (fread(found, sizeof(found), 1, fp) != 1
+      || memcmp(found, magic, sizeof(found)) != 0
+      || fread(count_p, sizeof(*count_p), 1, fp) != 1 || *count_p < 0) {
+    fclose(fp);
+    return NULL;
+  }
+  return fp;
+}
@@ -0,0 +1,95 @@
+/*
+ * linkgraph.h - header file for linkgraph.c
+ *
+ * Reads and writes the two files describing the links between the
+ * pages of a page directory, both binary, in the machine's own byte
+ * order:
+ *
+ *   "pageDirectory/.links", written by the crawler (--links): the
+ *   magic "TSELINK1", the number of documents n (the highest docID),
+ *   the number of edges m, then m pairs of ints "from to", one for each
+ *   page `from` linking to a different page `to`, sorted by from, then
+ *   to, without repeats.
+ *
+ *   "pageDirectory/.pagerank", written by pagerank: the magic
+ *   "TSERANK1", n, then n doubles, the static score of docIDs 1 to n.
+ *
+ * Each is written to a ".tmp" file renamed into place once complete.
+ *
+ * Hugo Fang, 3/6/2024
+ */
+
+#ifndef __LINKGRAPH_H__
+#define __LINKGRAPH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* Public types */
+typedef struct linkedge {
+  int from;
+  int to;
+} linkedge_t;
+
+/*
+ * Write the link graph of pageDirectory
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   numDocs: the highest docID
+ *   edges: numEdges edges, sorted and without repeats, each docID 1 to
+ *     numDocs
+ *
+ * Returns:
+ *   false on any error, leaving any previous file in place
+ */
+bool linkgraph_save(const char* pageDirectory, const int numDocs,
+                    const linkedge_t* edges, const int numEdges);
+
+/*
+ * Read the link graph of pageDirectory
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   numDocs_p: set to the highest docID
+ *   numEdges_p: set to the number of edges
+ *
+ * Returns:
+ *   the edges, sorted by from, then to (an array of at least one, even
+ *   if there are none), or NULL if the file is missing or damaged
+ *
+ * Caller is responsible for free()ing the returned array
+ */
+linkedge_t* linkgraph_load(const char* pageDirectory, int* numDocs_p,
+                           int* numEdges_p);
+
+/*
+ * Write the static score of each document of pageDirectory
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   scores: numDocs scores, scores[i] that of docID i + 1
+ *
+ * Returns:
+ *   false on any error, leaving any previous file in place
+ */
+bool linkgraph_saveScores(const char* pageDirectory, const double* scores,
+                          const int numDocs);
+
+/*
+ * Read the static scores of pageDirectory
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   numDocs_p: set to the number of scores
+ *
+ * Returns:
+ *   the scores, scores[i] that of docID i + 1 (an array of at least
+ *   one), or NULL if the file is missing or damaged
+ *
+ * Caller is responsible for free()ing the returned array
+ */
+double* linkgraph_loadScores(const char* pageDirectory, int* numDocs_p);
+
+#endif // __LINKGRAPH_H__
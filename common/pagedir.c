@@ -4,11 +4,17 @@
  * See pagedir.h for details
  */
 
+#define _POSIX_C_SOURCE 200809L   // openat
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/uio.h>
 
 // libcs50.a
 #include "webpage.h"
@@ -20,6 +26,7 @@
 
 /* Private functions */
 static bool str2int(const char* string, int* num_p);
+static bool writePage(const int fd, const webpage_t* page);
 
 bool pagedir_init(const char* pageDirectory)
 {
@@ -61,10 +68,6 @@ bool pagedir_save(const webpage_t* page, const char* pageDirectory, const int do
   if (page == NULL || pageDirectory == NULL || docID <= 0) {
     return false;
   }
-  // check validity and accessability of pageDirectory
-  if (access(pageDirectory, F_OK) == -1) {
-    return false;
-  }
 
   // get length of documentID as string, then allocate space for file path
   int idLength = snprintf(NULL, 0, "%d", docID);
@@ -79,15 +82,34 @@ bool pagedir_save(const webpage_t* page, const char* pageDirectory, const int do
     snprintf(filePath, sizeof(filePath), "%s/%d", pageDirectory, docID);
   }
   
-  FILE* fp = fopen(filePath, "w");
-  if (fp == NULL) {
+  // a missing pageDirectory fails here, without checking it first
+  int fd = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1) {
     return false;
   }
-  fprintf(fp, "%s\n", webpage_getURL(page));
-  fprintf(fp, "%d\n", webpage_getDepth(page));
-  fprintf(fp, "%s", webpage_getHTML(page));
-  fclose(fp);
-  return true;
+  bool written = writePage(fd, page);
+  return (close(fd) == 0) && written;
+}
+
+int pagedir_saveAt(const int dirfd, const webpage_t* page, const int docID)
+{
+  if (dirfd < 0 || page == NULL || docID <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  char fileName[snprintf(NULL, 0, "%d", docID) + 1];
+  sprintf(fileName, "%d", docID);
+  int fd = openat(dirfd, fileName, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1) {
+    return -1;
+  }
+  if (!writePage(fd, page)) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+  }
+  return fd;
 }
 
 webpage_t* pagedir_loadPageFromFile(const char* pageDirectory, const int docID)
@@ -181,6 +203,83 @@ if (pageDirectory == NULL || docID <= 0) {
   return url;
 }
 
+int pagedir_trim(const char* pageDirectory, const int docID)
+{
+  if (pageDirectory == NULL || docID <= 0) {
+    return -1;
+  }
+  DIR* dir = opendir(pageDirectory);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  // page files are named by docID alone; skip everything else
+  int removed = 0;
+  size_t dirLen = strlen(pageDirectory);
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    int fileID;
+    if (strspn(entry->d_name, "0123456789") != strlen(entry->d_name)
+        || !str2int(entry->d_name, &fileID) || fileID < docID) {
+      continue;
+    }
+    char filePath[dirLen + strlen(entry->d_name) + 2];
+    if (pageDirectory[dirLen - 1] == '/') {
+      snprintf(filePath, sizeof(filePath), "%s%s", pageDirectory, entry->d_name);
+    } else {
+      snprintf(filePath, sizeof(filePath), "%s/%s", pageDirectory, entry->d_name);
+    }
+    if (unlink(filePath) == 0) {
+      removed++;
+    }
+  }
+  closedir(dir);
+  return removed;
+}
+
+/*
+ * Writes a page file's three parts (URL line, depth line, html) to fd,
+ * gathered into as few write calls as the kernel allows
+ * 
+ * Returns false on a write error, with errno set
+ */
+static bool writePage(const int fd, const webpage_t* page)
+{
+  char* url = webpage_getURL(page);
+  char* html = webpage_getHTML(page);
+  char depth[16];
+  int depthLength = snprintf(depth, sizeof(depth), "%d\n",
+                             webpage_getDepth(page));
+  struct iovec parts[] = {
+    { url, strlen(url) },
+    { "\n", 1 },
+    { depth, depthLength },
+    { html, html ? strlen(html) : 0 },
+  };
+  struct iovec* part = parts;
+  int numParts = sizeof(parts) / sizeof(parts[0]);
+  while (numParts > 0) {
+    ssize_t written = writev(fd, part, numParts);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    // skip the parts written, and the written front of a part cut short
+    while (numParts > 0 && (size_t)written >= part->iov_len) {
+      written -= part->iov_len;
+      part++;
+      numParts--;
+    }
+    if (numParts > 0) {
+      part->iov_base = (char*)part->iov_base + written;
+      part->iov_len -= written;
+    }
+  }
+  return true;
+}
+
 /*
  * converts string to integer and stores in num_p
  * 
@@ -228,7 +327,22 @@ bool pagedir_isCrawlerDirectory(char* pageDirectory)
 
 bool pagedir_isFileWriteable(char* filePath)
 {
-  return (filePath != NULL && access(filePath, W_OK) == 0);
+  if (filePath == NULL) {
+    return false;
+  }
+  if (access(filePath, F_OK) == 0) {
+    return access(filePath, W_OK) == 0;
+  }
+  // no such file yet: can one be created in its directory?
+  char* slash = strrchr(filePath, '/');
+  if (slash == NULL) {
+    return access(".", W_OK | X_OK) == 0;
+  }
+  size_t dirLen = (slash == filePath) ? 1 : slash - filePath;
+  char dir[dirLen + 1];
+  memcpy(dir, filePath, dirLen);
+  dir[dirLen] = '\0';
+  return access(dir, W_OK | X_OK) == 0;
 }
 
 bool pagedir_isFileReadable(char* filePath)
@@ -47,6 +47,25 @@ bool pagedir_init(const char* pageDirectory);
  */
 bool pagedir_save(const webpage_t* page, const char* pageDirectory, const int docID);
 
+/*
+ * Like pagedir_save(), but creates the file in the directory open as
+ * dirfd, and leaves it open, so a caller saving many pages can fsync()
+ * them together before closing them
+ * 
+ * Input:
+ *   dirfd: file descriptor of the page directory, opened with O_DIRECTORY
+ *   page: webpage_t* containing the page content and metadata
+ *   docID: name of file (int greater than 0)
+ *   
+ * Returns:
+ *   the file descriptor of the new file if success
+ *   -1 if any error occurs (errno is then set):
+ *     dirfd is invalid, page is NULL, docID <= 0, file creation/write failure
+ * 
+ * Caller needs to close() the descriptor returned
+ */
+int pagedir_saveAt(const int dirfd, const webpage_t* page, const int docID);
+
 /*
  * Loads a file saved by pagedir_save(), into a webpage_t*
  * 
@@ -79,6 +98,20 @@ webpage_t* pagedir_loadPageFromFile(const char* pageDirectory, const int docID);
  */
 char* pagedir_loadUrlFromFile(const char* pageDirectory, const int docID);
 
+/*
+ * Removes every page file in pageDirectory numbered docID or higher,
+ * e.g. pages saved by a crawl that died before it could record them
+ * 
+ * Input:
+ *   pageDirectory: directory of page files
+ *   docID: first docID to remove (int greater than 0)
+ *   
+ * Returns:
+ *   number of files removed, or -1 if pageDirectory is NULL or can't be
+ *   read, or docID <= 0
+ */
+int pagedir_trim(const char* pageDirectory, const int docID);
+
 /*
  * Checks for the existence of "pageDirectory/.crawler", which
  * marks a crawler generated directory
@@ -0,0 +1,204 @@
+/*
+ * checkpoint.c    Hugo Fang    2/26/2024
+ *
+ * See checkpoint.h for details
+ *
+ * File format (native byte order):
+ *   8 bytes  "TSECKPT1"
+ *   int32    nextDocID
+ *   uint32   number of pages, then for each page:
+ *              int32 depth, uint32 URL length, URL bytes (no '\0')
+ *   the seen set, as written by seenset_save()
+ */
+
+#define _POSIX_C_SOURCE 200809L   // fileno, fsync
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// libcs50.a
+#include "webpage.h"
+
+#include "checkpoint.h"
+
+/* Local types */
+// passes the output file to writePage() through hostsched_iterate()
+typedef struct pageWriter {
+  FILE* fp;
+  uint32_t written;
+  bool ok;
+} pageWriter_t;
+
+/* Local constants */
+static const char MAGIC[8] = { 'T', 'S', 'E', 'C', 'K', 'P', 'T', '1' };
+
+/* Private function prototypes */
+static char* checkpointPath(const char* pageDirectory, const char* name);
+static void writePage(void* arg, const webpage_t* page);
+static webpage_t* readPage(FILE* fp);
+
+/* Public functions */
+bool checkpoint_save(const char* pageDirectory, const int nextDocID,
+                     webpage_t** inProgress, const int numInProgress,
+                     hostsched_t* toVisit, const seenset_t* seen)
+{
+  if (pageDirectory == NULL || nextDocID <= 0 || numInProgress < 0
+      || (numInProgress > 0 && inProgress == NULL)
+      || toVisit == NULL || seen == NULL) {
+    return false;
+  }
+  char* tmpPath = checkpointPath(pageDirectory, ".checkpoint.tmp");
+  char* path = checkpointPath(pageDirectory, ".checkpoint");
+  FILE* fp = (tmpPath && path) ? fopen(tmpPath, "wb") : NULL;
+  if (fp == NULL) {
+    free(tmpPath);
+    free(path);
+    return false;
+  }
+
+  int32_t docID = nextDocID;
+  uint32_t numPages = numInProgress + hostsched_size(toVisit);
+  pageWriter_t writer = { fp, 0, true };
+  writer.ok = fwrite(MAGIC, sizeof(MAGIC), 1, fp) == 1
+              && fwrite(&docID, sizeof(docID), 1, fp) == 1
+              && fwrite(&numPages, sizeof(numPages), 1, fp) == 1;
+  for (int i = 0; writer.ok && i < numInProgress; i++) {
+    writePage(&writer, inProgress[i]);
+  }
+  bool ok = writer.ok
+            && hostsched_iterate(toVisit, &writer, writePage)
+            && writer.ok && writer.written == numPages
+            && seenset_save(seen, fp)
+            && fflush(fp) == 0
+            && fsync(fileno(fp)) == 0;
+  ok = (fclose(fp) == 0) && ok;
+
+  // only a complete checkpoint replaces the last one
+  if (ok) {
+    ok = rename(tmpPath, path) == 0;
+  }
+  if (!ok) {
+    unlink(tmpPath);
+  }
+  free(tmpPath);
+  free(path);
+  return ok;
+}
+
+bool checkpoint_load(const char* pageDirectory, int* nextDocID_p,
+                     hostsched_t* toVisit, seenset_t** seen_p)
+{
+  if (pageDirectory == NULL || nextDocID_p == NULL || toVisit == NULL
+      || seen_p == NULL) {
+    return false;
+  }
+  char* path = checkpointPath(pageDirectory, ".checkpoint");
+  FILE* fp = path ? fopen(path, "rb") : NULL;
+  free(path);
+  if (fp == NULL) {
+    return false;
+  }
+
+  char magic[sizeof(MAGIC)];
+  int32_t docID;
+  uint32_t numPages;
+  bool ok = fread(magic, sizeof(magic), 1, fp) == 1
+            && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+            && fread(&docID, sizeof(docID), 1, fp) == 1 && docID > 0
+            && fread(&numPages, sizeof(numPages), 1, fp) == 1;
+  for (uint32_t i = 0; ok && i < numPages; i++) {
+    webpage_t* page = readPage(fp);
+    if (page == NULL || !hostsched_add(toVisit, page)) {
+      webpage_delete(page);
+      ok = false;
+    }
+  }
+  seenset_t* seen = ok ? seenset_load(fp) : NULL;
+  fclose(fp);
+  if (seen == NULL) {
+    return false;
+  }
+
+  *nextDocID_p = docID;
+  *seen_p = seen;
+  return true;
+}
+
+void checkpoint_remove(const char* pageDirectory)
+{
+  char* path = checkpointPath(pageDirectory, ".checkpoint");
+  if (path != NULL) {
+    unlink(path);
+    free(path);
+  }
+}
+
+/*
+ * Builds "pageDirectory/name"
+ *
+ * Caller needs to free() the string returned (NULL on error)
+ */
+static char* checkpointPath(const char* pageDirectory, const char* name)
+{
+  if (pageDirectory == NULL) {
+    return NULL;
+  }
+  size_t dirLen = strlen(pageDirectory);
+  char* path = malloc(dirLen + strlen(name) + 2);
+  if (path == NULL) {
+    return NULL;
+  }
+  if (dirLen > 0 && pageDirectory[dirLen - 1] == '/') {
+    sprintf(path, "%s%s", pageDirectory, name);
+  } else {
+    sprintf(path, "%s/%s", pageDirectory, name);
+  }
+  return path;
+}
+
+/*
+ * Writes one page's depth and URL; itemfunc() for hostsched_iterate()
+ */
+static void writePage(void* arg, const webpage_t* page)
+{
+  pageWriter_t* writer = arg;
+  if (!writer->ok) {
+    return;
+  }
+  const char* url = webpage_getURL(page);
+  int32_t depth = webpage_getDepth(page);
+  uint32_t len = strlen(url);
+  writer->ok = fwrite(&depth, sizeof(depth), 1, writer->fp) == 1
+               && fwrite(&len, sizeof(len), 1, writer->fp) == 1
+               && fwrite(url, 1, len, writer->fp) == len;
+  writer->written++;
+}
+
+/*
+ * Reads one page written by writePage()
+ *
+ * Returns a new webpage_t, or NULL on a short read or memory failure
+ */
+static webpage_t* readPage(FILE* fp)
+{
+  int32_t depth;
+  uint32_t len;
+  if (fread(&depth, sizeof(depth), 1, fp) != 1 || depth < 0
+      || fread(&len, sizeof(len), 1, fp) != 1) {
+    return NULL;
+  }
+  char* url = malloc(len + 1);
+  if (url == NULL) {
+    return NULL;
+  }
+  if (fread(url, 1, len, fp) != len) {
+    free(url);
+    return NULL;
+  }
+  url[len] = '\0';
+  return webpage_new(url, depth, NULL);
+}
@@ -0,0 +1,74 @@
+/*
+ * checkpoint.h - header file for checkpoint.c
+ *
+ * Saves and restores the crawler's in-memory state, so a crawl that
+ * dies can be resumed from its last checkpoint instead of from the seed.
+ * A checkpoint holds the next docID to hand out, every page still to be
+ * fetched (queued or in progress), and the fingerprints of every URL
+ * seen. It is written to "pageDirectory/.checkpoint.tmp" and renamed
+ * over "pageDirectory/.checkpoint" only once complete, so a crash while
+ * saving leaves the previous checkpoint intact.
+ *
+ * Hugo Fang, 2/26/2024
+ */
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// libcs50
+#include "webpage.h"
+
+#include "hostsched.h"
+#include "seenset.h"
+
+/*
+ * Write a checkpoint of the crawl; the caller must keep the state from
+ * changing while it is written
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   nextDocID: the next docID to hand out; pages numbered below it are
+ *     saved, scanned, and their links queued
+ *   inProgress: pages taken from toVisit but not yet finished, of which
+ *     there are numInProgress
+ *   toVisit: the pages queued
+ *   seen: the URLs seen
+ *
+ * Returns:
+ *   true if the new checkpoint is in place, false on any error (the
+ *   previous checkpoint, if any, is then kept)
+ */
+bool checkpoint_save(const char* pageDirectory, const int nextDocID,
+                     webpage_t** inProgress, const int numInProgress,
+                     hostsched_t* toVisit, const seenset_t* seen);
+
+/*
+ * Read the checkpoint in pageDirectory
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   nextDocID_p: set to the next docID to hand out
+ *   toVisit: an empty scheduler to queue the unfinished pages into
+ *   seen_p: set to a new seenset_t with the URLs seen
+ *
+ * Returns:
+ *   true on success
+ *   false if there is no checkpoint or it can't be read; toVisit may
+ *   then hold some of its pages, and *seen_p is left unchanged
+ *
+ * Caller is responsible for calling seenset_delete() on *seen_p
+ */
+bool checkpoint_load(const char* pageDirectory, int* nextDocID_p,
+                     hostsched_t* toVisit, seenset_t** seen_p);
+
+/*
+ * Remove the checkpoint in pageDirectory, if any, e.g. once the crawl
+ * has finished
+ */
+void checkpoint_remove(const char* pageDirectory);
+
+#endif // __CHECKPOINT_H__
@@ -4,78 +4,609 @@
  * Crawls from a starting URL to a certain depth, and stores html
  * of pages found
  * 
- * Usage: crawler seedURL pageDirectory maxDepth
+ * Usage: crawler [-j numThreads | -e maxInFlight] [-d delayMillis]
+ *                [-m frontierKB] [-c checkpointSecs] [-s maxDistance]
+ *                [-p numParsers] [-q queueDepth] [-f syncEvery]
+ *                [-i indexFilename] [-P numProcesses] [--resume | --recrawl]
+ *                [--links] [--connect-to address:port] [--stats]
+ *                [--timeouts connectMillis,firstByteMillis,totalMillis]
+ *                [--max-page pageKB] [--record archive | --replay archive]
+ *                [--adapt floor,ceiling] seedURL pageDirectory maxDepth
+ * 
+ * Options:
+ *   -j  worker threads sharing the frontier
+ *   -e  fetches in flight with the event-driven fetcher (fetcher.h)
+ *   -d  least time between fetches from one host (default 1000)
+ *   -m  frontier memory budget, past which it spills to disk (frontier.h)
+ *   -c  seconds between checkpoints (default 60; 0 for never)
+ *   -s  skip pages within this many SimHash bits of one saved (dupcheck.h)
+ *   -p  parser threads of a pipelined crawl (workqueue.h)
+ *   -q  most pages waiting in each queue (default 64)
+ *   -f  fsync pages written in groups of this many (pagewriter.h)
+ *   -i  index pages as they are saved, into indexFilename
+ *   -P  processes to split the crawl across (partition.h)
+ *   --resume      continue from pageDirectory/.checkpoint (checkpoint.h)
+ *   --recrawl     refetch only pages changed since saved (validators.h)
+ *   --links       write pageDirectory/.links for pagerank (linklog.h)
+ *   --connect-to  send every fetch to this IPv4 address and port
+ *   --stats       print fetch statistics to stderr (fetchstats.h)
+ *   --timeouts    deadlines on each fetch attempt (webpage.h)
+ *   --max-page    most kilobytes of a page read (webpage.h)
+ *   --record      record every response in an archive (archive.h)
+ *   --replay      fetch every page from an archive (archive.h)
+ *   --adapt       adapt fetches in flight per host (hostsched.h)
  * 
  * Exits with:
  *   errno 1 if error parsing arguments: * seedURL is not internal,
- *   pageDirectory doesn't exist, maxDepth < 0
+ *   pageDirectory doesn't exist, maxDepth < 0, numThreads < 1,
+ *   maxInFlight < 1, delayMillis < 0, frontierKB < 1, checkpointSecs < 0,
+ *   maxDistance not in 0-3, numParsers < 1, queueDepth < 1, syncEvery
+ *   not in 1-256, an unwriteable indexFilename, an invalid --connect-to
+ *   address, --timeouts not three non-negative numbers, pageKB < 1,
+ *   numProcesses < 1, --adapt not 1 <= floor <= ceiling, or both -j
+ *   and -e, --resume and --recrawl,
+ *   or -P and any of -i, -s, --resume, --recrawl given, or --links and
+ *   either -P or --resume, or --record and either --replay or -P, or an
+ *   archive that can't be opened
  *   errno 2 if failed to initialize data structures in crawl()
- *   errno 3 if error from pagedir_save()
+ *   errno 3 if a page, the link graph or the archive could not be saved,
+ *   or a process of a -P crawl failed
  * 
  */
 
+#define _POSIX_C_SOURCE 200809L   // clock_gettime, pthread_condattr_setclock
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
 // header files in libcs50.a
-#include "bag.h"
-#include "hashtable.h"
 #include "webpage.h"
+#include "fetcher.h"
+#include "dnscache.h"
+#include "file.h"
+#include "hashtable.h"
 
 #include "pagedir.h"
 #include "print.h"
+#include "index.h"
+#include "hostsched.h"
+#include "seenset.h"
+#include "checkpoint.h"
+#include "dupcheck.h"
+#include "validators.h"
+#include "workqueue.h"
+#include "pagewriter.h"
+#include "fetchstats.h"
+#include "partition.h"
+#include "linklog.h"
+
+
+/* Local types */
+/*
+ * Options read from the command line; see parseArgs()
+ */
+typedef struct crawlOptions {
+  int numThreads;
+  int maxInFlight;
+  int delayMillis;
+  int frontierKB;
+  int checkpointSecs;
+  int maxDistance;
+  int numParsers;
+  int queueDepth;
+  int syncEvery;
+  const char* indexFilename;
+  int numProcesses;
+  bool resume;
+  bool recrawl;
+  bool links;
+  bool stats;
+  const char* record;         // archive to record responses in, or NULL
+  const char* replay;         // archive to fetch pages from, or NULL
+  int adaptFloor;             // bounds of each host's adaptive limit on
+  int adaptCeiling;           // fetches in flight, or 0 for no limit
+
+  // set by crawlPartitioned() for each process it starts: the partition
+  // it owns, and its socket to the coordinator; else -1
+  int part;
+  int partFd;
+} crawlOptions_t;
+
+/*
+ * State shared by all crawler threads. The frontier (`toVisit`) and the
+ * seen set each have their own lock; `active` counts pages that have been
+ * taken from the frontier but not finished, so workers can tell an empty
+ * frontier apart from a finished crawl. The frontier hands out a page
+ * only once its host's politeness delay has passed, and, with --adapt,
+ * while fewer of its fetches are in flight than its limit; each host's
+ * pages go breadth-first. frontierCond uses the monotonic clock so
+ * workers can wait for the next host to become ready, and is signalled
+ * when a fetch's end brings a host back under its limit.
+ * 
+ * A page is finished (scanned, marked done, and given to the page
+ * writer) while holding pageLock for reading; a checkpoint holds it for
+ * writing, so it sees each page either still in `inProgress` or fully
+ * finished.
+ * 
+ * When recrawling, `known` maps the URL of each page saved before to its
+ * docID; it is only read once the crawl starts, so needs no lock.
+ * 
+ * When pipelined, a fetched page goes through parseQueue to the parsers
+ * and writeQueue to the writer; it stays in `inProgress` until the writer
+ * has taken it. A parser scans it holding pageLock for reading, and the
+ * writer gives it its docID and marks it done holding pageLock again, so
+ * a checkpoint sees either the page in progress, whose links it may
+ * already have queued, or the page finished.
+ * 
+ * A page finished has been handed to the page writer, `writer`, but may
+ * not be on disk yet; a checkpoint waits until it is.
+ * 
+ * With -i, each page is added to `index` once the writer has saved it.
+ * 
+ * With --links, pageScan() records each page's links in `links`, and the
+ * docID each URL gets is recorded there when the page is saved, or found
+ * to duplicate one saved.
+ * 
+ * With -P, `partition` connects this process to the coordinator, whose
+ * thread adds each link forwarded here to the frontier and counts it in
+ * `received`. Once the frontier is empty and nothing is in progress,
+ * the process reports itself idle, with that count, and waits until the
+ * coordinator sends more links or ends the crawl (`partitionDone`). The
+ * idle report is never sent holding frontierLock, which the reading
+ * thread needs to take the links the coordinator is trying to send.
+ */
+typedef struct crawlState {
+  const char* pageDirectory;
+  int maxDepth;
+
+  // <webpage_t* page> queued by host, guarded by frontierLock
+  hostsched_t* toVisit;
+  int active;
+  webpage_t** inProgress;     // the `active` pages taken, in no order
+  long* takenAt;              // when each was taken, by hostsched_now()
+  bool failed;
+  pthread_mutex_t frontierLock;
+  pthread_cond_t frontierCond;
+
+  // fingerprints of URLs already queued, guarded by seenLock
+  seenset_t* seen;
+  pthread_mutex_t seenLock;
+
+  // next docID to hand out, guarded by docIDLock; so are the prints of
+  // pages saved, the alias file and the URLs listed in it (aliased),
+  // when checking for duplicates, the
+  // pages' validators, the list of pages changed, when recrawling, and
+  // the links found, with --links (else NULL)
+  int nextDocID;
+  dupcheck_t* dupcheck;
+  FILE* aliases;
+  seenset_t* aliased;
+  validators_t* validators;
+  FILE* changed;
+  linklog_t* links;
+  pthread_mutex_t docIDLock;
+
+  // <char* URL, int* docID> of the pages saved before, when recrawling
+  hashtable_t* known;
+
+  // the queues between the stages, when pipelined; else NULL
+  workqueue_t* parseQueue;
+  workqueue_t* writeQueue;
+
+  // saves pages in the background
+  pagewriter_t* writer;
+
+  // tallies the fetches, with --stats; else NULL
+  fetchstats_t* stats;
+
+  // the words in the pages saved, with -i; else NULL. Only the page
+  // writer's thread uses it, until the writer is closed
+  index_t* index;
+
+  // with -P, else NULL; the counts and partitionDone are guarded by
+  // frontierLock
+  partition_t* partition;
+  long received;
+  long reportedIdle;
+  bool partitionDone;
 
+  // checkpointing; nextCheckpoint (a hostsched_now() time, or -1 for
+  // never) is guarded by checkpointLock
+  pthread_rwlock_t pageLock;
+  pthread_mutex_t checkpointLock;
+  long nextCheckpoint;
+  int checkpointSecs;
+} crawlState_t;
 
+/* Local constants */
+static const int SCAN_BATCH = 32;  // most links taken from a page at once
+static const size_t URL_BUF = 2048;  // longer links are normalized on the heap
+static const long IDLE_POLL_MILLIS = 10;  // -e with -P: checks for links
+
+/* Private functions */
 static void parseArgs(const int argc, char* argv[], char** seedURL_p,
-               char** pageDirectory_p, int* maxDepth_p);
+               char** pageDirectory_p, int* maxDepth_p, crawlOptions_t* opts);
 static bool str2int(const char string[], int* num_p);
-static void crawl(char* seedURL, char* pageDirectory, const int maxDepth);
+static void crawl(char* seedURL, char* pageDirectory, const int maxDepth,
+                  const crawlOptions_t* opts);
+static void crawlPartitioned(char* seedURL, char* pageDirectory,
+                             const int maxDepth, const crawlOptions_t* opts);
+static void crawlPipelined(crawlState_t* state, const crawlOptions_t* opts);
+static void printQueueStats(const char* name, workqueue_t* queue);
+static void* crawlWorker(void* arg);
+static void fetchDone(crawlState_t* state, webpage_t* page, const bool fetched);
+static void crawlPage(crawlState_t* state, webpage_t* page, bool fetched);
+static void* parseWorker(void* arg);
+static void* writeWorker(void* arg);
+static void savePage(crawlState_t* state, webpage_t* page);
+static void pageWritten(void* arg, const webpage_t* page, int docID);
+static void pageWriteFailed(void* arg, int docID, int err);
+static void crawlFailed(crawlState_t* state);
+static webpage_t* eventNext(void* arg, long* waitMillis);
+static void eventDone(void* arg, webpage_t* page, bool success);
+static webpage_t* frontierTake(crawlState_t* state);
+static webpage_t* frontierTryTake(crawlState_t* state, long* waitMillis);
+static long frontierFetched(crawlState_t* state, webpage_t* page);
+static void frontierAdd(crawlState_t* state, webpage_t* page);
+static void frontierDone(crawlState_t* state, webpage_t* page);
+static bool frontierIdle(crawlState_t* state);
+static void linkForwarded(void* arg, const char* url, int depth);
+static void partitionEnded(void* arg, bool finished);
+static void checkpoint(crawlState_t* state);
+static int allocDocID(crawlState_t* state, const webpage_t* page);
+static void recrawlInit(crawlState_t* state);
+static int knownDocID(crawlState_t* state, const webpage_t* page);
+static void setValidators(crawlState_t* state, webpage_t* page);
+static bool loadUnchanged(crawlState_t* state, webpage_t* page);
+static void refreshPage(crawlState_t* state, webpage_t* page, const int docID);
+static void recordPage(crawlState_t* state, const webpage_t* page,
+                       const int docID, const bool changed);
+static void indexInit(crawlState_t* state);
+static void indexPage(crawlState_t* state, const webpage_t* page,
+                      const int docID);
+static void dupcheckInit(crawlState_t* state, const int maxDistance,
+                         const bool resumed);
 static void logr(const char* word, const int depth, const char* url);
-static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen);
+static void pageScan(webpage_t* page, crawlState_t* state);
+static void followLink(crawlState_t* state, const char* url, const int depth);
 
 int main(const int argc, char* argv[])
 {
   char* seedURL = NULL;
   char* pageDirectory = NULL;
   int maxDepth = -1;
-  parseArgs(argc, argv, &seedURL, &pageDirectory, &maxDepth);
-  crawl(seedURL, pageDirectory, maxDepth);
+  crawlOptions_t opts = {
+    .numThreads = 1,
+    .maxInFlight = 0,
+    .delayMillis = 1000,
+    .frontierKB = 0,
+    .checkpointSecs = 60,
+    .maxDistance = -1,
+    .numParsers = 0,
+    .queueDepth = 64,
+    .syncEvery = 0,
+    .indexFilename = NULL,
+    .numProcesses = 1,
+    .resume = false,
+    .recrawl = false,
+    .links = false,
+    .stats = false,
+    .record = NULL,
+    .replay = NULL,
+    .adaptFloor = 0,
+    .adaptCeiling = 0,
+    .part = -1,
+    .partFd = -1,
+  };
+  parseArgs(argc, argv, &seedURL, &pageDirectory, &maxDepth, &opts);
+  if (opts.numProcesses > 1) {
+    crawlPartitioned(seedURL, pageDirectory, maxDepth, &opts);
+  } else {
+    crawl(seedURL, pageDirectory, maxDepth, &opts);
+  }
   return 0;
 }
 
 /*
- * checks argc == 4 (1 for "crawler", 3 for inputs)
+ * reads any leading options:
+ *   -j numThreads: number of worker threads (positive integer, default 1)
+ *   -e maxInFlight: use the event-driven fetcher with this many fetches
+ *     outstanding (positive integer; 0, the default, means don't)
+ *   -d delayMillis: minimum time between fetches from the same host
+ *     (non-negative integer, default 1000)
+ *   -m frontierKB: memory budget for the frontier, above which it spills
+ *     to disk (positive integer; 0, the default, means no limit)
+ *   -c checkpointSecs: how often to checkpoint the crawl (non-negative
+ *     integer, default 60; 0 means never)
+ *   -s maxDistance: skip pages duplicating one already saved, to within
+ *     this many bits of SimHash (0-3; by default, don't check)
+ *   -p numParsers: pipeline the crawl, with this many parser threads
+ *     (positive integer; 0, the default, means don't)
+ *   -q queueDepth: most pages queued between pipeline stages, or waiting
+ *     to be written (positive integer, default 64)
+ *   -f syncEvery: fsync pages written in groups of this many (1-256; by
+ *     default, never)
+ *   -i indexFilename: index the pages as they are saved, and write the
+ *     index to this file at the end
+ *   -P numProcesses: split the crawl across this many processes
+ *     (positive integer, default 1)
+ *   --resume: continue from the checkpoint in pageDirectory, if any
+ *   --recrawl: refresh the pages already in pageDirectory, fetching
+ *     only those changed, and add any new ones
+ *   --links: write the links between the pages saved to pageDirectory
+ *   --connect-to address:port: send every fetch to this IPv4 address and
+ *     port instead
+ *   --stats: print fetch statistics at the end
+ *   --timeouts connectMillis,firstByteMillis,totalMillis: deadlines on
+ *     each attempt to fetch a page (non-negative integers; 0 for none)
+ *   --max-page pageKB: read no more than this many kilobytes of a page
+ *     (positive integer; default no limit)
+ *   --record archive: record every response in this archive file
+ *   --replay archive: fetch every page from this archive file instead
+ *   --adapt floor,ceiling: adapt the fetches in flight from each host
+ *     between these (1 <= floor <= ceiling); delayMillis then defaults
+ *     to 0
+ * checks 3 inputs remain after the options
+ * check indexFilename, if given, can be written
+ * open the archive to record or replay, if any
  * normalize seedURL and validate it is an internal URL
  * call pagedir_init() on pageDirectory
  * check maxDepth is a non-negative integer
  * prints error to stderr and exit 1 on invalid argument
  */
 void parseArgs(const int argc, char* argv[], char** seedURL_p,
-               char** pageDirectory_p, int* maxDepth_p)
+               char** pageDirectory_p, int* maxDepth_p, crawlOptions_t* opts)
 {
-  if (argc != 4) {
-    fprintf(stdout, "Usage: %s seedURL pageDirectory maxDepth\n", argv[0]);
+  int arg = 1;
+  bool delayGiven = false;
+  while (arg < argc && argv[arg][0] == '-' && argc - arg > 3) {
+    if (strcmp(argv[arg], "--resume") == 0) {
+      opts->resume = true;
+      arg++;
+      continue;
+    }
+    if (strcmp(argv[arg], "--recrawl") == 0) {
+      opts->recrawl = true;
+      arg++;
+      continue;
+    }
+    if (strcmp(argv[arg], "--stats") == 0) {
+      opts->stats = true;
+      arg++;
+      continue;
+    }
+    if (strcmp(argv[arg], "--links") == 0) {
+      opts->links = true;
+      arg++;
+      continue;
+    }
+    if (strcmp(argv[arg], "-i") == 0) {
+      if (!pagedir_isFileWriteable(argv[arg + 1])) {
+        fprintf(stderr, "Crawler: failed to write to %s\n", argv[arg + 1]);
+        exit(1);
+      }
+      opts->indexFilename = argv[arg + 1];
+      arg += 2;
+      continue;
+    }
+    if (strcmp(argv[arg], "--connect-to") == 0) {
+      // address:port, split at the colon
+      char* colon = arg + 1 < argc ? strrchr(argv[arg + 1], ':') : NULL;
+      int port;
+      if (colon == NULL || !str2int(colon + 1, &port)) {
+        printerrln("Crawler: --connect-to requires an address:port");
+        exit(1);
+      }
+      *colon = '\0';
+      bool valid = dnscache_connectTo(argv[arg + 1], port);
+      *colon = ':';
+      if (!valid) {
+        printerrln("Crawler: --connect-to requires an address:port");
+        exit(1);
+      }
+      arg += 2;
+      continue;
+    }
+    if (strcmp(argv[arg], "--timeouts") == 0) {
+      int connectMillis, firstByteMillis, totalMillis;
+      char extra;
+      if (arg + 1 >= argc
+          || sscanf(argv[arg + 1], "%d,%d,%d%c", &connectMillis,
+                    &firstByteMillis, &totalMillis, &extra) != 3
+          || connectMillis < 0 || firstByteMillis < 0 || totalMillis < 0) {
+        printerrln("Crawler: --timeouts requires three non-negative "
+                   "numbers of milliseconds");
+        exit(1);
+      }
+      webpage_setTimeouts(connectMillis, firstByteMillis, totalMillis);
+      arg += 2;
+      continue;
+    }
+    if (strcmp(argv[arg], "--record") == 0) {
+      opts->record = argv[arg + 1];
+      arg += 2;
+      continue;
+    }
+    if (strcmp(argv[arg], "--replay") == 0) {
+      opts->replay = argv[arg + 1];
+      arg += 2;
+      continue;
+    }
+    if (strcmp(argv[arg], "--adapt") == 0) {
+      char extra;
+      if (arg + 1 >= argc
+          || sscanf(argv[arg + 1], "%d,%d%c", &opts->adaptFloor,
+                    &opts->adaptCeiling, &extra) != 2
+          || opts->adaptFloor < 1 || opts->adaptCeiling < opts->adaptFloor) {
+        printerrln("Crawler: --adapt requires floor,ceiling with "
+                   "1 <= floor <= ceiling");
+        exit(1);
+      }
+      arg += 2;
+      continue;
+    }
+    if (strcmp(argv[arg], "--max-page") == 0) {
+      int pageKB;
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &pageKB) || pageKB < 1) {
+        printerrln("Crawler: --max-page requires a positive number of "
+                   "kilobytes");
+        exit(1);
+      }
+      webpage_setMaxBody((size_t)pageKB * 1024);
+      arg += 2;
+      continue;
+    }
+    if (strcmp(argv[arg], "-j") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->numThreads)
+          || opts->numThreads < 1) {
+        printerrln("Crawler: -j requires a positive number of threads");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-e") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->maxInFlight)
+          || opts->maxInFlight < 1) {
+        printerrln("Crawler: -e requires a positive number of fetches");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-d") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->delayMillis)
+          || opts->delayMillis < 0) {
+        printerrln("Crawler: -d requires a non-negative delay in milliseconds");
+        exit(1);
+      }
+      delayGiven = true;
+    } else if (strcmp(argv[arg], "-m") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->frontierKB)
+          || opts->frontierKB < 1) {
+        printerrln("Crawler: -m requires a positive number of kilobytes");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-c") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->checkpointSecs)
+          || opts->checkpointSecs < 0) {
+        printerrln("Crawler: -c requires a non-negative number of seconds");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-s") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->maxDistance)
+          || opts->maxDistance < 0
+          || opts->maxDistance > DUPCHECK_MAX_DISTANCE) {
+        printerrln("Crawler: -s requires a SimHash distance from 0 to 3");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-p") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->numParsers)
+          || opts->numParsers < 1) {
+        printerrln("Crawler: -p requires a positive number of parsers");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-q") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->queueDepth)
+          || opts->queueDepth < 1) {
+        printerrln("Crawler: -q requires a positive queue depth");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-P") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->numProcesses)
+          || opts->numProcesses < 1) {
+        printerrln("Crawler: -P requires a positive number of processes");
+        exit(1);
+      }
+    } else if (strcmp(argv[arg], "-f") == 0) {
+      if (arg + 1 >= argc || !str2int(argv[arg + 1], &opts->syncEvery)
+          || opts->syncEvery < 1 || opts->syncEvery > PAGEWRITER_MAX_SYNC) {
+        printerrln("Crawler: -f requires a group size from 1 to 256");
+        exit(1);
+      }
+    } else {
+      break;
+    }
+    arg += 2;
+  }
+  if (opts->numThreads > 1 && opts->maxInFlight > 0) {
+    printerrln("Crawler: -j and -e cannot be used together");
+    exit(1);
+  }
+  if (opts->resume && opts->recrawl) {
+    printerrln("Crawler: --resume and --recrawl cannot be used together");
+    exit(1);
+  }
+  if (opts->numProcesses > 1 && (opts->indexFilename != NULL
+                                 || opts->maxDistance >= 0
+                                 || opts->resume || opts->recrawl)) {
+    printerrln("Crawler: -P cannot be used with -i, -s, --resume or --recrawl");
+    exit(1);
+  }
+  if (opts->links && (opts->numProcesses > 1 || opts->resume)) {
+    printerrln("Crawler: --links cannot be used with -P or --resume");
+    exit(1);
+  }
+  if (opts->record != NULL && (opts->replay != NULL
+                               || opts->numProcesses > 1)) {
+    printerrln("Crawler: --record cannot be used with --replay or -P");
     exit(1);
   }
 
-  *seedURL_p = normalizeURL(argv[1]);
+  if (argc - arg != 3) {
+    fprintf(stdout, "Usage: %s [-j numThreads | -e maxInFlight] "
+            "[-d delayMillis] [-m frontierKB] [-c checkpointSecs] "
+            "[-s maxDistance] [-p numParsers] [-q queueDepth] "
+            "[-f syncEvery] [-i indexFilename] [-P numProcesses] "
+            "[--resume | --recrawl] [--links] "
+            "[--connect-to address:port] [--stats] "
+            "[--timeouts connectMillis,firstByteMillis,totalMillis] "
+            "[--max-page pageKB] [--record archive | --replay archive] "
+            "[--adapt floor,ceiling] seedURL pageDirectory maxDepth\n",
+            argv[0]);
+    exit(1);
+  }
+  char** inputs = &argv[arg];  // seedURL, pageDirectory, maxDepth
+
+  *seedURL_p = normalizeURL(inputs[0]);
   if (!isInternalURL(*seedURL_p)) {
     printerrln("Crawler: seedURL is not an internal URL");
     exit(1);
   }
 
-  *pageDirectory_p = argv[2];
+  *pageDirectory_p = inputs[1];
   if (!pagedir_init(*pageDirectory_p)) {
     printerrln("Crawler: pagedir_init() failed");
     exit(1);
   }
 
   // not an integer OR negative input
-  if (!str2int(argv[3], maxDepth_p) || *maxDepth_p < 0) {
+  if (!str2int(inputs[2], maxDepth_p) || *maxDepth_p < 0) {
     printerrln("Crawler: maxDepth must be a non-negative integer");
     exit(1);
   }
+
+  if (opts->record != NULL && !webpage_record(opts->record)) {
+    fprintf(stderr, "Crawler: failed to open archive %s\n", opts->record);
+    exit(1);
+  }
+  if (opts->replay != NULL) {
+    if (!webpage_replay(opts->replay)) {
+      fprintf(stderr, "Crawler: failed to read archive %s\n", opts->replay);
+      exit(1);
+    }
+    // a replay involves no server to be polite to
+    if (!delayGiven) {
+      opts->delayMillis = 0;
+    }
+  }
+  // the limit on fetches in flight paces each host instead
+  if (opts->adaptCeiling > 0 && !delayGiven) {
+    opts->delayMillis = 0;
+  }
 }
 
 /*
@@ -110,59 +641,1217 @@ bool str2int(const char* string, int* num_p)
  *   seedURL: url to start at
  *   pageDirectory: directory to save pages in
  *   maxDepth: depth to explore
+ *   opts: the options (see parseArgs()):
+ *     numThreads: number of worker threads sharing the frontier
+ *     maxInFlight: if positive, crawl with the event-driven fetcher
+ *       instead, keeping this many fetches outstanding
+ *     delayMillis: minimum time between fetches from the same host
+ *     frontierKB: if positive, spill the frontier to pageDirectory beyond
+ *       this much memory
+ *     checkpointSecs: if positive, checkpoint this often
+ *     maxDistance: if not negative, record near-duplicates as aliases
+ *       rather than saving them
+ *     numParsers: if positive, pipeline the crawl with this many parsers
+ *     queueDepth: most pages queued between pipeline stages, or waiting
+ *       to be written
+ *     syncEvery: if positive, fsync pages written in groups of this many
+ *     indexFilename: if not NULL, index the pages saved, and write the
+ *       index to this file
+ *     resume: start from the checkpoint in pageDirectory if there is one;
+ *       pages saved after it was taken are removed and crawled again
+ *     recrawl: refresh the pages already saved in pageDirectory
+ *     links: record the links between pages, and write them to
+ *       pageDirectory/.links
+ *     stats: tally the fetches, and print the tally at the end
+ *     adaptFloor, adaptCeiling: if positive, adapt the fetches in flight
+ *       from each host between these
+ *     part, partFd: if partFd is not -1, crawl only partition part of
+ *       numProcesses, as one process of a -P crawl, talking to the
+ *       coordinator over partFd; its frontier spills, and its validators
+ *       are kept, in pageDirectory/.part-<part>
  */
-void crawl(char* seedURL, char* pageDirectory, const int maxDepth)
+void crawl(char* seedURL, char* pageDirectory, const int maxDepth,
+           const crawlOptions_t* opts)
 {
-  if (seedURL == NULL || pageDirectory == NULL || maxDepth < 0) {
+  const int numThreads = opts->numThreads;
+  const int maxInFlight = opts->maxInFlight;
+  if (seedURL == NULL || pageDirectory == NULL || maxDepth < 0
+      || numThreads < 1) {
     printerrln("Failed to crawl, invalid arguments");
     exit(2);
   }
 
-  // <char* url, "" (only keys matter)>
-  hashtable_t* seen = hashtable_new(200);
-  if (seen == NULL) {
-    printerrln("Crawler: error initializing hashttable");
+  crawlState_t state = {
+    .pageDirectory = pageDirectory,
+    .maxDepth = maxDepth,
+    .active = 0,
+    .failed = false,
+    .nextDocID = 1,
+    .nextCheckpoint = -1,
+    .checkpointSecs = opts->checkpointSecs,
+  };
+  pthread_mutex_init(&state.frontierLock, NULL);
+  pthread_condattr_t condAttr;
+  pthread_condattr_init(&condAttr);
+  pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+  pthread_cond_init(&state.frontierCond, &condAttr);
+  pthread_condattr_destroy(&condAttr);
+  pthread_mutex_init(&state.seenLock, NULL);
+  pthread_mutex_init(&state.docIDLock, NULL);
+  pthread_rwlock_init(&state.pageLock, NULL);
+  pthread_mutex_init(&state.checkpointLock, NULL);
+
+  // at most one page in progress per thread, or per fetch in flight; when
+  // pipelined, also each page queued, being parsed, or being written
+  int maxActive = maxInFlight > 0 ? maxInFlight : numThreads;
+  if (opts->numParsers > 0) {
+    maxActive += 2 * opts->queueDepth + opts->numParsers + 1;
+  }
+  state.inProgress = malloc(sizeof(webpage_t*) * maxActive);
+  state.takenAt = malloc(sizeof(long) * maxActive);
+  if (state.inProgress == NULL || state.takenAt == NULL) {
+    printerrln("Crawler: error initializing frontier");
+    exit(2);
+  }
+  // a process of a -P crawl keeps its own files apart, and shares each
+  // host's politeness delay with the others
+  const bool partitioned = opts->partFd != -1;
+  char workDir[strlen(pageDirectory) + 32];
+  strcpy(workDir, pageDirectory);
+  int delayMillis = opts->delayMillis;
+  if (partitioned) {
+    sprintf(workDir, "%s/.part-%d", pageDirectory, opts->part);
+    delayMillis *= opts->numProcesses;
+  }
+  state.toVisit = hostsched_new(delayMillis, frontier_byDepth);
+  if (state.toVisit == NULL) {
+    printerrln("Crawler: error initializing frontier");
+    exit(2);
+  }
+  if (opts->adaptCeiling > 0
+      && !hostsched_adapt(state.toVisit, opts->adaptFloor,
+                          opts->adaptCeiling)) {
+    printerrln("Crawler: error initializing frontier");
+    exit(2);
+  }
+  if (opts->frontierKB > 0
+      && !hostsched_spill(state.toVisit, workDir, opts->frontierKB * 1024L)) {
+    printerrln("Crawler: error initializing frontier");
+    exit(2);
+  }
+
+  // initializing the crawling, from the checkpoint or from the seed
+  state.seen = NULL;
+  state.dupcheck = NULL;
+  state.aliases = NULL;
+  state.aliased = NULL;
+  state.changed = NULL;
+  state.known = NULL;
+  if (opts->resume) {
+    if (checkpoint_load(pageDirectory, &state.nextDocID, state.toVisit,
+                        &state.seen)) {
+      free(seedURL);
+      pagedir_trim(pageDirectory, state.nextDocID);
+    } else if (hostsched_size(state.toVisit) > 0) {
+      printerrln("Crawler: checkpoint is damaged; remove it to start over");
+      exit(2);
+    } else {
+      printerrln("Crawler: no checkpoint to resume from; starting from seedURL");
+    }
+  }
+  if (state.seen == NULL) {
+    state.seen = seenset_new(0);
+    if (state.seen == NULL) {
+      printerrln("Crawler: error initializing seen set");
+      exit(2);
+    }
+    seenset_insert(state.seen, seedURL);
+    if (partitioned
+        && partition_of(seedURL, opts->numProcesses) != opts->part) {
+      free(seedURL);
+    } else {
+      webpage_t* seedPage = webpage_new(seedURL, 0, NULL);
+      if (seedPage == NULL) {
+        printerrln("Crawler: error initializing webpage for seedURL");
+        exit(2);
+      }
+      hostsched_add(state.toVisit, seedPage);
+    }
+  }
+  if (opts->recrawl) {
+    recrawlInit(&state);
+  } else {
+    // a new crawl needs a whole new index
+    size_t dirLen = strlen(pageDirectory);
+    char changedPath[dirLen + strlen("/.changed") + 1];
+    sprintf(changedPath, "%s/.changed", pageDirectory);
+    unlink(changedPath);
+  }
+  state.validators = validators_open(workDir, state.nextDocID);
+  if (state.validators == NULL) {
+    printerrln("Crawler: error initializing validators");
     exit(2);
   }
-  // <webpage_t* page>
-  bag_t* toVisit = bag_new();
-  if (toVisit == NULL) {
-    printerrln("Crawler: error initializing bag");
+  state.index = NULL;
+  if (opts->indexFilename != NULL) {
+    indexInit(&state);
+  }
+  if (opts->maxDistance >= 0) {
+    dupcheckInit(&state, opts->maxDistance,
+                 state.nextDocID > 1 && !opts->recrawl);
+  }
+  state.links = NULL;
+  if (opts->links && (state.links = linklog_new()) == NULL) {
+    printerrln("Crawler: error initializing link graph");
     exit(2);
   }
-  webpage_t* seedPage = webpage_new(seedURL, 0, NULL);
-  if (seedPage == NULL) {
-    printerrln("Crawler: error initializing webpage for seedURL");
+  state.writer = pagewriter_new(pageDirectory, opts->queueDepth,
+                                opts->syncEvery, &state, pageWritten,
+                                pageWriteFailed);
+  if (state.writer == NULL) {
+    printerrln("Crawler: error initializing page writer");
+    exit(2);
+  }
+  state.partition = NULL;
+  state.received = 0;
+  state.reportedIdle = -1;
+  state.partitionDone = false;
+  if (partitioned) {
+    state.partition = partition_open(opts->partFd, opts->part,
+                                     opts->numProcesses, &state,
+                                     linkForwarded, partitionEnded);
+    if (state.partition == NULL) {
+      printerrln("Crawler: error connecting to the coordinator");
+      exit(2);
+    }
+  }
+  if (state.checkpointSecs > 0 && !opts->recrawl && !partitioned) {
+    state.nextCheckpoint = hostsched_now() + state.checkpointSecs * 1000L;
+  }
+
+  state.stats = NULL;
+  if (opts->stats && (state.stats = fetchstats_new()) == NULL) {
+    printerrln("Crawler: error initializing statistics");
     exit(2);
   }
+  long start = hostsched_now();
 
-  // initializing the crawling
-  hashtable_insert(seen, seedURL, "");
-  bag_insert(toVisit, seedPage);
+  // crawling; with one thread, do the work here rather than spawning
+  state.parseQueue = NULL;
+  state.writeQueue = NULL;
+  if (opts->numParsers > 0) {
+    crawlPipelined(&state, opts);
+  } else if (maxInFlight > 0) {
+    fetcher_t* fetcher = fetcher_new(maxInFlight);
+    if (fetcher == NULL) {
+      printerrln("Crawler: error initializing fetcher");
+      exit(2);
+    }
+    fetcher_run(fetcher, &state, eventNext, eventDone);
+    fetcher_delete(fetcher);
+  } else if (numThreads == 1) {
+    crawlWorker(&state);
+  } else {
+    pthread_t* workers = malloc(sizeof(pthread_t) * numThreads);
+    if (workers == NULL) {
+      printerrln("Crawler: error initializing worker threads");
+      exit(2);
+    }
+    int started = 0;
+    for (; started < numThreads; started++) {
+      if (pthread_create(&workers[started], NULL, crawlWorker, &state) != 0) {
+        break;
+      }
+    }
+    if (started == 0) {
+      printerrln("Crawler: error initializing worker threads");
+      exit(2);
+    }
+    for (int i = 0; i < started; i++) {
+      pthread_join(workers[i], NULL);
+    }
+    free(workers);
+  }
 
-  // crawling
-  int docID = 1;
+  // every page finished has been handed to the writer
+  bool saved = pagewriter_close(state.writer);
+  partition_close(state.partition);
+  if (state.stats != NULL) {
+    fetchstats_print(state.stats, stderr, hostsched_now() - start);
+    fetchstats_delete(state.stats);
+  }
+  if (!saved || state.failed) {
+    // keep the last checkpoint, so the crawl can be resumed once fixed
+    printerrln("Crawler: failed to save every page");
+    exit(3);
+  }
+  if (state.index != NULL) {
+    index_saveToFile(state.index, opts->indexFilename);
+    index_delete(state.index);
+  }
+  if (state.links != NULL) {
+    if (!linklog_save(state.links, pageDirectory, state.nextDocID - 1)) {
+      printerrln("Crawler: failed to save the link graph");
+      exit(3);
+    }
+    linklog_delete(state.links);
+  }
+
+  // clean up
+  if (state.aliases != NULL) {
+    fclose(state.aliases);
+  }
+  if (state.changed != NULL) {
+    fclose(state.changed);
+  }
+  validators_close(state.validators);
+  hashtable_delete(state.known, free);
+  dupcheck_delete(state.dupcheck);
+  checkpoint_remove(pageDirectory);
+  if (!webpage_fetchCleanup()) {
+    printerrln("Crawler: failed to save the archive");
+    exit(3);
+  }
+  seenset_delete(state.seen);
+  seenset_delete(state.aliased);
+  hostsched_delete(state.toVisit, webpage_delete);
+  free(state.inProgress);
+  free(state.takenAt);
+  pthread_mutex_destroy(&state.frontierLock);
+  pthread_cond_destroy(&state.frontierCond);
+  pthread_mutex_destroy(&state.seenLock);
+  pthread_mutex_destroy(&state.docIDLock);
+  pthread_rwlock_destroy(&state.pageLock);
+  pthread_mutex_destroy(&state.checkpointLock);
+}
+
+/*
+ * Crawls as crawl() does, but split across opts->numProcesses processes,
+ * each crawling one partition of the URLs (see partition.h), while this
+ * one coordinates them. Once they are all done, renumbers the pages
+ * saved so their docIDs have no gaps. Exits 2 on error, or with the
+ * status of a process that failed.
+ */
+static void crawlPartitioned(char* seedURL, char* pageDirectory,
+                             const int maxDepth, const crawlOptions_t* opts)
+{
+  const int numProcesses = opts->numProcesses;
+  int fds[numProcesses];          // the coordinator's end of each socket
+  int workerFds[numProcesses];    // each process's end
+  for (int i = 0; i < numProcesses; i++) {
+    char workDir[strlen(pageDirectory) + 32];
+    sprintf(workDir, "%s/.part-%d", pageDirectory, i);
+    int pair[2];
+    if ((mkdir(workDir, 0755) != 0 && access(workDir, W_OK | X_OK) != 0)
+        || socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+      printerrln("Crawler: error initializing processes");
+      exit(2);
+    }
+    fds[i] = pair[0];
+    workerFds[i] = pair[1];
+  }
+
+  // don't let each process print what is still buffered here
+  fflush(stdout);
+  pid_t pids[numProcesses];
+  for (int i = 0; i < numProcesses; i++) {
+    pids[i] = fork();
+    if (pids[i] == -1) {
+      printerrln("Crawler: error initializing processes");
+      exit(2);
+    }
+    if (pids[i] == 0) {
+      for (int j = 0; j < numProcesses; j++) {
+        close(fds[j]);
+        if (j != i) {
+          close(workerFds[j]);
+        }
+      }
+      crawlOptions_t workerOpts = *opts;
+      workerOpts.part = i;
+      workerOpts.partFd = workerFds[i];
+      crawl(seedURL, pageDirectory, maxDepth, &workerOpts);
+      exit(0);
+    }
+  }
+  for (int i = 0; i < numProcesses; i++) {
+    close(workerFds[i]);
+  }
+  free(seedURL);
+
+  int lastDocID;
+  bool coordinated = partition_coordinate(fds, numProcesses, &lastDocID);
+  int status = 0;
+  for (int i = 0; i < numProcesses; i++) {
+    int wstatus;
+    if (waitpid(pids[i], &wstatus, 0) == -1 || !WIFEXITED(wstatus)) {
+      status = 3;
+    } else if (WEXITSTATUS(wstatus) > status) {
+      status = WEXITSTATUS(wstatus);
+    }
+  }
+  if (!coordinated || status != 0) {
+    printerrln("Crawler: a process of the crawl failed");
+    exit(status != 0 ? status : 3);
+  }
+  if (partition_compact(pageDirectory, numProcesses, lastDocID) < 0) {
+    printerrln("Crawler: failed to renumber the pages saved");
+    exit(3);
+  }
+}
+
+/*
+ * Runs the crawl as a pipeline: fetchers, as many as -j or -e give, then
+ * opts->numParsers parser threads, then one writer thread, with a queue
+ * of at most opts->queueDepth pages between each stage and the next.
+ * Each stage ends once the one before it has and its queue is drained;
+ * then prints the queues' statistics. Exits 2 on error.
+ */
+static void crawlPipelined(crawlState_t* state, const crawlOptions_t* opts)
+{
+  state->parseQueue = workqueue_new(opts->queueDepth);
+  state->writeQueue = workqueue_new(opts->queueDepth);
+  pthread_t* parsers = malloc(sizeof(pthread_t) * opts->numParsers);
+  if (state->parseQueue == NULL || state->writeQueue == NULL
+      || parsers == NULL) {
+    printerrln("Crawler: error initializing pipeline");
+    exit(2);
+  }
+  int numFetchers = opts->maxInFlight > 0 ? 0 : opts->numThreads;
+  pthread_t* fetchers = malloc(sizeof(pthread_t) * (numFetchers + 1));
+  pthread_t writer;
+  if (fetchers == NULL
+      || pthread_create(&writer, NULL, writeWorker, state) != 0) {
+    printerrln("Crawler: error initializing pipeline");
+    exit(2);
+  }
+  int parsersStarted = 0;
+  for (; parsersStarted < opts->numParsers; parsersStarted++) {
+    if (pthread_create(&parsers[parsersStarted], NULL, parseWorker,
+                       state) != 0) {
+      break;
+    }
+  }
+  if (parsersStarted == 0) {
+    printerrln("Crawler: error initializing pipeline");
+    exit(2);
+  }
+
+  // the fetch stage; with one fetcher, it runs here
+  if (opts->maxInFlight > 0) {
+    fetcher_t* fetcher = fetcher_new(opts->maxInFlight);
+    if (fetcher == NULL) {
+      printerrln("Crawler: error initializing fetcher");
+      exit(2);
+    }
+    fetcher_run(fetcher, state, eventNext, eventDone);
+    fetcher_delete(fetcher);
+  } else if (numFetchers == 1) {
+    crawlWorker(state);
+  } else {
+    int started = 0;
+    for (; started < numFetchers; started++) {
+      if (pthread_create(&fetchers[started], NULL, crawlWorker, state) != 0) {
+        break;
+      }
+    }
+    if (started == 0) {
+      printerrln("Crawler: error initializing worker threads");
+      exit(2);
+    }
+    for (int i = 0; i < started; i++) {
+      pthread_join(fetchers[i], NULL);
+    }
+  }
+
+  workqueue_close(state->parseQueue);
+  for (int i = 0; i < parsersStarted; i++) {
+    pthread_join(parsers[i], NULL);
+  }
+  workqueue_close(state->writeQueue);
+  pthread_join(writer, NULL);
+
+  fprintf(stderr, "%-8s %8s %8s %10s %9s %11s %12s\n", "queue", "capacity",
+          "puts", "mean depth", "max depth", "put wait ms", "take wait ms");
+  printQueueStats("parse", state->parseQueue);
+  printQueueStats("write", state->writeQueue);
+
+  // every page the fetchers took has been finished, so both are empty
+  workqueue_delete(state->parseQueue, NULL);
+  workqueue_delete(state->writeQueue, NULL);
+  state->parseQueue = NULL;
+  state->writeQueue = NULL;
+  free(fetchers);
+  free(parsers);
+}
+
+/*
+ * Prints one line of the table of queue statistics. A queue that ran
+ * near capacity, with its producers waiting on puts, is held back by the
+ * stage after it; one that ran near empty, with its consumers waiting on
+ * takes, by the stage before it.
+ */
+static void printQueueStats(const char* name, workqueue_t* queue)
+{
+  workqueueStats_t stats;
+  workqueue_stats(queue, &stats);
+  fprintf(stderr, "%-8s %8d %8ld %10.2f %9d %11ld %12ld\n", name,
+          stats.capacity, stats.puts, stats.meanDepth, stats.maxDepth,
+          stats.putWaitMillis, stats.takeWaitMillis);
+}
+
+/*
+ * Body of each crawler thread: repeatedly take a page from the frontier,
+ * fetch it, save it under a fresh docID, and scan it for more pages,
+ * until the frontier is empty and no other thread is still working.
+ * When pipelined, saving and scanning are left to the later stages.
+ * 
+ * Input:
+ *   arg: the shared crawlState_t*
+ */
+static void* crawlWorker(void* arg)
+{
+  crawlState_t* state = arg;
   webpage_t* page;
-  while ((page = bag_extract(toVisit)) != NULL) {
-    if (!webpage_fetch(page)) {
-      webpage_delete(page);
-      continue;
+  while ((page = frontierTake(state)) != NULL) {
+    setValidators(state, page);
+    fetchDone(state, page, webpage_fetch(page));
+  }
+  return NULL;
+}
+
+/*
+ * Passes on a page taken from the frontier once its fetch is over: when
+ * pipelined, a page fetched goes to the parsers, and one not fetched is
+ * done with; else crawlPage() finishes it here.
+ */
+static void fetchDone(crawlState_t* state, webpage_t* page, const bool fetched)
+{
+  long millis = frontierFetched(state, page);
+  if (state->stats != NULL) {
+    const char* html = webpage_getHTML(page);
+    fetchstats_add(state->stats, millis, fetched && html ? strlen(html) : 0,
+                   fetched);
+  }
+  if (state->parseQueue == NULL) {
+    crawlPage(state, page, fetched);
+    return;
+  }
+  if (fetched) {
+    logr("Fetched", webpage_getDepth(page), webpage_getURL(page));
+    if (workqueue_put(state->parseQueue, page)) {
+      return;
     }
+  }
+  frontierDone(state, page);
+  webpage_delete(page);
+}
+
+/*
+ * Finishes a page taken from the frontier: if it was fetched, scan it for
+ * more pages and save it (see savePage()). Marks it done in the frontier,
+ * and checkpoints the crawl if one is due.
+ * 
+ * Inputs:
+ *   state: the shared crawl state
+ *   page: the page, with its html if fetched (and changed); it is deleted
+ *     here or by the page writer
+ *   fetched: whether the fetch succeeded
+ */
+static void crawlPage(crawlState_t* state, webpage_t* page, bool fetched)
+{
+  pthread_rwlock_rdlock(&state->pageLock);
+  if (fetched) {
     logr("Fetched", webpage_getDepth(page), webpage_getURL(page));
-    if (!pagedir_save(page, pageDirectory, docID)) {
-      printerrln("Crawler: pagedir_save() failed");
-      exit(3);
+    fetched = loadUnchanged(state, page);
+  }
+  if (fetched) {
+    if ((webpage_getDepth(page) < state->maxDepth || state->links != NULL)
+        && webpage_getHTML(page) != NULL) {
+      pageScan(page, state);
+    }
+  }
+  // before saving, which gives the page away
+  frontierDone(state, page);
+  if (fetched) {
+    savePage(state, page);
+  } else {
+    webpage_delete(page);
+  }
+  pthread_rwlock_unlock(&state->pageLock);
+  checkpoint(state);
+}
+
+/*
+ * Body of each parser thread, when pipelined: scans each fetched page
+ * for more pages, then passes it to the writer, until the fetchers are
+ * done and parseQueue is drained
+ * 
+ * Input:
+ *   arg: the shared crawlState_t*
+ */
+static void* parseWorker(void* arg)
+{
+  crawlState_t* state = arg;
+  webpage_t* page;
+  while ((page = workqueue_take(state->parseQueue)) != NULL) {
+    pthread_rwlock_rdlock(&state->pageLock);
+    bool fetched = loadUnchanged(state, page);
+    if (fetched
+        && (webpage_getDepth(page) < state->maxDepth || state->links != NULL)
+        && webpage_getHTML(page) != NULL) {
+      pageScan(page, state);
+    }
+    pthread_rwlock_unlock(&state->pageLock);
+
+    // not holding pageLock, which the writer may need to make room
+    if (!fetched || !workqueue_put(state->writeQueue, page)) {
+      frontierDone(state, page);
+      webpage_delete(page);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Body of the writer thread, when pipelined: gives each scanned page its
+ * docID and hands it to the page writer, marks it done in the frontier,
+ * and checkpoints the crawl if one is due, until the parsers are done
+ * and writeQueue is drained
+ * 
+ * Input:
+ *   arg: the shared crawlState_t*
+ */
+static void* writeWorker(void* arg)
+{
+  crawlState_t* state = arg;
+  webpage_t* page;
+  while ((page = workqueue_take(state->writeQueue)) != NULL) {
+    pthread_rwlock_rdlock(&state->pageLock);
+    frontierDone(state, page);
+    savePage(state, page);
+    pthread_rwlock_unlock(&state->pageLock);
+    checkpoint(state);
+  }
+  return NULL;
+}
+
+/*
+ * Saves a fetched page, in the background, under a fresh docID, unless
+ * it duplicates a page saved already, or under its old one if recrawling
+ * a page saved before. The page goes to the page writer, which records
+ * it once written (see pageWritten()), or else is deleted here.
+ */
+static void savePage(crawlState_t* state, webpage_t* page)
+{
+  int docID = knownDocID(state, page);
+  if (docID > 0) {
+    refreshPage(state, page, docID);
+    return;
+  }
+  if ((docID = allocDocID(state, page)) == 0) {
+    logr("Dupl", webpage_getDepth(page), webpage_getURL(page));
+    webpage_delete(page);
+    return;
+  }
+  pagewriter_put(state->writer, page, docID);
+}
+
+/*
+ * donefunc for the page writer: indexes and records a page once it is
+ * saved
+ */
+static void pageWritten(void* arg, const webpage_t* page, int docID)
+{
+  indexPage(arg, page, docID);
+  recordPage(arg, page, docID, true);
+}
+
+/*
+ * failfunc for the page writer: reports the page that could not be
+ * saved, and stops the crawl
+ */
+static void pageWriteFailed(void* arg, int docID, int err)
+{
+  fprintf(stderr, "Crawler: failed to save page %d: %s\n", docID,
+          strerror(err));
+  crawlFailed(arg);
+}
+
+/*
+ * Stops every worker after a page could not be saved; crawl() reports
+ * the failure
+ */
+static void crawlFailed(crawlState_t* state)
+{
+  pthread_mutex_lock(&state->frontierLock);
+  state->failed = true;
+  pthread_cond_broadcast(&state->frontierCond);
+  pthread_mutex_unlock(&state->frontierLock);
+}
+
+/*
+ * nextfunc for fetcher_run(): the next page in the frontier, if any.
+ * Never waits, since the pages still in flight belong to this thread;
+ * instead tells the fetcher when the next host becomes ready.
+ */
+static webpage_t* eventNext(void* arg, long* waitMillis)
+{
+  webpage_t* page = frontierTryTake(arg, waitMillis);
+  if (page != NULL) {
+    setValidators(arg, page);
+  }
+  return page;
+}
+
+/*
+ * donefunc for fetcher_run(): save and scan the page, or pass it to the
+ * parsers when pipelined
+ */
+static void eventDone(void* arg, webpage_t* page, bool success)
+{
+  fetchDone(arg, page, success);
+}
+
+/*
+ * Takes the next page to crawl, waiting while no host is ready yet, or
+ * while the frontier is empty but other threads may still add to it.
+ * 
+ * Returns:
+ *   the next page, which the caller must later pass to frontierDone()
+ *   NULL once the crawl is finished (or has failed)
+ */
+static webpage_t* frontierTake(crawlState_t* state)
+{
+  pthread_mutex_lock(&state->frontierLock);
+  webpage_t* page = NULL;
+  while (!state->failed) {
+    long waitMillis;
+    page = hostsched_take(state->toVisit, &waitMillis);
+    if (page != NULL) {
+      break;
+    }
+    if (waitMillis < 0 && state->active == 0) {
+      // finished, unless other processes may still forward links here
+      if (state->partition == NULL || state->partitionDone) {
+        break;
+      }
+      if (frontierIdle(state)) {
+        // frontierLock was let go, so look again before waiting
+        continue;
+      }
     }
-    if (webpage_getDepth(page) < maxDepth) {
-      pageScan(page, toVisit, seen);
+    if (waitMillis < 0) {
+      pthread_cond_wait(&state->frontierCond, &state->frontierLock);
+    } else {
+      // sleep until the next host is ready, or until woken by a new page
+      struct timespec deadline;
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += waitMillis / 1000;
+      deadline.tv_nsec += (waitMillis % 1000) * 1000000L;
+      if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&state->frontierCond, &state->frontierLock,
+                             &deadline);
     }
+  }
+  if (state->failed) {
+    page = NULL;
+  }
+  if (page != NULL) {
+    state->takenAt[state->active] = hostsched_now();
+    state->inProgress[state->active++] = page;
+  }
+  pthread_mutex_unlock(&state->frontierLock);
+  return page;
+}
+
+/*
+ * Like frontierTake(), but returns NULL rather than waiting when no host
+ * is ready; then sets *waitMillis as hostsched_take() does. With -P, an
+ * idle process asks to be called again shortly, to take any links other
+ * processes have forwarded, until the coordinator ends the crawl.
+ */
+static webpage_t* frontierTryTake(crawlState_t* state, long* waitMillis)
+{
+  pthread_mutex_lock(&state->frontierLock);
+  webpage_t* page = NULL;
+  *waitMillis = -1;
+  if (!state->failed) {
+    page = hostsched_take(state->toVisit, waitMillis);
+  }
+  if (page == NULL && !state->failed && *waitMillis < 0
+      && state->active == 0 && state->partition != NULL
+      && !state->partitionDone) {
+    frontierIdle(state);
+    *waitMillis = IDLE_POLL_MILLIS;
+  }
+  if (page != NULL) {
+    state->takenAt[state->active] = hostsched_now();
+    state->inProgress[state->active++] = page;
+  }
+  pthread_mutex_unlock(&state->frontierLock);
+  return page;
+}
+
+/*
+ * Adds a page to the frontier and wakes a waiting thread
+ */
+static void frontierAdd(crawlState_t* state, webpage_t* page)
+{
+  pthread_mutex_lock(&state->frontierLock);
+  if (!hostsched_add(state->toVisit, page)) {
     webpage_delete(page);
-    docID++;
   }
+  pthread_cond_signal(&state->frontierCond);
+  pthread_mutex_unlock(&state->frontierLock);
+}
 
-  // clean up
-  hashtable_delete(seen, NULL);
-  bag_delete(toVisit, webpage_delete);
+/*
+ * Tells the frontier a page in progress has been fetched, or failed to
+ * be, so its host may be fetched from again (see hostsched_done()), and
+ * wakes the threads waiting if it may. The host is taken to have failed
+ * only if it sent no response, or a 5xx or 429; a 404, or a page that is
+ * not HTML, was answered as it should be.
+ *
+ * Returns:
+ *   milliseconds since the page was taken from the frontier
+ */
+static long frontierFetched(crawlState_t* state, webpage_t* page)
+{
+  int status = webpage_getStatus(page);
+  bool healthy = status != 0 && status < 500 && status != 429;
+  long now = hostsched_now();
+  long takenAt = now;
+  pthread_mutex_lock(&state->frontierLock);
+  for (int i = 0; i < state->active; i++) {
+    if (state->inProgress[i] == page) {
+      takenAt = state->takenAt[i];
+      break;
+    }
+  }
+  if (hostsched_done(state->toVisit, webpage_getURL(page), now - takenAt,
+                     healthy)) {
+    pthread_cond_broadcast(&state->frontierCond);
+  }
+  pthread_mutex_unlock(&state->frontierLock);
+  return now - takenAt;
+}
+
+/*
+ * Marks a page taken with frontierTake() as finished; if that was the
+ * last page in progress, wakes every thread so they can exit
+ */
+static void frontierDone(crawlState_t* state, webpage_t* page)
+{
+  pthread_mutex_lock(&state->frontierLock);
+  for (int i = 0; i < state->active; i++) {
+    if (state->inProgress[i] == page) {
+      state->inProgress[i] = state->inProgress[state->active - 1];
+      state->takenAt[i] = state->takenAt[state->active - 1];
+      break;
+    }
+  }
+  state->active--;
+  if (state->active == 0) {
+    pthread_cond_broadcast(&state->frontierCond);
+  }
+  pthread_mutex_unlock(&state->frontierLock);
+}
+
+/*
+ * With -P, reports this process idle to the coordinator, unless it has
+ * already been with every link forwarded so far. Called holding
+ * frontierLock, which is let go while the report is sent.
+ * 
+ * Returns:
+ *   true if a report was sent
+ */
+static bool frontierIdle(crawlState_t* state)
+{
+  if (state->received == state->reportedIdle) {
+    return false;
+  }
+  long received = state->received;
+  state->reportedIdle = received;
+  pthread_mutex_unlock(&state->frontierLock);
+  partition_idle(state->partition, received);
+  pthread_mutex_lock(&state->frontierLock);
+  return true;
+}
+
+/*
+ * urlfunc for the partition, with -P: adds a link another process found
+ * in this one's partition to the frontier, unless already seen, and
+ * counts it either way
+ */
+static void linkForwarded(void* arg, const char* url, int depth)
+{
+  crawlState_t* state = arg;
+  pthread_mutex_lock(&state->seenLock);
+  bool isNew = seenset_insert(state->seen, url);
+  pthread_mutex_unlock(&state->seenLock);
+
+  webpage_t* page = NULL;
+  if (isNew) {
+    char* copy = strdup(url);
+    page = copy ? webpage_new(copy, depth, NULL) : NULL;
+    if (page == NULL) {
+      free(copy);
+    }
+    logr("Received", depth, url);
+  }
+  pthread_mutex_lock(&state->frontierLock);
+  if (page != NULL && !hostsched_add(state->toVisit, page)) {
+    webpage_delete(page);
+  }
+  state->received++;
+  pthread_cond_signal(&state->frontierCond);
+  pthread_mutex_unlock(&state->frontierLock);
+}
+
+/*
+ * endfunc for the partition, with -P: wakes every thread to finish once
+ * the coordinator ends the crawl, or stops the crawl if the coordinator
+ * is lost
+ */
+static void partitionEnded(void* arg, bool finished)
+{
+  crawlState_t* state = arg;
+  if (!finished) {
+    pthread_mutex_lock(&state->frontierLock);
+    bool failed = state->failed;
+    pthread_mutex_unlock(&state->frontierLock);
+    if (!failed) {
+      printerrln("Crawler: lost the coordinator");
+    }
+    crawlFailed(state);
+    return;
+  }
+  pthread_mutex_lock(&state->frontierLock);
+  state->partitionDone = true;
+  pthread_cond_broadcast(&state->frontierCond);
+  pthread_mutex_unlock(&state->frontierLock);
+}
+
+/*
+ * Checkpoints the crawl if it is time to. Only one thread checkpoints at
+ * a time; any others arriving meanwhile carry on without waiting.
+ * Finishing pages waits while the checkpoint is written, but fetching
+ * does not.
+ */
+static void checkpoint(crawlState_t* state)
+{
+  if (pthread_mutex_trylock(&state->checkpointLock) != 0) {
+    return;
+  }
+  long now = hostsched_now();
+  if (state->nextCheckpoint < 0 || now < state->nextCheckpoint) {
+    pthread_mutex_unlock(&state->checkpointLock);
+    return;
+  }
+
+  // no page can be finishing, and so none can be adding to the seen
+  // set or taking a docID, while we hold pageLock for writing; the pages
+  // finished must be on disk before the checkpoint counts them saved
+  pthread_rwlock_wrlock(&state->pageLock);
+  bool saved = pagewriter_sync(state->writer);
+  pthread_mutex_lock(&state->frontierLock);
+  if (state->aliases != NULL) {
+    fflush(state->aliases);
+  }
+  validators_flush(state->validators);
+  if (!saved || !checkpoint_save(state->pageDirectory, state->nextDocID,
+                                 state->inProgress, state->active,
+                                 state->toVisit, state->seen)) {
+    printerrln("Crawler: failed to write checkpoint");
+  }
+  pthread_mutex_unlock(&state->frontierLock);
+  pthread_rwlock_unlock(&state->pageLock);
+
+  state->nextCheckpoint = hostsched_now() + state->checkpointSecs * 1000L;
+  pthread_mutex_unlock(&state->checkpointLock);
+}
+
+/*
+ * Hands out the next docID; called once per successfully fetched page,
+ * so docIDs are unique and have no gaps. With -P, they come from the
+ * ranges the coordinator hands this process instead, and the gaps are
+ * closed once the crawl is over. When checking for duplicates,
+ * a page that duplicates one already saved gets no docID; it is written
+ * to the alias file instead, unless its URL is listed there already (a
+ * resumed crawl fetches again the pages it fetched after the checkpoint).
+ * 
+ * Returns:
+ *   the page's docID, or 0 if it is a duplicate
+ */
+static int allocDocID(crawlState_t* state, const webpage_t* page)
+{
+  pageprint_t print = { 0, 0, 0 };
+  if (state->dupcheck != NULL) {
+    dupcheck_print(webpage_getHTML(page), &print);
+  }
+
+  pthread_mutex_lock(&state->docIDLock);
+  int docID = 0;
+  int original = dupcheck_find(state->dupcheck, &print);
+  if (original > 0) {
+    if (state->aliases != NULL
+        && seenset_insert(state->aliased, webpage_getURL(page))) {
+      fprintf(state->aliases, "%d %s\n", original, webpage_getURL(page));
+    }
+    linklog_addDoc(state->links, webpage_getURL(page), original);
+  } else {
+    // 0 only if the coordinator is lost, which stops the crawl
+    docID = state->partition ? partition_allocDocID(state->partition)
+                             : state->nextDocID++;
+    dupcheck_add(state->dupcheck, &print, docID);
+  }
+  pthread_mutex_unlock(&state->docIDLock);
+  return docID;
+}
+
+/*
+ * Sets up a recrawl: reads the URL of each page already saved, so a page
+ * found again keeps its docID, and opens the list of changed pages.
+ * The pages saved before are numbered 1 up, with no gaps, so new ones
+ * are numbered after the last. Exits 2 on error.
+ */
+static void recrawlInit(crawlState_t* state)
+{
+  state->known = hashtable_new(1000);
+  if (state->known == NULL) {
+    printerrln("Crawler: error initializing recrawl");
+    exit(2);
+  }
+  char* url;
+  while ((url = pagedir_loadUrlFromFile(state->pageDirectory,
+                                        state->nextDocID)) != NULL) {
+    int* docID = malloc(sizeof(int));
+    if (docID == NULL) {
+      printerrln("Crawler: error initializing recrawl");
+      exit(2);
+    }
+    *docID = state->nextDocID++;
+    if (!hashtable_insert(state->known, url, docID)) {
+      free(docID);
+    }
+    free(url);
+  }
+
+  // appended to, so pages changed by a recrawl that died are still
+  // listed; `indexer --update` removes the list once it has used it
+  size_t dirLen = strlen(state->pageDirectory);
+  char path[dirLen + strlen("/.changed") + 1];
+  sprintf(path, "%s/.changed", state->pageDirectory);
+  state->changed = fopen(path, "a");
+  if (state->changed == NULL) {
+    printerrln("Crawler: error opening list of changed pages");
+    exit(2);
+  }
+}
+
+/*
+ * Returns the docID of a page saved before, when recrawling, or 0
+ */
+static int knownDocID(crawlState_t* state, const webpage_t* page)
+{
+  if (state->known == NULL) {
+    return 0;
+  }
+  int* docID = hashtable_find(state->known, webpage_getURL(page));
+  return docID ? *docID : 0;
+}
+
+/*
+ * When recrawling a page saved before, gives it the validators it was
+ * saved with, so webpage_fetch() asks for it only if it has changed
+ */
+static void setValidators(crawlState_t* state, webpage_t* page)
+{
+  int docID = knownDocID(state, page);
+  if (docID > 0) {
+    const char* etag;
+    const char* lastModified;
+    pthread_mutex_lock(&state->docIDLock);
+    if (validators_get(state->validators, docID, &etag, &lastModified)) {
+      webpage_setValidators(page, etag, lastModified);
+    }
+    pthread_mutex_unlock(&state->docIDLock);
+  }
+}
+
+/*
+ * When recrawling, gives a page the server says is unchanged the html
+ * saved for it before, so it can still be scanned. If that html can't
+ * be read back, the page is fetched again, unconditionally, and so saved
+ * again as changed.
+ *
+ * Returns:
+ *   false if the page had to be fetched again, and that failed
+ */
+static bool loadUnchanged(crawlState_t* state, webpage_t* page)
+{
+  int docID = knownDocID(state, page);
+  if (docID == 0 || !webpage_isNotModified(page)) {
+    return true;
+  }
+  webpage_t* old = pagedir_loadPageFromFile(state->pageDirectory, docID);
+  char* html = old ? strdup(webpage_getHTML(old)) : NULL;
+  webpage_delete(old);
+  if (html != NULL && webpage_setHTML(page, html, strlen(html))) {
+    return true;
+  }
+  free(html);
+  logr("Refetch", webpage_getDepth(page), webpage_getURL(page));
+  return webpage_setValidators(page, NULL, NULL) && webpage_fetch(page);
+}
+
+/*
+ * Finishes fetching a page saved before, as docID, when recrawling. A
+ * page the server says is unchanged, or whose html is what was saved,
+ * keeps its file, and is deleted; a changed page goes to the page writer
+ * to replace it, and is listed as changed once it has.
+ */
+static void refreshPage(crawlState_t* state, webpage_t* page, const int docID)
+{
+  bool changed = true;
+  if (webpage_isNotModified(page)) {
+    changed = false;
+  } else {
+    webpage_t* old = pagedir_loadPageFromFile(state->pageDirectory, docID);
+    if (old != NULL
+        && strcmp(webpage_getHTML(old), webpage_getHTML(page)) == 0) {
+      changed = false;
+    }
+    webpage_delete(old);
+  }
+
+  logr(changed ? "Changed" : "Same", webpage_getDepth(page),
+       webpage_getURL(page));
+  if (changed) {
+    pagewriter_put(state->writer, page, docID);
+  } else {
+    recordPage(state, page, docID, false);
+    webpage_delete(page);
+  }
+}
+
+/*
+ * Records the validators of a page saved (or found unchanged) as docID,
+ * and its docID for the link graph, with --links; when recrawling, lists
+ * it if it is new or changed
+ */
+static void recordPage(crawlState_t* state, const webpage_t* page,
+                       const int docID, const bool changed)
+{
+  pthread_mutex_lock(&state->docIDLock);
+  validators_put(state->validators, docID, webpage_getETag(page),
+                 webpage_getLastModified(page));
+  if (changed && state->changed != NULL) {
+    fprintf(state->changed, "%d\n", docID);
+  }
+  linklog_addDoc(state->links, webpage_getURL(page), docID);
+  pthread_mutex_unlock(&state->docIDLock);
+}
+
+/*
+ * Sets up the index, with -i: on a resumed crawl or a recrawl, the pages
+ * already saved are indexed first. Exits 2 on error.
+ */
+static void indexInit(crawlState_t* state)
+{
+  state->index = index_new();
+  if (state->index == NULL) {
+    printerrln("Crawler: error initializing index");
+    exit(2);
+  }
+  for (int docID = 1; docID < state->nextDocID; docID++) {
+    webpage_t* page = pagedir_loadPageFromFile(state->pageDirectory, docID);
+    if (page != NULL) {
+      index_addPage(state->index, page, docID);
+      webpage_delete(page);
+    }
+  }
+}
+
+/*
+ * Adds the words in a page saved as docID to the index, with -i; a page
+ * saved before, when recrawling, has its old words removed first. Runs
+ * on the page writer's thread, once the page is written, so the crawl
+ * never waits on it.
+ */
+static void indexPage(crawlState_t* state, const webpage_t* page,
+                      const int docID)
+{
+  if (state->index == NULL) {
+    return;
+  }
+  if (knownDocID(state, page) > 0) {
+    index_removeDoc(state->index, docID);
+  }
+  index_addPage(state->index, page, docID);
+}
+
+/*
+ * Sets up duplicate checking. On a resumed crawl, the pages already
+ * saved are printed again, and the alias file loses the lines written
+ * after the checkpoint: those naming a docID that has since been
+ * removed, and repeats of a URL already listed (each URL is fetched
+ * once, so a repeat means it was fetched again after resuming). The URLs
+ * listed are kept, so those fetched again do not repeat in it either.
+ * Exits 2 on error.
+ */
+static void dupcheckInit(crawlState_t* state, const int maxDistance,
+                         const bool resumed)
+{
+  state->dupcheck = dupcheck_new(maxDistance);
+  if (state->dupcheck == NULL) {
+    printerrln("Crawler: error initializing duplicate check");
+    exit(2);
+  }
+  for (int docID = 1; docID < state->nextDocID; docID++) {
+    webpage_t* page = pagedir_loadPageFromFile(state->pageDirectory, docID);
+    if (page != NULL) {
+      pageprint_t print;
+      dupcheck_print(webpage_getHTML(page), &print);
+      dupcheck_add(state->dupcheck, &print, docID);
+      webpage_delete(page);
+    }
+  }
+
+  size_t dirLen = strlen(state->pageDirectory);
+  char path[dirLen + strlen("/.aliases.tmp") + 1];
+  char tmpPath[dirLen + strlen("/.aliases.tmp") + 1];
+  sprintf(path, "%s/.aliases", state->pageDirectory);
+  sprintf(tmpPath, "%s/.aliases.tmp", state->pageDirectory);
+  state->aliases = fopen(tmpPath, "w");
+  state->aliased = seenset_new(0);
+  if (state->aliases == NULL || state->aliased == NULL) {
+    printerrln("Crawler: error creating alias file");
+    exit(2);
+  }
+
+  FILE* old = resumed ? fopen(path, "r") : NULL;
+  if (old != NULL) {
+    char* line;
+    while ((line = file_readLine(old)) != NULL) {
+      int docID, urlStart;
+      if (sscanf(line, "%d %n", &docID, &urlStart) == 1
+          && docID > 0 && docID < state->nextDocID
+          && seenset_insert(state->aliased, line + urlStart)) {
+        fprintf(state->aliases, "%s\n", line);
+      }
+      free(line);
+    }
+    fclose(old);
+  }
+  if (fflush(state->aliases) != 0 || rename(tmpPath, path) != 0) {
+    printerrln("Crawler: error creating alias file");
+    exit(2);
+  }
 }
 
 /*
@@ -178,40 +1867,98 @@ static void logr(const char* word, const int depth, const char* url)
 }
 
 /*
- * Scans `page` for links, and adds any new pages to crawl into `pagesToCrawl`
- * Updates `pagesSeen` to visit each URL once
+ * Scans `page` for links, and adds any new pages to crawl into the frontier
+ * Updates the seen set to visit each URL once
+ * 
+ * With --links, records the page's internal links, in batches; a page
+ * at maxDepth is scanned only for them.
  * 
  * Inputs:
  *   page: webpage_t* that stores the HTML to scan
- *   pagesToCrawl: stores pages to crawl
- *   pagesSeen: stores visited URLs
+ *   state: shared crawl state holding the frontier and seen set
  */
-static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen)
+static void pageScan(webpage_t* page, crawlState_t* state)
 {
-  if (page == NULL || pagesToCrawl == NULL || pagesSeen == NULL) {
+  if (page == NULL || state == NULL) {
     return;
   }
 
   logr("Scanning", webpage_getDepth(page), webpage_getURL(page));
   int pos = 0, curDepth = webpage_getDepth(page);
-  char* nextURL;
-  while ((nextURL = webpage_getNextURL(page, &pos)) != NULL) {
-    char* normalizedURL = normalizeURL(nextURL);
-    free(nextURL);
-    // skip external or visited URLs
-    logr("Found", curDepth, normalizedURL);
-    if (!isInternalURL(normalizedURL)) {
-      logr("IgnExtrn", curDepth, normalizedURL);
-      free(normalizedURL);
-      continue;
-    } 
-    if (!hashtable_insert(pagesSeen, normalizedURL, "")) {
-      logr("IgnDupl", curDepth, normalizedURL);
-      free(normalizedURL);
-      continue;
+  bool follow = curDepth < state->maxDepth;
+  char* urls[SCAN_BATCH];
+  uint64_t prints[SCAN_BATCH];
+  int numURLs;
+  char stackURL[URL_BUF];
+  while ((numURLs = webpage_getURLs(page, &pos, urls, SCAN_BATCH)) > 0) {
+    int numPrints = 0;
+    for (int i = 0; i < numURLs; i++) {
+      // skip external URLs before normalizing them, and normalize the
+      // rest on the stack, unless too long for it: only a URL added to
+      // the frontier is copied
+      size_t size = strlen(urls[i]) + 1;
+      char* normalizedURL = NULL;
+      if (mayBeInternalURL(urls[i])) {
+        normalizedURL = size <= URL_BUF ? stackURL : malloc(size);
+      }
+      if (normalizedURL == NULL
+          || !normalizeURLInto(urls[i], normalizedURL, size)
+          || !isInternalURL(normalizedURL)) {
+        logr("IgnExtrn", curDepth, urls[i]);
+        if (normalizedURL != stackURL) {
+          free(normalizedURL);
+        }
+        free(urls[i]);
+        continue;
+      }
+      free(urls[i]);
+      logr("Found", curDepth, normalizedURL);
+      if (state->links != NULL) {
+        prints[numPrints++] = seenset_fingerprint(normalizedURL);
+      }
+      if (follow) {
+        followLink(state, normalizedURL, curDepth + 1);
+      }
+      if (normalizedURL != stackURL) {
+        free(normalizedURL);
+      }
+    }
+    if (numPrints > 0) {
+      pthread_mutex_lock(&state->docIDLock);
+      linklog_addLinks(state->links, webpage_getURL(page), prints, numPrints);
+      pthread_mutex_unlock(&state->docIDLock);
     }
-    webpage_t* nextPage = webpage_new(normalizedURL, curDepth + 1, NULL);
-    logr("Added", curDepth, webpage_getURL(nextPage));
-    bag_insert(pagesToCrawl, nextPage);
   }
 }
+
+/*
+ * Adds the page at normalized internal URL url, found at depth - 1, to
+ * the frontier, unless it has been seen before; with -P, a page another
+ * process owns is forwarded to it instead
+ */
+static void followLink(crawlState_t* state, const char* url, const int depth)
+{
+  // skip visited URLs
+  pthread_mutex_lock(&state->seenLock);
+  bool isNew = seenset_insert(state->seen, url);
+  pthread_mutex_unlock(&state->seenLock);
+  if (!isNew) {
+    logr("IgnDupl", depth - 1, url);
+    return;
+  }
+  // with -P, the seen set also keeps the links forwarded, so each is
+  // forwarded once
+  if (state->partition != NULL && !partition_owns(state->partition, url)) {
+    logr("Forward", depth - 1, url);
+    partition_forward(state->partition, url, depth);
+    return;
+  }
+  char* copy = strdup(url);
+  webpage_t* nextPage = copy ? webpage_new(copy, depth, NULL) : NULL;
+  if (nextPage == NULL) {
+    free(copy);
+    return;
+  }
+  logr("Added", depth - 1, webpage_getURL(nextPage));
+  frontierAdd(state, nextPage);
+}
@@ -0,0 +1,234 @@
+/*
+ * dupcheck.c    Hugo Fang    2/27/2024
+ *
+ * See dupcheck.h for details
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "dupcheck.h"
+
+/* Local types */
+typedef struct entry {
+  pageprint_t print;
+  int docID;
+  // next entry with the same value in each block, or -1
+  int next[4];
+} entry_t;
+
+/* Public types */
+typedef struct dupcheck {
+  int maxDistance;
+  // entries[0..size), in the order added
+  entry_t* entries;
+  int size;
+  int capacity;
+  // for each block b, heads[b][value] is the most recent entry whose
+  // key (see keyOf) has block b equal to value, or -1
+  int* heads[4];
+} dupcheck_t;
+
+/* Local constants */
+static const int NUM_BLOCKS = 4;
+static const int BLOCK_VALUES = 1 << 16;
+static const int MIN_WORD = 3;      // shorter words don't count toward SimHash
+
+/* Private function prototypes */
+static uint64_t keyOf(const dupcheck_t* dc, const pageprint_t* print);
+static int blockOf(const uint64_t key, const int b);
+static int bitsDiffering(uint64_t a, uint64_t b);
+static uint64_t mix(uint64_t h);
+
+/* Public functions */
+void dupcheck_print(const char* html, pageprint_t* print)
+{
+  // each bit of the SimHash is the sign of the sum, over the words, of
+  // +1 or -1 as that bit of the word's hash is set or not
+  int weights[64] = { 0 };
+  uint64_t exact = 14695981039346656037ULL;
+  bool inTag = false;
+  uint64_t word = 14695981039346656037ULL;
+  int wordLen = 0;
+  int numWords = 0;
+
+  for (const unsigned char* p = (const unsigned char*)html; ; p++) {
+    if (*p != '\0') {
+      exact = (exact ^ *p) * 1099511628211ULL;
+    }
+    if (*p == '<') {
+      inTag = true;
+    }
+    if (!inTag && isalpha(*p)) {
+      word = (word ^ tolower(*p)) * 1099511628211ULL;
+      wordLen++;
+    } else {
+      if (wordLen >= MIN_WORD) {
+        uint64_t h = mix(word);
+        for (int bit = 0; bit < 64; bit++) {
+          weights[bit] += ((h >> bit) & 1) ? 1 : -1;
+        }
+        numWords++;
+      }
+      word = 14695981039346656037ULL;
+      wordLen = 0;
+    }
+    if (*p == '>') {
+      inTag = false;
+    }
+    if (*p == '\0') {
+      break;
+    }
+  }
+
+  print->exact = exact;
+  print->numWords = numWords;
+  print->simhash = 0;
+  for (int bit = 0; bit < 64; bit++) {
+    if (weights[bit] > 0) {
+      print->simhash |= 1ULL << bit;
+    }
+  }
+}
+
+dupcheck_t* dupcheck_new(const int maxDistance)
+{
+  if (maxDistance < 0 || maxDistance > DUPCHECK_MAX_DISTANCE) {
+    return NULL;
+  }
+  dupcheck_t* dc = malloc(sizeof(dupcheck_t));
+  if (dc == NULL) {
+    return NULL;
+  }
+  dc->maxDistance = maxDistance;
+  dc->size = 0;
+  dc->capacity = 64;
+  dc->entries = malloc(sizeof(entry_t) * dc->capacity);
+  // one allocation holds all four head arrays
+  dc->heads[0] = malloc(sizeof(int) * BLOCK_VALUES * NUM_BLOCKS);
+  if (dc->entries == NULL || dc->heads[0] == NULL) {
+    free(dc->entries);
+    free(dc->heads[0]);
+    free(dc);
+    return NULL;
+  }
+  for (int b = 1; b < NUM_BLOCKS; b++) {
+    dc->heads[b] = dc->heads[0] + b * BLOCK_VALUES;
+  }
+  for (int i = 0; i < BLOCK_VALUES * NUM_BLOCKS; i++) {
+    dc->heads[0][i] = -1;
+  }
+  return dc;
+}
+
+int dupcheck_find(const dupcheck_t* dc, const pageprint_t* print)
+{
+  if (dc == NULL || print == NULL) {
+    return 0;
+  }
+  // an exact duplicate has the same key, so it is in every block's
+  // chain; if only exact duplicates count, one block's chain is enough
+  bool near = dc->maxDistance > 0 && print->numWords >= DUPCHECK_MIN_WORDS;
+  int blocks = near ? NUM_BLOCKS : 1;
+  uint64_t key = keyOf(dc, print);
+  for (int b = 0; b < blocks; b++) {
+    int i = dc->heads[b][blockOf(key, b)];
+    for (; i >= 0; i = dc->entries[i].next[b]) {
+      const pageprint_t* saved = &dc->entries[i].print;
+      if (saved->exact == print->exact
+          || (near && saved->numWords >= DUPCHECK_MIN_WORDS
+              && bitsDiffering(saved->simhash, print->simhash)
+                 <= dc->maxDistance)) {
+        return dc->entries[i].docID;
+      }
+    }
+  }
+  return 0;
+}
+
+bool dupcheck_add(dupcheck_t* dc, const pageprint_t* print, const int docID)
+{
+  if (dc == NULL || print == NULL || docID <= 0) {
+    return false;
+  }
+  if (dc->size == dc->capacity) {
+    entry_t* entries = realloc(dc->entries,
+                               sizeof(entry_t) * dc->capacity * 2);
+    if (entries == NULL) {
+      return false;
+    }
+    dc->entries = entries;
+    dc->capacity *= 2;
+  }
+  int i = dc->size++;
+  entry_t* entry = &dc->entries[i];
+  entry->print = *print;
+  entry->docID = docID;
+  uint64_t key = keyOf(dc, print);
+  for (int b = 0; b < NUM_BLOCKS; b++) {
+    int value = blockOf(key, b);
+    entry->next[b] = dc->heads[b][value];
+    dc->heads[b][value] = i;
+  }
+  return true;
+}
+
+void dupcheck_delete(dupcheck_t* dc)
+{
+  if (dc != NULL) {
+    free(dc->entries);
+    free(dc->heads[0]);
+    free(dc);
+  }
+}
+
+/*
+ * Returns the key a page is chained under: its SimHash if it can match
+ * by SimHash, else its exact hash. A page that can only match exactly
+ * is then found by that, and the many empty or tiny pages, whose
+ * SimHash is 0 or close to it, don't all share one chain.
+ */
+static uint64_t keyOf(const dupcheck_t* dc, const pageprint_t* print)
+{
+  if (dc->maxDistance > 0 && print->numWords >= DUPCHECK_MIN_WORDS) {
+    return print->simhash;
+  }
+  return print->exact;
+}
+
+/*
+ * Returns 16-bit block b (0-3) of a key
+ */
+static int blockOf(const uint64_t key, const int b)
+{
+  return (key >> (16 * b)) & 0xffff;
+}
+
+/*
+ * Returns the Hamming distance between a and b
+ */
+static int bitsDiffering(uint64_t a, uint64_t b)
+{
+  int count = 0;
+  for (uint64_t x = a ^ b; x != 0; x &= x - 1) {
+    count++;
+  }
+  return count;
+}
+
+/*
+ * Spreads a word's FNV-1a hash over all 64 bits, since SimHash needs
+ * each bit to be set for about half of all words
+ */
+static uint64_t mix(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
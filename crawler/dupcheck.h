@@ -0,0 +1,94 @@
+/*
+ * dupcheck.h - header file for dupcheck.c
+ *
+ * Finds pages whose content duplicates, or nearly duplicates, a page
+ * already saved. Each page is summarized by a pageprint: a 64-bit hash
+ * of its exact HTML, and a 64-bit SimHash of the words in its text
+ * (outside tags). Pages whose text is mostly the same have SimHashes
+ * that differ in only a few bits, so a page is a near-duplicate of a
+ * saved one if their SimHashes are within maxDistance bits. Short pages
+ * have too few words for their SimHash to mean much, so a page with
+ * fewer than DUPCHECK_MIN_WORDS words only ever matches exactly.
+ *
+ * Lookups use the pigeonhole trick: the SimHash is split into four
+ * 16-bit blocks, and two SimHashes within 3 bits of each other must
+ * agree on at least one block, so only pages sharing a block are
+ * compared. That is why maxDistance is at most 3. A page that can only
+ * match exactly is filed by the blocks of its exact hash instead, so
+ * empty pages, which all have a SimHash of 0, are not all compared.
+ *
+ * Not thread-safe: callers sharing a dupcheck must hold a lock.
+ *
+ * Hugo Fang, 2/27/2024
+ */
+
+#ifndef __DUPCHECK_H__
+#define __DUPCHECK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Public types */
+typedef struct dupcheck dupcheck_t;
+
+typedef struct pageprint {
+  uint64_t exact;     // hash of the whole HTML
+  uint64_t simhash;   // SimHash of the words in the text
+  int numWords;       // number of words that went into simhash
+} pageprint_t;
+
+/* Largest maxDistance dupcheck_new() accepts */
+#define DUPCHECK_MAX_DISTANCE 3
+
+/* Fewest words a page needs to be matched by SimHash */
+#define DUPCHECK_MIN_WORDS 50
+
+/*
+ * Compute the pageprint of a page's HTML
+ *
+ * Input:
+ *   html: the page's HTML (not NULL)
+ *   print: where to store the result
+ */
+void dupcheck_print(const char* html, pageprint_t* print);
+
+/*
+ * Allocate and initialize an empty dupcheck
+ *
+ * Input:
+ *   maxDistance: how many SimHash bits two pages may differ in and still
+ *     count as duplicates, 0 to DUPCHECK_MAX_DISTANCE; 0 means only pages
+ *     with exactly the same HTML count
+ *
+ * Returns:
+ *   pointer to new dupcheck_t, or NULL if maxDistance is out of range or
+ *   on memory allocation failure
+ *
+ * Caller is responsible for calling dupcheck_delete() on the returned pointer
+ */
+dupcheck_t* dupcheck_new(const int maxDistance);
+
+/*
+ * Find a saved page that the page with this print duplicates
+ *
+ * Returns:
+ *   the docID given to that page in dupcheck_add(), or 0 if none
+ */
+int dupcheck_find(const dupcheck_t* dc, const pageprint_t* print);
+
+/*
+ * Record a saved page's print under its docID (> 0)
+ *
+ * Returns:
+ *   false if any argument is invalid or on memory allocation failure
+ */
+bool dupcheck_add(dupcheck_t* dc, const pageprint_t* print, const int docID);
+
+/*
+ * Delete a dupcheck created by dupcheck_new()
+ */
+void dupcheck_delete(dupcheck_t* dc);
+
+#endif // __DUPCHECK_H__
@@ -0,0 +1,131 @@
+/*
+ * fetchstats.c    Hugo Fang    3/3/2024
+ *
+ * See fetchstats.h for details
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "fetchstats.h"
+
+/* Public types */
+typedef struct fetchstats {
+  // millis[0..size): the time of every fetch, in the order recorded
+  long* millis;
+  int size;
+  int capacity;
+  int failed;
+  double bytes;
+  pthread_mutex_t lock;
+} fetchstats_t;
+
+/* Private function prototypes */
+static int compareLongs(const void* a, const void* b);
+static long percentile(const long* sorted, const int size, const int pct);
+
+/* Public functions */
+fetchstats_t* fetchstats_new(void)
+{
+  fetchstats_t* fs = malloc(sizeof(fetchstats_t));
+  if (fs == NULL) {
+    return NULL;
+  }
+  fs->capacity = 1024;
+  fs->millis = malloc(sizeof(long) * fs->capacity);
+  if (fs->millis == NULL) {
+    free(fs);
+    return NULL;
+  }
+  fs->size = 0;
+  fs->failed = 0;
+  fs->bytes = 0;
+  pthread_mutex_init(&fs->lock, NULL);
+  return fs;
+}
+
+void fetchstats_add(fetchstats_t* fs, const long millis, const size_t bytes,
+                    const bool fetched)
+{
+  if (fs == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&fs->lock);
+  if (fs->size == fs->capacity) {
+    long* grown = realloc(fs->millis, sizeof(long) * fs->capacity * 2);
+    if (grown != NULL) {
+      fs->millis = grown;
+      fs->capacity *= 2;
+    }
+  }
+  // a fetch that doesn't fit still counts, but has no time
+  if (fs->size < fs->capacity) {
+    fs->millis[fs->size++] = millis;
+  }
+  fs->bytes += bytes;
+  if (!fetched) {
+    fs->failed++;
+  }
+  pthread_mutex_unlock(&fs->lock);
+}
+
+void fetchstats_print(fetchstats_t* fs, FILE* fp, const long elapsedMillis)
+{
+  if (fs == NULL || fp == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&fs->lock);
+  int size = fs->size;
+  long* sorted = malloc(sizeof(long) * (size > 0 ? size : 1));
+  if (sorted != NULL) {
+    memcpy(sorted, fs->millis, sizeof(long) * size);
+    qsort(sorted, size, sizeof(long), compareLongs);
+  }
+  double secs = (elapsedMillis > 0 ? elapsedMillis : 1) / 1000.0;
+  fprintf(fp, "fetches: %d (%d failed) in %.2f s\n", size, fs->failed,
+          elapsedMillis / 1000.0);
+  fprintf(fp, "pages/sec: %.1f\n", (size - fs->failed) / secs);
+  fprintf(fp, "bytes/sec: %.0f\n", fs->bytes / secs);
+  if (sorted != NULL) {
+    fprintf(fp, "latency ms: p50 %ld p90 %ld p99 %ld max %ld\n",
+            percentile(sorted, size, 50), percentile(sorted, size, 90),
+            percentile(sorted, size, 99), size > 0 ? sorted[size - 1] : 0);
+  }
+  pthread_mutex_unlock(&fs->lock);
+  free(sorted);
+}
+
+void fetchstats_delete(fetchstats_t* fs)
+{
+  if (fs != NULL) {
+    pthread_mutex_destroy(&fs->lock);
+    free(fs->millis);
+    free(fs);
+  }
+}
+
+/*
+ * Compares two longs; for qsort()
+ */
+static int compareLongs(const void* a, const void* b)
+{
+  long x = *(const long*)a;
+  long y = *(const long*)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Returns the pct-th percentile of size sorted values (nearest rank), or
+ * 0 if there are none
+ */
+static long percentile(const long* sorted, const int size, const int pct)
+{
+  if (size == 0) {
+    return 0;
+  }
+  int rank = (size * pct + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
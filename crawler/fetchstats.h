@@ -0,0 +1,61 @@
+/*
+ * fetchstats.h - header file for fetchstats.c
+ *
+ * Tallies the crawler's fetches, for measuring its throughput: how many
+ * pages were fetched and how many bytes they held, and how long each
+ * fetch took, reported as pages and bytes per second of crawling and as
+ * percentiles of the fetch times.
+ *
+ * Thread-safe.
+ *
+ * Hugo Fang, 3/3/2024
+ */
+
+#ifndef __FETCHSTATS_H__
+#define __FETCHSTATS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* Public types */
+typedef struct fetchstats fetchstats_t;
+
+/*
+ * Allocate and initialize an empty tally
+ *
+ * Returns:
+ *   pointer to new fetchstats_t, or NULL on memory allocation failure
+ *
+ * Caller is responsible for calling fetchstats_delete() on the returned
+ * pointer
+ */
+fetchstats_t* fetchstats_new(void);
+
+/*
+ * Record one fetch
+ *
+ * Input:
+ *   millis: how long the fetch took
+ *   bytes: size of the page fetched (0 if none)
+ *   fetched: whether the fetch succeeded
+ */
+void fetchstats_add(fetchstats_t* fs, const long millis, const size_t bytes,
+                    const bool fetched);
+
+/*
+ * Print the tally to fp, as rates over elapsedMillis of crawling:
+ *
+ *   fetches: N (F failed) in S s
+ *   pages/sec: P
+ *   bytes/sec: B
+ *   latency ms: p50 A p90 B p99 C max D
+ */
+void fetchstats_print(fetchstats_t* fs, FILE* fp, const long elapsedMillis);
+
+/*
+ * Delete a tally created by fetchstats_new()
+ */
+void fetchstats_delete(fetchstats_t* fs);
+
+#endif // __FETCHSTATS_H__
@@ -0,0 +1,520 @@
+/*
+ * frontier.c    Hugo Fang    2/24/2024
+ *
+ * See frontier.h for details
+ */
+
+#define _POSIX_C_SOURCE 200809L   // strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// libcs50.a
+#include "webpage.h"
+
+#include "frontier.h"
+
+/* Local types */
+typedef struct entry {
+  webpage_t* page;
+  // insertion order, to break ties first in, first out
+  unsigned long seq;
+} entry_t;
+
+/*
+ * Pages spilled to disk. Each segment file holds up to SEGMENT_RECORDS
+ * records of (int32 depth, uint32 length, URL bytes without the '\0');
+ * the writer appends to segment writeSeg while the reader consumes
+ * segment readSeg, so readSeg <= writeSeg.
+ */
+typedef struct spill {
+  char* prefix;
+  long* memUsed;
+  long memBudget;
+  FILE* writer;
+  int writeSeg;
+  int writeCount;
+  FILE* reader;
+  int readSeg;
+  int numSpilled;
+} spill_t;
+
+/* Public types */
+typedef struct frontier {
+  // min-heap of pages in crawl order
+  entry_t* heap;
+  int size;
+  int capacity;
+  unsigned long nextSeq;
+  frontier_compare_t compare;
+  // NULL unless frontier_spill() was called
+  spill_t* spill;
+} frontier_t;
+
+/* Local constants */
+static const int SEGMENT_RECORDS = 65536;
+// rough bytes per page in memory besides its URL: the webpage_t, the
+// heap entry, and malloc overhead on both allocations
+static const long PAGE_OVERHEAD = 64;
+
+/* Private function prototypes */
+static bool heapInsert(frontier_t* frontier, webpage_t* page);
+static long pageCost(const webpage_t* page);
+static bool spillWrite(spill_t* spill, const webpage_t* page);
+static webpage_t* spillRead(spill_t* spill);
+static webpage_t* recordRead(FILE* fp, bool* ok);
+static FILE* segmentOpen(const spill_t* spill, const int seg, const char* mode);
+static void segmentRemove(const spill_t* spill, const int seg);
+static void segmentTruncate(const spill_t* spill, const int seg,
+                            const long length);
+static bool before(const frontier_t* frontier, const int i, const int j);
+static void siftUp(frontier_t* frontier, int i);
+static void siftDown(frontier_t* frontier, int i);
+
+/* Public functions */
+frontier_t* frontier_new(frontier_compare_t compare)
+{
+  frontier_t* frontier = malloc(sizeof(frontier_t));
+  if (frontier == NULL) {
+    return NULL;
+  }
+  frontier->capacity = 16;
+  frontier->heap = malloc(sizeof(entry_t) * frontier->capacity);
+  if (frontier->heap == NULL) {
+    free(frontier);
+    return NULL;
+  }
+  frontier->size = 0;
+  frontier->nextSeq = 0;
+  frontier->compare = compare;
+  frontier->spill = NULL;
+  return frontier;
+}
+
+bool frontier_spill(frontier_t* frontier, const char* pathPrefix,
+                    long* memUsed, const long memBudget)
+{
+  if (frontier == NULL || pathPrefix == NULL || memUsed == NULL
+      || memBudget <= 0 || frontier->spill != NULL || frontier->size > 0) {
+    return false;
+  }
+  spill_t* spill = malloc(sizeof(spill_t));
+  if (spill == NULL) {
+    return false;
+  }
+  spill->prefix = strdup(pathPrefix);
+  if (spill->prefix == NULL) {
+    free(spill);
+    return false;
+  }
+  spill->memUsed = memUsed;
+  spill->memBudget = memBudget;
+  spill->writer = NULL;
+  spill->writeSeg = 0;
+  spill->writeCount = 0;
+  spill->reader = NULL;
+  spill->readSeg = 0;
+  spill->numSpilled = 0;
+  frontier->spill = spill;
+  return true;
+}
+
+bool frontier_insert(frontier_t* frontier, webpage_t* page)
+{
+  if (frontier == NULL || page == NULL) {
+    return false;
+  }
+  spill_t* spill = frontier->spill;
+  if (spill == NULL) {
+    return heapInsert(frontier, page);
+  }
+
+  // once anything is on disk, everything after it goes there too, so
+  // pages come back in the order they arrived
+  long cost = pageCost(page);
+  if (spill->numSpilled > 0 || *spill->memUsed + cost > spill->memBudget) {
+    if (spillWrite(spill, page)) {
+      webpage_delete(page);
+      return true;
+    }
+    // can't write to disk: go over budget rather than lose the page
+  }
+  if (!heapInsert(frontier, page)) {
+    return false;
+  }
+  *spill->memUsed += cost;
+  return true;
+}
+
+webpage_t* frontier_extract(frontier_t* frontier)
+{
+  if (frontier == NULL) {
+    return NULL;
+  }
+  spill_t* spill = frontier->spill;
+  if (spill != NULL && frontier->size == 0) {
+    // refill from disk up to half the budget, leaving room for new pages
+    webpage_t* page;
+    while (spill->numSpilled > 0
+           && (frontier->size == 0 || *spill->memUsed < spill->memBudget / 2)
+           && (page = spillRead(spill)) != NULL) {
+      if (!heapInsert(frontier, page)) {
+        webpage_delete(page);
+        break;
+      }
+      *spill->memUsed += pageCost(page);
+    }
+  }
+  if (frontier->size == 0) {
+    return NULL;
+  }
+  webpage_t* page = frontier->heap[0].page;
+  frontier->size--;
+  if (frontier->size > 0) {
+    frontier->heap[0] = frontier->heap[frontier->size];
+    siftDown(frontier, 0);
+  }
+  if (spill != NULL) {
+    *spill->memUsed -= pageCost(page);
+  }
+  return page;
+}
+
+int frontier_size(const frontier_t* frontier)
+{
+  if (frontier == NULL) {
+    return 0;
+  }
+  return frontier->size + (frontier->spill ? frontier->spill->numSpilled : 0);
+}
+
+bool frontier_iterate(frontier_t* frontier, void* arg,
+                      void (*itemfunc)(void* arg, const webpage_t* page))
+{
+  if (frontier == NULL || itemfunc == NULL) {
+    return false;
+  }
+  for (int i = 0; i < frontier->size; i++) {
+    (*itemfunc)(arg, frontier->heap[i].page);
+  }
+
+  spill_t* spill = frontier->spill;
+  if (spill == NULL || spill->numSpilled == 0) {
+    return true;
+  }
+  if (spill->writer != NULL && fflush(spill->writer) != 0) {
+    return false;
+  }
+  // the unread part of readSeg, then every later segment
+  int seen = 0;
+  for (int seg = spill->readSeg; seg <= spill->writeSeg; seg++) {
+    FILE* fp = segmentOpen(spill, seg, "r");
+    if (fp == NULL) {
+      break;
+    }
+    if (seg == spill->readSeg && spill->reader != NULL
+        && fseek(fp, ftell(spill->reader), SEEK_SET) != 0) {
+      fclose(fp);
+      break;
+    }
+    bool ok = true;
+    webpage_t* page;
+    while ((page = recordRead(fp, &ok)) != NULL) {
+      (*itemfunc)(arg, page);
+      webpage_delete(page);
+      seen++;
+    }
+    fclose(fp);
+    if (!ok) {
+      break;
+    }
+  }
+  return seen == spill->numSpilled;
+}
+
+void frontier_delete(frontier_t* frontier, void (*itemdelete)(void* item))
+{
+  if (frontier == NULL) {
+    return;
+  }
+  spill_t* spill = frontier->spill;
+  if (spill != NULL) {
+    for (int i = 0; i < frontier->size; i++) {
+      *spill->memUsed -= pageCost(frontier->heap[i].page);
+    }
+    if (spill->reader != NULL) {
+      fclose(spill->reader);
+    }
+    if (spill->writer != NULL) {
+      fclose(spill->writer);
+    }
+    for (int seg = spill->readSeg; seg <= spill->writeSeg; seg++) {
+      segmentRemove(spill, seg);
+    }
+    free(spill->prefix);
+    free(spill);
+  }
+  if (itemdelete != NULL) {
+    for (int i = 0; i < frontier->size; i++) {
+      (*itemdelete)(frontier->heap[i].page);
+    }
+  }
+  free(frontier->heap);
+  free(frontier);
+}
+
+int frontier_byDepth(const webpage_t* a, const webpage_t* b)
+{
+  return webpage_getDepth(a) - webpage_getDepth(b);
+}
+
+/*
+ * Adds a page to the heap, growing the heap array if needed
+ */
+static bool heapInsert(frontier_t* frontier, webpage_t* page)
+{
+  if (frontier->size == frontier->capacity) {
+    entry_t* heap = realloc(frontier->heap,
+                            sizeof(entry_t) * frontier->capacity * 2);
+    if (heap == NULL) {
+      return false;
+    }
+    frontier->heap = heap;
+    frontier->capacity *= 2;
+  }
+  entry_t* entry = &frontier->heap[frontier->size];
+  entry->page = page;
+  entry->seq = frontier->nextSeq++;
+  siftUp(frontier, frontier->size++);
+  return true;
+}
+
+/*
+ * Estimates the memory a page in the heap takes up
+ */
+static long pageCost(const webpage_t* page)
+{
+  return PAGE_OVERHEAD + strlen(webpage_getURL(page)) + 1;
+}
+
+/*
+ * Appends a page's depth and URL to the current segment, starting a new
+ * segment when it is full. If the record can't be written, the segment
+ * is cut back to where the record began and closed, so no torn record
+ * is ever read back, and the next page goes to a new segment
+ *
+ * Returns false if the record could not be written
+ */
+static bool spillWrite(spill_t* spill, const webpage_t* page)
+{
+  if (spill->writer != NULL && spill->writeCount == SEGMENT_RECORDS) {
+    fclose(spill->writer);
+    spill->writer = NULL;
+    spill->writeSeg++;
+    spill->writeCount = 0;
+  }
+  if (spill->writer == NULL) {
+    spill->writer = segmentOpen(spill, spill->writeSeg, "w");
+    if (spill->writer == NULL) {
+      return false;
+    }
+  }
+
+  const char* url = webpage_getURL(page);
+  int32_t depth = webpage_getDepth(page);
+  uint32_t len = strlen(url);
+  long start = ftell(spill->writer);
+  if (fwrite(&depth, sizeof(depth), 1, spill->writer) != 1
+      || fwrite(&len, sizeof(len), 1, spill->writer) != 1
+      || fwrite(url, 1, len, spill->writer) != len) {
+    fclose(spill->writer);
+    spill->writer = NULL;
+    segmentTruncate(spill, spill->writeSeg, start);
+    spill->writeSeg++;
+    spill->writeCount = 0;
+    return false;
+  }
+  spill->writeCount++;
+  spill->numSpilled++;
+  return true;
+}
+
+/*
+ * Reads back the oldest spilled page, removing each segment once it has
+ * all been read. If the writer is still appending to the segment to be
+ * read, that segment is closed first and new pages go to the next one.
+ *
+ * Returns:
+ *   a new webpage_t, or NULL if a segment could not be read; the pages
+ *   still on disk are then given up for lost
+ */
+static webpage_t* spillRead(spill_t* spill)
+{
+  while (spill->numSpilled > 0) {
+    if (spill->reader == NULL) {
+      if (spill->readSeg == spill->writeSeg && spill->writer != NULL) {
+        fclose(spill->writer);
+        spill->writer = NULL;
+        spill->writeSeg++;
+        spill->writeCount = 0;
+      }
+      spill->reader = segmentOpen(spill, spill->readSeg, "r");
+      if (spill->reader == NULL) {
+        break;
+      }
+    }
+
+    bool ok = true;
+    webpage_t* page = recordRead(spill->reader, &ok);
+    if (page != NULL) {
+      spill->numSpilled--;
+      return page;
+    }
+    if (!ok) {
+      break;
+    }
+    // end of this segment
+    fclose(spill->reader);
+    spill->reader = NULL;
+    segmentRemove(spill, spill->readSeg++);
+    if (spill->readSeg > spill->writeSeg) {
+      break;
+    }
+  }
+
+  spill->numSpilled = 0;
+  return NULL;
+}
+
+/*
+ * Reads one (depth, length, URL) record written by spillWrite()
+ *
+ * Returns:
+ *   a new webpage_t, or NULL at the end of the file or on error; *ok is
+ *   set false on error. A record cut short by the end of the file, as
+ *   when a failed write lost some of what stdio had buffered, ends the
+ *   file like any other end
+ */
+static webpage_t* recordRead(FILE* fp, bool* ok)
+{
+  int32_t depth;
+  uint32_t len;
+  if (fread(&depth, sizeof(depth), 1, fp) != 1) {
+    *ok = !ferror(fp);
+    return NULL;
+  }
+  char* url;
+  if (fread(&len, sizeof(len), 1, fp) != 1) {
+    *ok = !ferror(fp);
+    return NULL;
+  }
+  if ((url = malloc(len + 1)) == NULL) {
+    *ok = false;
+    return NULL;
+  }
+  if (fread(url, 1, len, fp) != len) {
+    *ok = !ferror(fp);
+    free(url);
+    return NULL;
+  }
+  url[len] = '\0';
+  return webpage_new(url, depth, NULL);
+}
+
+/*
+ * Opens segment file <prefix>.<seg> with the given fopen() mode
+ */
+static FILE* segmentOpen(const spill_t* spill, const int seg, const char* mode)
+{
+  char path[strlen(spill->prefix) + 16];
+  sprintf(path, "%s.%d", spill->prefix, seg);
+  return fopen(path, mode);
+}
+
+/*
+ * Removes segment file <prefix>.<seg>, if it exists
+ */
+static void segmentRemove(const spill_t* spill, const int seg)
+{
+  char path[strlen(spill->prefix) + 16];
+  sprintf(path, "%s.%d", spill->prefix, seg);
+  unlink(path);
+}
+
+/*
+ * Cuts segment file <prefix>.<seg> back to length bytes, if it is longer
+ */
+static void segmentTruncate(const spill_t* spill, const int seg,
+                            const long length)
+{
+  char path[strlen(spill->prefix) + 16];
+  sprintf(path, "%s.%d", spill->prefix, seg);
+  struct stat st;
+  if (length >= 0 && stat(path, &st) == 0 && st.st_size > length) {
+    truncate(path, length);
+  }
+}
+
+/*
+ * Returns true if heap[i] should leave the frontier before heap[j]
+ */
+static bool before(const frontier_t* frontier, const int i, const int j)
+{
+  const entry_t* a = &frontier->heap[i];
+  const entry_t* b = &frontier->heap[j];
+  if (frontier->compare != NULL) {
+    int order = (*frontier->compare)(a->page, b->page);
+    if (order != 0) {
+      return order < 0;
+    }
+  }
+  return a->seq < b->seq;
+}
+
+/*
+ * Moves heap[i] up until its parent comes before it
+ */
+static void siftUp(frontier_t* frontier, int i)
+{
+  entry_t* heap = frontier->heap;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!before(frontier, i, parent)) {
+      break;
+    }
+    entry_t tmp = heap[i];
+    heap[i] = heap[parent];
+    heap[parent] = tmp;
+    i = parent;
+  }
+}
+
+/*
+ * Moves heap[i] down until it comes before both of its children
+ */
+static void siftDown(frontier_t* frontier, int i)
+{
+  entry_t* heap = frontier->heap;
+  while (true) {
+    int first = i;
+    int left = 2 * i + 1, right = 2 * i + 2;
+    if (left < frontier->size && before(frontier, left, first)) {
+      first = left;
+    }
+    if (right < frontier->size && before(frontier, right, first)) {
+      first = right;
+    }
+    if (first == i) {
+      break;
+    }
+    entry_t tmp = heap[i];
+    heap[i] = heap[first];
+    heap[first] = tmp;
+    i = first;
+  }
+}
@@ -0,0 +1,135 @@
+/*
+ * frontier.h - header file for frontier.c
+ *
+ * Priority queue of pages waiting to be crawled. Pages are kept in a
+ * binary heap stored in one growable array, so queueing a page does not
+ * allocate a node for it. The order is set by a comparison function;
+ * pages that compare equal come out in the order they went in, so with
+ * frontier_byDepth() the crawl is breadth-first.
+ *
+ * A frontier may also be given a memory budget (frontier_spill()). Pages
+ * that arrive while it is over budget are written, as compact records of
+ * depth and URL, to append-only segment files on disk, and read back in
+ * the order they were written once the pages in memory run out. Pages
+ * that went to disk are then handed out after every page that was in
+ * memory, so the order is only approximately the compare function's;
+ * for a breadth-first crawl, where pages arrive in order of depth, it
+ * is the same.
+ *
+ * Not thread-safe: callers sharing a frontier must hold a lock.
+ *
+ * Hugo Fang, 2/24/2024
+ */
+
+#ifndef __FRONTIER_H__
+#define __FRONTIER_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// libcs50
+#include "webpage.h"
+
+/* Public types */
+typedef struct frontier frontier_t;
+
+/*
+ * Order in which pages leave a frontier: returns negative if page a
+ * should be crawled before page b, positive if after, 0 if either will do
+ */
+typedef int (*frontier_compare_t)(const webpage_t* a, const webpage_t* b);
+
+/*
+ * Allocate and initialize an empty frontier
+ *
+ * Input:
+ *   compare: the order to hand out pages in; NULL for first in, first out
+ *
+ * Returns:
+ *   pointer to new frontier_t, or NULL on any error
+ *
+ * Caller is responsible for calling frontier_delete() on the returned pointer
+ */
+frontier_t* frontier_new(frontier_compare_t compare);
+
+/*
+ * Keep the frontier's pages within a memory budget, spilling the rest
+ * to segment files named <pathPrefix>.<n>
+ *
+ * Input:
+ *   frontier: an empty frontier
+ *   pathPrefix: where to put segment files; copied
+ *   memUsed: running estimate of bytes held in memory, which the
+ *     frontier adds its pages to; several frontiers may share one
+ *     counter (and the budget) if they are used under one lock
+ *   memBudget: spill once *memUsed would go above this many bytes (> 0)
+ *
+ * Returns:
+ *   true on success, false if any argument is invalid or the frontier
+ *   is not empty
+ *
+ * Segment files are removed as they are read back, and any left over by
+ * frontier_delete()
+ */
+bool frontier_spill(frontier_t* frontier, const char* pathPrefix,
+                    long* memUsed, const long memBudget);
+
+/*
+ * Queue a page
+ *
+ * Input:
+ *   frontier: the frontier
+ *   page: webpage_t* to hold until frontier_extract() returns it; if it
+ *     is spilled to disk it is deleted with webpage_delete(), and a new
+ *     webpage_t with the same URL and depth is returned in its place
+ *
+ * Returns:
+ *   true if queued, false if any argument is NULL or on memory
+ *   allocation failure (the page is then still the caller's)
+ */
+bool frontier_insert(frontier_t* frontier, webpage_t* page);
+
+/*
+ * Remove and return the first page in the frontier's order, which now
+ * belongs to the caller; NULL if the frontier is empty or NULL, or if a
+ * spilled page could not be read back
+ */
+webpage_t* frontier_extract(frontier_t* frontier);
+
+/*
+ * Returns the number of pages queued, in memory and spilled
+ */
+int frontier_size(const frontier_t* frontier);
+
+/*
+ * Call itemfunc on every page queued, in no particular order; spilled
+ * pages are read from disk without being removed
+ *
+ * Input:
+ *   frontier: the frontier
+ *   arg: passed to itemfunc
+ *   itemfunc: called with arg and each page, which it must not keep
+ *
+ * Returns:
+ *   false if spilled pages could not all be read (itemfunc has then
+ *   seen only some of the pages), true otherwise
+ */
+bool frontier_iterate(frontier_t* frontier, void* arg,
+                      void (*itemfunc)(void* arg, const webpage_t* page));
+
+/*
+ * Delete a frontier created by frontier_new()
+ *
+ * Input:
+ *   frontier: the frontier
+ *   itemdelete: called on each page still queued (may be NULL)
+ */
+void frontier_delete(frontier_t* frontier, void (*itemdelete)(void* item));
+
+/*
+ * Compare function for a breadth-first crawl: shallower pages first
+ */
+int frontier_byDepth(const webpage_t* a, const webpage_t* b);
+
+#endif // __FRONTIER_H__
@@ -0,0 +1,542 @@
+/*
+ * hostsched.c    Hugo Fang    2/23/2024
+ *
+ * See hostsched.h for details
+ */
+
+#define _POSIX_C_SOURCE 200809L   // strndup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+// libcs50.a
+#include "hashtable.h"
+#include "webpage.h"
+#include "deadline.h"
+
+#include "frontier.h"
+#include "hostsched.h"
+
+/* Local types */
+typedef struct host {
+  // <webpage_t* page> waiting to be fetched from this host
+  frontier_t* pages;
+  // earliest time (hostsched_now()) the next fetch may start
+  long readyAt;
+  // position in the ready heap, or -1 if not in it (no pages waiting,
+  // or as many fetches in flight as its limit allows)
+  int heapIndex;
+  // fetches taken and not yet done, and how many may be when adapting;
+  // the limit grows by fractions, and counts rounded down
+  int inFlight;
+  double limit;
+  // smoothed latency of its fetches, the least seen (-1 before the
+  // first), and the smoothed share of its fetches failing
+  double latency;
+  long minLatency;
+  double errorRate;
+  // when its limit was last cut
+  long cutAt;
+} host_t;
+
+/* Public types */
+typedef struct hostsched {
+  // <char* host[:port], host_t*>
+  hashtable_t* hosts;
+  // min-heap of hosts with pages waiting, ordered by readyAt
+  host_t** heap;
+  int heapSize;
+  int heapCap;
+  long delayMillis;
+  // set by hostsched_adapt(): the bounds of each host's limit, or 0
+  int floor;
+  int ceiling;
+  frontier_compare_t order;
+  int numPages;
+  int numHosts;
+  // set by hostsched_spill(): directory for segment files, or NULL
+  char* spillDir;
+  long memUsed;
+  long memBudget;
+} hostsched_t;
+
+/* passes hostsched_iterate()'s arguments through hashtable_iterate() */
+typedef struct iterateArg {
+  void* arg;
+  void (*itemfunc)(void* arg, const webpage_t* page);
+  bool ok;
+} iterateArg_t;
+
+/* Local constants */
+static const double SMOOTHING = 0.25;       // weight of each new sample
+static const double SLOW_FACTOR = 2.0;       // latency above this times the
+static const long SLOW_SLACK_MILLIS = 20;    // least, plus this, is slow
+static const double MAX_ERROR_RATE = 0.25;   // failing more is struggling
+
+/* Private function prototypes */
+static char* hostOf(const char* url);
+static bool atLimit(const hostsched_t* sched, const host_t* host);
+static void adapt(hostsched_t* sched, host_t* host, const long latencyMillis,
+                  const bool healthy);
+static host_t* host_new(hostsched_t* sched);
+static void host_delete(void* item);
+static void host_iterate(void* arg, const char* key, void* item);
+static void removeSpillFiles(const char* dir);
+static bool heapReserve(hostsched_t* sched);
+static void heapPush(hostsched_t* sched, host_t* host);
+static void heapPop(hostsched_t* sched);
+static void heapSiftUp(hostsched_t* sched, int i);
+static void heapSiftDown(hostsched_t* sched, int i);
+static void heapSwap(hostsched_t* sched, const int i, const int j);
+
+// hostsched_delete() passes its itemdelete to host_delete() through here
+static void (*pageDelete)(void* item) = NULL;
+
+/* Public functions */
+hostsched_t* hostsched_new(const int delayMillis, frontier_compare_t order)
+{
+  if (delayMillis < 0) {
+    return NULL;
+  }
+  hostsched_t* sched = malloc(sizeof(hostsched_t));
+  if (sched == NULL) {
+    return NULL;
+  }
+  sched->hosts = hashtable_new(50);
+  sched->heapCap = 16;
+  sched->heap = malloc(sizeof(host_t*) * sched->heapCap);
+  if (sched->hosts == NULL || sched->heap == NULL) {
+    if (sched->hosts != NULL) {
+      hashtable_delete(sched->hosts, NULL);
+    }
+    free(sched->heap);
+    free(sched);
+    return NULL;
+  }
+  sched->heapSize = 0;
+  sched->delayMillis = delayMillis;
+  sched->floor = 0;
+  sched->ceiling = 0;
+  sched->order = order;
+  sched->numPages = 0;
+  sched->numHosts = 0;
+  sched->spillDir = NULL;
+  sched->memUsed = 0;
+  sched->memBudget = 0;
+  return sched;
+}
+
+bool hostsched_spill(hostsched_t* sched, const char* dir, const long memBudget)
+{
+  if (sched == NULL || dir == NULL || memBudget <= 0 || sched->numHosts > 0) {
+    return false;
+  }
+  sched->spillDir = strdup(dir);
+  if (sched->spillDir == NULL) {
+    return false;
+  }
+  sched->memBudget = memBudget;
+  // a crawl that died leaves its segments behind; ours reuse the names
+  removeSpillFiles(dir);
+  return true;
+}
+
+bool hostsched_adapt(hostsched_t* sched, const int floor, const int ceiling)
+{
+  if (sched == NULL || floor < 1 || ceiling < floor || sched->numHosts > 0) {
+    return false;
+  }
+  sched->floor = floor;
+  sched->ceiling = ceiling;
+  return true;
+}
+
+bool hostsched_add(hostsched_t* sched, webpage_t* page)
+{
+  if (sched == NULL || page == NULL) {
+    return false;
+  }
+  char* name = hostOf(webpage_getURL(page));
+  if (name == NULL) {
+    return false;
+  }
+
+  // first page from this host: it is ready right away; room is kept in
+  // the heap for every host, so it can always rejoin the heap later,
+  // even once a page queued may have been spilled and deleted
+  host_t* host = hashtable_find(sched->hosts, name);
+  if (host == NULL) {
+    if (!heapReserve(sched) || (host = host_new(sched)) == NULL) {
+      free(name);
+      return false;
+    }
+    host->readyAt = hostsched_now();
+    hashtable_insert(sched->hosts, name, host);
+  }
+  free(name);
+
+  if (!frontier_insert(host->pages, page)) {
+    return false;
+  }
+  if (host->heapIndex < 0 && !atLimit(sched, host)) {
+    heapPush(sched, host);
+  }
+  sched->numPages++;
+  return true;
+}
+
+webpage_t* hostsched_take(hostsched_t* sched, long* waitMillis)
+{
+  if (sched == NULL || sched->heapSize == 0) {
+    if (waitMillis != NULL) {
+      *waitMillis = -1;
+    }
+    return NULL;
+  }
+
+  // the host at the top of the heap is the next to become ready
+  host_t* host = sched->heap[0];
+  long now = hostsched_now();
+  if (host->readyAt > now) {
+    if (waitMillis != NULL) {
+      *waitMillis = host->readyAt - now;
+    }
+    return NULL;
+  }
+
+  // a page lost from the spill files still leaves the host's queue, but
+  // starts no fetch, so it takes no turn and no slot in flight
+  int before = frontier_size(host->pages);
+  webpage_t* page = frontier_extract(host->pages);
+  sched->numPages -= before - frontier_size(host->pages);
+  if (page != NULL) {
+    host->readyAt = now + sched->delayMillis;
+    host->inFlight++;
+  }
+  if (frontier_size(host->pages) == 0 || atLimit(sched, host)) {
+    heapPop(sched);
+  } else {
+    heapSiftDown(sched, 0);
+  }
+  if (page == NULL && waitMillis != NULL) {
+    *waitMillis = sched->heapSize > 0 ? 0 : -1;
+  }
+  return page;
+}
+
+bool hostsched_done(hostsched_t* sched, const char* url,
+                    const long latencyMillis, const bool healthy)
+{
+  if (sched == NULL) {
+    return false;
+  }
+  char* name = hostOf(url);
+  if (name == NULL) {
+    return false;
+  }
+  host_t* host = hashtable_find(sched->hosts, name);
+  free(name);
+  if (host == NULL || host->inFlight == 0) {
+    return false;
+  }
+  host->inFlight--;
+  if (sched->ceiling > 0) {
+    adapt(sched, host, latencyMillis, healthy);
+  }
+  // a host left out of the heap at its limit rejoins once below it
+  if (host->heapIndex < 0 && frontier_size(host->pages) > 0
+      && !atLimit(sched, host)) {
+    heapPush(sched, host);
+    return true;
+  }
+  return false;
+}
+
+bool hostsched_iterate(hostsched_t* sched, void* arg,
+                       void (*itemfunc)(void* arg, const webpage_t* page))
+{
+  if (sched == NULL || itemfunc == NULL) {
+    return false;
+  }
+  iterateArg_t iter = { arg, itemfunc, true };
+  hashtable_iterate(sched->hosts, &iter, host_iterate);
+  return iter.ok;
+}
+
+int hostsched_size(const hostsched_t* sched)
+{
+  return sched ? sched->numPages : 0;
+}
+
+void hostsched_delete(hostsched_t* sched, void (*itemdelete)(void* item))
+{
+  if (sched == NULL) {
+    return;
+  }
+  pageDelete = itemdelete;
+  hashtable_delete(sched->hosts, host_delete);
+  pageDelete = NULL;
+  free(sched->spillDir);
+  free(sched->heap);
+  free(sched);
+}
+
+long hostsched_now(void)
+{
+  return deadline_now();
+}
+
+/*
+ * Extracts the host[:port] part of a URL, the key that politeness is
+ * applied to
+ *
+ * Returns:
+ *   a new string, or NULL if url is NULL or has no "//"
+ *
+ * Caller needs to free() the string returned
+ */
+static char* hostOf(const char* url)
+{
+  if (url == NULL) {
+    return NULL;
+  }
+  const char* start = strstr(url, "//");
+  if (start == NULL) {
+    return NULL;
+  }
+  start += 2;
+  size_t len = strcspn(start, "/?#");
+  return strndup(start, len);
+}
+
+/*
+ * Returns whether a host has as many fetches in flight as it may
+ */
+static bool atLimit(const hostsched_t* sched, const host_t* host)
+{
+  return sched->ceiling > 0 && host->inFlight >= (int)host->limit;
+}
+
+/*
+ * Adapts a host's limit to a fetch just done (AIMD): halves it, down to
+ * the floor, if the host's smoothed latency has climbed well above the
+ * least seen, or a failed fetch leaves it failing more than
+ * MAX_ERROR_RATE of the time; else, if the host answered, adds
+ * 1/limit, so a whole limit's worth of fetches raise it by one, up to
+ * the ceiling. Only the latency of fetches the host answered is counted,
+ * as one that failed may have taken up to its whole timeout.
+ */
+static void adapt(hostsched_t* sched, host_t* host, const long latencyMillis,
+                  const bool healthy)
+{
+  if (healthy) {
+    if (host->minLatency < 0) {
+      host->latency = latencyMillis;
+      host->minLatency = latencyMillis;
+    } else {
+      host->latency += SMOOTHING * (latencyMillis - host->latency);
+      if (latencyMillis < host->minLatency) {
+        host->minLatency = latencyMillis;
+      }
+    }
+  }
+  host->errorRate += SMOOTHING * ((healthy ? 0.0 : 1.0) - host->errorRate);
+
+  bool slow = host->minLatency >= 0
+              && host->latency > SLOW_FACTOR * host->minLatency
+                                 + SLOW_SLACK_MILLIS;
+  bool failing = !healthy && host->errorRate > MAX_ERROR_RATE;
+  long now = hostsched_now();
+  if (slow || failing) {
+    // the fetches in flight when it was cut saw the same trouble, so
+    // cut again only after they have had time to come back
+    if (now - host->cutAt > host->latency) {
+      host->limit /= 2;
+      if (host->limit < sched->floor) {
+        host->limit = sched->floor;
+      }
+      host->cutAt = now;
+    }
+  } else if (healthy) {
+    host->limit += 1.0 / host->limit;
+    if (host->limit > sched->ceiling) {
+      host->limit = sched->ceiling;
+    }
+  }
+}
+
+/*
+ * Allocates a host with no pages waiting, handing them out in the
+ * scheduler's order and spilling them to <spillDir>/.frontier-<n>.<seg>
+ * if the scheduler has a memory budget
+ */
+static host_t* host_new(hostsched_t* sched)
+{
+  host_t* host = malloc(sizeof(host_t));
+  if (host == NULL) {
+    return NULL;
+  }
+  host->pages = frontier_new(sched->order);
+  if (host->pages == NULL) {
+    free(host);
+    return NULL;
+  }
+  if (sched->spillDir != NULL) {
+    char prefix[strlen(sched->spillDir) + 32];
+    sprintf(prefix, "%s/.frontier-%d", sched->spillDir, sched->numHosts);
+    if (!frontier_spill(host->pages, prefix, &sched->memUsed,
+                        sched->memBudget)) {
+      frontier_delete(host->pages, NULL);
+      free(host);
+      return NULL;
+    }
+  }
+  sched->numHosts++;
+  host->readyAt = 0;
+  host->heapIndex = -1;
+  host->inFlight = 0;
+  host->limit = sched->floor;
+  host->latency = 0;
+  host->minLatency = -1;
+  host->errorRate = 0;
+  host->cutAt = 0;
+  return host;
+}
+
+/*
+ * itemdelete() function passed into hashtable_delete()
+ */
+static void host_delete(void* item)
+{
+  host_t* host = item;
+  frontier_delete(host->pages, pageDelete);
+  free(host);
+}
+
+/*
+ * Grows the heap array if needed so it can hold one more host than the
+ * scheduler has
+ */
+static bool heapReserve(hostsched_t* sched)
+{
+  if (sched->numHosts == sched->heapCap) {
+    host_t** heap = realloc(sched->heap, sizeof(host_t*) * sched->heapCap * 2);
+    if (heap == NULL) {
+      return false;
+    }
+    sched->heap = heap;
+    sched->heapCap *= 2;
+  }
+  return true;
+}
+
+/*
+ * itemfunc() passed into hashtable_iterate() by hostsched_iterate()
+ */
+static void host_iterate(void* arg, const char* key, void* item)
+{
+  iterateArg_t* iter = arg;
+  host_t* host = item;
+  if (!frontier_iterate(host->pages, iter->arg, iter->itemfunc)) {
+    iter->ok = false;
+  }
+}
+
+/*
+ * Removes every spill segment file (.frontier-*) in dir
+ */
+static void removeSpillFiles(const char* dir)
+{
+  DIR* dp = opendir(dir);
+  if (dp == NULL) {
+    return;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dp)) != NULL) {
+    if (strncmp(entry->d_name, ".frontier-", strlen(".frontier-")) == 0) {
+      char path[strlen(dir) + strlen(entry->d_name) + 2];
+      sprintf(path, "%s/%s", dir, entry->d_name);
+      unlink(path);
+    }
+  }
+  closedir(dp);
+}
+
+/*
+ * Adds a host to the heap, which always has room for every host
+ */
+static void heapPush(hostsched_t* sched, host_t* host)
+{
+  host->heapIndex = sched->heapSize;
+  sched->heap[sched->heapSize++] = host;
+  heapSiftUp(sched, host->heapIndex);
+}
+
+/*
+ * Removes the host at the top of the heap
+ */
+static void heapPop(hostsched_t* sched)
+{
+  sched->heap[0]->heapIndex = -1;
+  sched->heapSize--;
+  if (sched->heapSize > 0) {
+    sched->heap[0] = sched->heap[sched->heapSize];
+    sched->heap[0]->heapIndex = 0;
+    heapSiftDown(sched, 0);
+  }
+}
+
+/*
+ * Moves heap[i] up until its parent is ready no later than it is
+ */
+static void heapSiftUp(hostsched_t* sched, int i)
+{
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (sched->heap[parent]->readyAt <= sched->heap[i]->readyAt) {
+      break;
+    }
+    heapSwap(sched, i, parent);
+    i = parent;
+  }
+}
+
+/*
+ * Moves heap[i] down until both children are ready no earlier than it is
+ */
+static void heapSiftDown(hostsched_t* sched, int i)
+{
+  while (true) {
+    int smallest = i;
+    int left = 2 * i + 1, right = 2 * i + 2;
+    if (left < sched->heapSize
+        && sched->heap[left]->readyAt < sched->heap[smallest]->readyAt) {
+      smallest = left;
+    }
+    if (right < sched->heapSize
+        && sched->heap[right]->readyAt < sched->heap[smallest]->readyAt) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      break;
+    }
+    heapSwap(sched, i, smallest);
+    i = smallest;
+  }
+}
+
+/*
+ * Swaps two heap entries, keeping their heapIndex fields up to date
+ */
+static void heapSwap(hostsched_t* sched, const int i, const int j)
+{
+  host_t* tmp = sched->heap[i];
+  sched->heap[i] = sched->heap[j];
+  sched->heap[j] = tmp;
+  sched->heap[i]->heapIndex = i;
+  sched->heap[j]->heapIndex = j;
+}
@@ -0,0 +1,170 @@
+/*
+ * hostsched.h - header file for hostsched.c
+ *
+ * Politeness scheduler for the crawler's frontier. Pages waiting to be
+ * fetched are queued by host, and each host has a ready time: the
+ * earliest moment its next fetch may start, which is `delay` after its
+ * previous fetch started. Hosts with pages waiting sit in a min-heap
+ * ordered by ready time, so the next page to fetch is always one whose
+ * host is ready, and fetches from different hosts overlap freely.
+ * Each host's own pages are handed out in a chosen order (see frontier.h).
+ *
+ * The scheduler can also limit how many fetches from each host are in
+ * flight at once, adapting the limit to how the host copes (see
+ * hostsched_adapt()). Each fetch's end is reported with hostsched_done(),
+ * with how long it took and whether the host answered it properly; a
+ * host whose fetches come back promptly has its limit raised by one for
+ * each round of fetches (additive increase), and one whose fetches slow
+ * down, or keep failing, has it halved (multiplicative decrease). A host
+ * at its limit leaves the heap until one of its fetches is done.
+ *
+ * Not thread-safe: callers sharing a scheduler must hold a lock.
+ *
+ * Hugo Fang, 2/23/2024
+ */
+
+#ifndef __HOSTSCHED_H__
+#define __HOSTSCHED_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// libcs50
+#include "webpage.h"
+
+#include "frontier.h"
+
+/* Public types */
+typedef struct hostsched hostsched_t;
+
+/*
+ * Allocate and initialize an empty scheduler
+ *
+ * Input:
+ *   delayMillis: minimum time between the starts of two fetches from
+ *     the same host, in milliseconds (>= 0)
+ *   order: the order to fetch each host's pages in, as for frontier_new()
+ *
+ * Returns:
+ *   pointer to new hostsched_t, or NULL on any error
+ *
+ * Caller is responsible for calling hostsched_delete() on the returned pointer
+ */
+hostsched_t* hostsched_new(const int delayMillis, frontier_compare_t order);
+
+/*
+ * Keep queued pages within a memory budget shared by all hosts, spilling
+ * the rest to files in dir (see frontier_spill()); must be called before
+ * the first hostsched_add()
+ *
+ * Input:
+ *   sched: the scheduler
+ *   dir: an existing directory for the spill files; copied
+ *   memBudget: roughly how many bytes of queued pages to keep in memory
+ *
+ * Returns:
+ *   true on success, false if any argument is invalid or pages were
+ *   already added
+ *
+ * Any spill files left in dir by an earlier run are removed.
+ */
+bool hostsched_spill(hostsched_t* sched, const char* dir, const long memBudget);
+
+/*
+ * Limit the fetches in flight from each host, adapting the limit between
+ * floor and ceiling as each host responds; every host starts at floor.
+ * Without this, fetches from a host are limited by the delay alone.
+ *
+ * Input:
+ *   sched: the scheduler
+ *   floor, ceiling: the least and most fetches in flight from one host
+ *     (1 <= floor <= ceiling)
+ *
+ * Returns:
+ *   true on success, false if any argument is invalid
+ */
+bool hostsched_adapt(hostsched_t* sched, const int floor, const int ceiling);
+
+/*
+ * Queue a page to be fetched from its host
+ *
+ * Input:
+ *   sched: the scheduler
+ *   page: webpage_t* with a URL; the scheduler holds it until it is
+ *     returned by hostsched_take() (or, if it is spilled to disk, an
+ *     equal page is returned in its place)
+ *
+ * Returns:
+ *   true if queued, false if any argument is NULL or on memory
+ *   allocation failure (the page is then still the caller's)
+ */
+bool hostsched_add(hostsched_t* sched, webpage_t* page);
+
+/*
+ * Take a page whose host is ready now, and start that host's delay
+ *
+ * Input:
+ *   sched: the scheduler
+ *   waitMillis: if no page is returned, set to how long until some host
+ *     becomes ready, or -1 if no pages are queued at all, or none can be
+ *     taken until a fetch is done
+ *
+ * Returns:
+ *   the page to fetch next, which now belongs to the caller
+ *   NULL if no host is ready (see waitMillis), or if a page spilled to
+ *   disk could not be read back (waitMillis is then 0 or -1)
+ */
+webpage_t* hostsched_take(hostsched_t* sched, long* waitMillis);
+
+/*
+ * Report that the fetch of a page taken with hostsched_take() is over,
+ * adapting its host's limit if hostsched_adapt() was called
+ *
+ * Input:
+ *   sched: the scheduler
+ *   url: the page's URL
+ *   latencyMillis: how long the fetch took, from being taken
+ *   healthy: false if the host failed the fetch: it timed out, the
+ *     connection failed, or the response was a 5xx or 429. A 404, or a
+ *     page skipped as not HTML, is a healthy answer, though no page was
+ *     fetched
+ *
+ * Returns:
+ *   true if the host had reached its limit and can now be taken from
+ *   again, so a caller waiting for a page should look again
+ */
+bool hostsched_done(hostsched_t* sched, const char* url,
+                    const long latencyMillis, const bool healthy);
+
+/*
+ * Call itemfunc on every page queued, across all hosts and in no
+ * particular order (see frontier_iterate())
+ *
+ * Returns:
+ *   false if any host's spilled pages could not all be read
+ */
+bool hostsched_iterate(hostsched_t* sched, void* arg,
+                       void (*itemfunc)(void* arg, const webpage_t* page));
+
+/*
+ * Returns the number of pages queued, across all hosts
+ */
+int hostsched_size(const hostsched_t* sched);
+
+/*
+ * Delete a scheduler created by hostsched_new()
+ *
+ * Input:
+ *   sched: the scheduler
+ *   itemdelete: called on each page still queued (may be NULL)
+ */
+void hostsched_delete(hostsched_t* sched, void (*itemdelete)(void* item));
+
+/*
+ * Returns the current time in milliseconds on a monotonic clock,
+ * the clock that ready times are measured on
+ */
+long hostsched_now(void);
+
+#endif // __HOSTSCHED_H__
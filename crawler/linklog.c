@@ -0,0 +1,206 @@
+/*
+ * linklog.c    Hugo Fang    3/6/2024
+ *
+ * See linklog.h for details
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// common.a
+#include "linkgraph.h"
+
+#include "seenset.h"
+#include "linklog.h"
+
+/* Local types */
+typedef struct link {
+  uint64_t from;
+  uint64_t to;
+} link_t;
+
+typedef struct doc {
+  uint64_t print;
+  int docID;
+} doc_t;
+
+/* Public types */
+typedef struct linklog {
+  link_t* links;
+  int numLinks;
+  int linksCap;
+  doc_t* docs;
+  int numDocs;
+  int docsCap;
+} linklog_t;
+
+/* Local constants */
+static const int INIT_CAP = 256;
+
+/* Private function prototypes */
+static bool grow(void** array, int* cap_p, const int need, const size_t size);
+static int findDoc(const linklog_t* log, const uint64_t print);
+static int compareDocs(const void* a, const void* b);
+static int compareEdges(const void* a, const void* b);
+
+/* Public functions */
+linklog_t* linklog_new(void)
+{
+  linklog_t* log = malloc(sizeof(linklog_t));
+  if (log == NULL) {
+    return NULL;
+  }
+  log->links = NULL;
+  log->numLinks = log->linksCap = 0;
+  log->docs = NULL;
+  log->numDocs = log->docsCap = 0;
+  return log;
+}
+
+bool linklog_addLinks(linklog_t* log, const char* fromURL,
+                      const uint64_t* toPrints, const int numLinks)
+{
+  if (log == NULL || fromURL == NULL || (numLinks > 0 && toPrints == NULL)
+      || !grow((void**)&log->links, &log->linksCap, log->numLinks + numLinks,
+               sizeof(link_t))) {
+    return false;
+  }
+  uint64_t from = seenset_fingerprint(fromURL);
+  for (int i = 0; i < numLinks; i++) {
+    log->links[log->numLinks].from = from;
+    log->links[log->numLinks].to = toPrints[i];
+    log->numLinks++;
+  }
+  return true;
+}
+
+bool linklog_addDoc(linklog_t* log, const char* url, const int docID)
+{
+  if (log == NULL || url == NULL || docID <= 0
+      || !grow((void**)&log->docs, &log->docsCap, log->numDocs + 1,
+               sizeof(doc_t))) {
+    return false;
+  }
+  log->docs[log->numDocs].print = seenset_fingerprint(url);
+  log->docs[log->numDocs].docID = docID;
+  log->numDocs++;
+  return true;
+}
+
+bool linklog_save(linklog_t* log, const char* pageDirectory,
+                  const int numDocs)
+{
+  if (log == NULL || pageDirectory == NULL || numDocs < 0) {
+    return false;
+  }
+  // find each end of each link among the documents, sorted by print;
+  // a URL recorded twice (refetched when recrawling) has one docID
+  if (log->numDocs > 0) {
+    qsort(log->docs, log->numDocs, sizeof(doc_t), compareDocs);
+  }
+  linkedge_t* edges = malloc(sizeof(linkedge_t) * (log->numLinks + 1));
+  if (edges == NULL) {
+    return false;
+  }
+  int numEdges = 0;
+  for (int i = 0; i < log->numLinks; i++) {
+    int from = findDoc(log, log->links[i].from);
+    int to = findDoc(log, log->links[i].to);
+    if (from > 0 && to > 0 && from != to && from <= numDocs
+        && to <= numDocs) {
+      edges[numEdges].from = from;
+      edges[numEdges].to = to;
+      numEdges++;
+    }
+  }
+
+  // sort, and drop repeats: a link found twice, or two URLs of one page
+  qsort(edges, numEdges, sizeof(linkedge_t), compareEdges);
+  int kept = 0;
+  for (int i = 0; i < numEdges; i++) {
+    if (kept == 0 || compareEdges(&edges[i], &edges[kept - 1]) != 0) {
+      edges[kept++] = edges[i];
+    }
+  }
+  bool ok = linkgraph_save(pageDirectory, numDocs, edges, kept);
+  free(edges);
+  return ok;
+}
+
+void linklog_delete(linklog_t* log)
+{
+  if (log != NULL) {
+    free(log->links);
+    free(log->docs);
+    free(log);
+  }
+}
+
+/*
+ * Makes room in *array, of *cap_p items of size bytes, for need items,
+ * doubling it as needed
+ *
+ * Returns:
+ *   false if out of memory, leaving the array as it was
+ */
+static bool grow(void** array, int* cap_p, const int need, const size_t size)
+{
+  if (need <= *cap_p) {
+    return true;
+  }
+  int cap = *cap_p > 0 ? *cap_p : INIT_CAP;
+  while (cap < need) {
+    cap *= 2;
+  }
+  void* grown = realloc(*array, size * cap);
+  if (grown == NULL) {
+    return false;
+  }
+  *array = grown;
+  *cap_p = cap;
+  return true;
+}
+
+/*
+ * Returns the docID of the URL with fingerprint print, from the docs
+ * sorted by compareDocs(), or 0 if it has none
+ */
+static int findDoc(const linklog_t* log, const uint64_t print)
+{
+  int lo = 0, hi = log->numDocs;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (log->docs[mid].print < print) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo < log->numDocs && log->docs[lo].print == print)
+         ? log->docs[lo].docID : 0;
+}
+
+/*
+ * Orders doc_t by fingerprint, for qsort()
+ */
+static int compareDocs(const void* a, const void* b)
+{
+  const doc_t* docA = a;
+  const doc_t* docB = b;
+  return (docA->print > docB->print) - (docA->print < docB->print);
+}
+
+/*
+ * Orders linkedge_t by from, then to, for qsort()
+ */
+static int compareEdges(const void* a, const void* b)
+{
+  const linkedge_t* edgeA = a;
+  const linkedge_t* edgeB = b;
+  if (edgeA->from != edgeB->from) {
+    return (edgeA->from > edgeB->from) - (edgeA->from < edgeB->from);
+  }
+  return (edgeA->to > edgeB->to) - (edgeA->to < edgeB->to);
+}
@@ -0,0 +1,73 @@
+/*
+ * linklog.h - header file for linklog.c
+ *
+ * Records the links between pages as the crawler finds them, and writes
+ * them out at the end of the crawl as the page directory's link graph
+ * (see linkgraph.h). A page is scanned before it has a docID, and
+ * links to pages that have not been fetched yet, so each link is kept
+ * as the fingerprints of the two URLs (see seenset_fingerprint()), and
+ * each URL given a docID, whether saved under it or found to duplicate
+ * it, is kept with that docID. The fingerprints are turned into docIDs
+ * only when the graph is written; links to pages never saved, and a
+ * page's links to itself, are dropped then.
+ *
+ * Not thread-safe: callers sharing a linklog_t must hold a lock.
+ *
+ * Hugo Fang, 3/6/2024
+ */
+
+#ifndef __LINKLOG_H__
+#define __LINKLOG_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Public types */
+typedef struct linklog linklog_t;
+
+/*
+ * Returns a new, empty linklog_t, or NULL on error
+ *
+ * Caller is responsible for calling linklog_delete() on it
+ */
+linklog_t* linklog_new(void);
+
+/*
+ * Record links from the page at normalized URL fromURL to the pages
+ * whose normalized URLs have the fingerprints toPrints[0..numLinks)
+ *
+ * Returns:
+ *   false on a NULL argument or out of memory
+ */
+bool linklog_addLinks(linklog_t* log, const char* fromURL,
+                      const uint64_t* toPrints, const int numLinks);
+
+/*
+ * Record that the page at normalized URL url is the document docID
+ *
+ * Returns:
+ *   false on a NULL argument, docID <= 0, or out of memory
+ */
+bool linklog_addDoc(linklog_t* log, const char* url, const int docID);
+
+/*
+ * Write the links recorded between documents to "pageDirectory/.links"
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   numDocs: the highest docID of the crawl
+ *
+ * Returns:
+ *   false on error
+ */
+bool linklog_save(linklog_t* log, const char* pageDirectory,
+                  const int numDocs);
+
+/*
+ * Delete a linklog_t created by linklog_new()
+ */
+void linklog_delete(linklog_t* log);
+
+#endif // __LINKLOG_H__
@@ -0,0 +1,306 @@
+/*
+ * pagewriter.c    Hugo Fang    3/2/2024
+ *
+ * See pagewriter.h for details
+ */
+
+#define _POSIX_C_SOURCE 200809L   // O_DIRECTORY
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+// libcs50.a
+#include "webpage.h"
+
+// common.a
+#include "pagedir.h"
+
+#include "workqueue.h"
+#include "pagewriter.h"
+
+/* Local types */
+typedef struct pending {
+  webpage_t* page;
+  int docID;
+} pending_t;
+
+/* Public types */
+typedef struct pagewriter {
+  int dirfd;
+  int syncEvery;
+  workqueue_t* queue;        // <pending_t*>
+  pthread_t thread;
+  void* arg;
+  void (*donefunc)(void* arg, const webpage_t* page, int docID);
+  void (*failfunc)(void* arg, int docID, int err);
+
+  // progress, guarded by lock: pages put, pages finished (saved or
+  // dropped), and whether any page has failed
+  long put;
+  long finished;
+  bool failed;
+  pthread_mutex_t lock;
+  pthread_cond_t finishedCond;
+
+  // the current group, on the writer's thread only: pages written but
+  // not yet synced, and their open files
+  pending_t* group[PAGEWRITER_MAX_SYNC];
+  int fds[PAGEWRITER_MAX_SYNC];
+  int groupSize;
+} pagewriter_t;
+
+/* Local constants */
+static const int BATCH = 32;       // most pages taken off the queue at once
+
+/* Private function prototypes */
+static void* writer(void* arg);
+static void writePending(pagewriter_t* pw, pending_t* pending);
+static void commitGroup(pagewriter_t* pw);
+static void fail(pagewriter_t* pw, const int docID, const int err);
+static void finish(pagewriter_t* pw, const int count);
+static void pendingDelete(void* item);
+
+/* Public functions */
+pagewriter_t* pagewriter_new(const char* pageDirectory, const int queueDepth,
+                             const int syncEvery, void* arg,
+                  void (*donefunc)(void* arg, const webpage_t* page, int docID),
+                  void (*failfunc)(void* arg, int docID, int err))
+{
+  if (pageDirectory == NULL || queueDepth <= 0 || syncEvery < 0
+      || syncEvery > PAGEWRITER_MAX_SYNC) {
+    return NULL;
+  }
+  pagewriter_t* pw = malloc(sizeof(pagewriter_t));
+  if (pw == NULL) {
+    return NULL;
+  }
+  pw->dirfd = open(pageDirectory, O_RDONLY | O_DIRECTORY);
+  pw->queue = workqueue_new(queueDepth);
+  if (pw->dirfd == -1 || pw->queue == NULL) {
+    if (pw->dirfd != -1) {
+      close(pw->dirfd);
+    }
+    workqueue_delete(pw->queue, NULL);
+    free(pw);
+    return NULL;
+  }
+  pw->syncEvery = syncEvery;
+  pw->arg = arg;
+  pw->donefunc = donefunc;
+  pw->failfunc = failfunc;
+  pw->put = 0;
+  pw->finished = 0;
+  pw->failed = false;
+  pw->groupSize = 0;
+  pthread_mutex_init(&pw->lock, NULL);
+  pthread_cond_init(&pw->finishedCond, NULL);
+  if (pthread_create(&pw->thread, NULL, writer, pw) != 0) {
+    pthread_mutex_destroy(&pw->lock);
+    pthread_cond_destroy(&pw->finishedCond);
+    workqueue_delete(pw->queue, NULL);
+    close(pw->dirfd);
+    free(pw);
+    return NULL;
+  }
+  return pw;
+}
+
+bool pagewriter_put(pagewriter_t* pw, webpage_t* page, const int docID)
+{
+  if (pw == NULL || page == NULL || docID <= 0) {
+    webpage_delete(page);
+    return false;
+  }
+  pending_t* pending = malloc(sizeof(pending_t));
+  if (pending == NULL) {
+    webpage_delete(page);
+    return false;
+  }
+  pending->page = page;
+  pending->docID = docID;
+
+  pthread_mutex_lock(&pw->lock);
+  bool failed = pw->failed;
+  if (!failed) {
+    pw->put++;
+  }
+  pthread_mutex_unlock(&pw->lock);
+  // the writer only ever stops once closed, so the put always succeeds
+  if (failed || !workqueue_put(pw->queue, pending)) {
+    pendingDelete(pending);
+    return false;
+  }
+  return true;
+}
+
+bool pagewriter_sync(pagewriter_t* pw)
+{
+  if (pw == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&pw->lock);
+  long target = pw->put;
+  while (pw->finished < target && !pw->failed) {
+    pthread_cond_wait(&pw->finishedCond, &pw->lock);
+  }
+  bool ok = !pw->failed;
+  pthread_mutex_unlock(&pw->lock);
+  return ok;
+}
+
+bool pagewriter_close(pagewriter_t* pw)
+{
+  if (pw == NULL) {
+    return false;
+  }
+  workqueue_close(pw->queue);
+  pthread_join(pw->thread, NULL);
+  bool ok = !pw->failed;
+  workqueue_delete(pw->queue, pendingDelete);
+  pthread_mutex_destroy(&pw->lock);
+  pthread_cond_destroy(&pw->finishedCond);
+  close(pw->dirfd);
+  free(pw);
+  return ok;
+}
+
+/*
+ * Body of the writer thread: takes pages off the queue in batches and
+ * writes them, committing the group once it is full, or once the queue
+ * has run dry, until the queue is closed and empty
+ */
+static void* writer(void* arg)
+{
+  pagewriter_t* pw = arg;
+  void* batch[BATCH];
+  int max = BATCH;
+  int taken;
+  while ((taken = workqueue_takeBatch(pw->queue, batch, max)) > 0) {
+    for (int i = 0; i < taken; i++) {
+      writePending(pw, batch[i]);
+    }
+    if (pw->groupSize == pw->syncEvery || taken < max) {
+      commitGroup(pw);
+    }
+    // never take more than fills the group
+    max = BATCH;
+    if (pw->syncEvery > 0 && pw->syncEvery - pw->groupSize < max) {
+      max = pw->syncEvery - pw->groupSize;
+    }
+  }
+  commitGroup(pw);
+  return NULL;
+}
+
+/*
+ * Writes one page; without syncing, it is finished at once, else it
+ * joins the group
+ */
+static void writePending(pagewriter_t* pw, pending_t* pending)
+{
+  pthread_mutex_lock(&pw->lock);
+  bool failed = pw->failed;
+  pthread_mutex_unlock(&pw->lock);
+
+  int fd = failed ? -1 : pagedir_saveAt(pw->dirfd, pending->page,
+                                        pending->docID);
+  if (fd == -1) {
+    if (!failed) {
+      fail(pw, pending->docID, errno);
+    }
+    pendingDelete(pending);
+    finish(pw, 1);
+    return;
+  }
+  if (pw->syncEvery == 0) {
+    if (close(fd) == 0) {
+      if (pw->donefunc != NULL) {
+        (*pw->donefunc)(pw->arg, pending->page, pending->docID);
+      }
+    } else {
+      fail(pw, pending->docID, errno);
+    }
+    pendingDelete(pending);
+    finish(pw, 1);
+    return;
+  }
+  pw->group[pw->groupSize] = pending;
+  pw->fds[pw->groupSize] = fd;
+  pw->groupSize++;
+}
+
+/*
+ * Syncs the pages in the group, then the directory naming them, and
+ * finishes them
+ */
+static void commitGroup(pagewriter_t* pw)
+{
+  if (pw->groupSize == 0) {
+    return;
+  }
+  int failedID = 0;
+  int err = 0;
+  for (int i = 0; i < pw->groupSize; i++) {
+    bool synced = fsync(pw->fds[i]) == 0;
+    if (!(close(pw->fds[i]) == 0 && synced) && failedID == 0) {
+      failedID = pw->group[i]->docID;
+      err = errno;
+    }
+  }
+  if (failedID == 0 && fsync(pw->dirfd) != 0) {
+    failedID = pw->group[0]->docID;
+    err = errno;
+  }
+  if (failedID != 0) {
+    fail(pw, failedID, err);
+  }
+  for (int i = 0; i < pw->groupSize; i++) {
+    if (failedID == 0 && pw->donefunc != NULL) {
+      (*pw->donefunc)(pw->arg, pw->group[i]->page, pw->group[i]->docID);
+    }
+    pendingDelete(pw->group[i]);
+  }
+  finish(pw, pw->groupSize);
+  pw->groupSize = 0;
+}
+
+/*
+ * Records the first failure, and reports it
+ */
+static void fail(pagewriter_t* pw, const int docID, const int err)
+{
+  pthread_mutex_lock(&pw->lock);
+  bool first = !pw->failed;
+  pw->failed = true;
+  pthread_cond_broadcast(&pw->finishedCond);
+  pthread_mutex_unlock(&pw->lock);
+  if (first && pw->failfunc != NULL) {
+    (*pw->failfunc)(pw->arg, docID, err);
+  }
+}
+
+/*
+ * Counts pages finished, waking pagewriter_sync()
+ */
+static void finish(pagewriter_t* pw, const int count)
+{
+  pthread_mutex_lock(&pw->lock);
+  pw->finished += count;
+  pthread_cond_broadcast(&pw->finishedCond);
+  pthread_mutex_unlock(&pw->lock);
+}
+
+/*
+ * Deletes a pending_t and its page; itemdelete for workqueue_delete()
+ */
+static void pendingDelete(void* item)
+{
+  pending_t* pending = item;
+  webpage_delete(pending->page);
+  free(pending);
+}
@@ -0,0 +1,94 @@
+/*
+ * pagewriter.h - header file for pagewriter.c
+ *
+ * Saves pages in the background, so the crawl need not wait on the disk.
+ * A page handed to pagewriter_put() belongs to the writer from then on:
+ * its thread takes pages off a bounded queue in batches, writes each to
+ * its page file (see pagedir_saveAt()), calls donefunc on it, and
+ * deletes it.
+ *
+ * With group sync, every syncEvery pages written are fsync()ed, along
+ * with the page directory, before donefunc is called on any of them, so
+ * donefunc only ever sees pages that are safely on disk; the pages
+ * written so far are also synced whenever the queue runs dry. Without
+ * it, pages are left to the kernel to write back, as pagedir_save()
+ * does.
+ *
+ * A page that can't be saved is reported through failfunc, on the
+ * writer's thread, once; pages put after that are dropped. The caller
+ * also learns of it from pagewriter_sync() and pagewriter_close().
+ *
+ * Hugo Fang, 3/2/2024
+ */
+
+#ifndef __PAGEWRITER_H__
+#define __PAGEWRITER_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+// libcs50
+#include "webpage.h"
+
+/* Public types */
+typedef struct pagewriter pagewriter_t;
+
+/* Largest syncEvery pagewriter_new() accepts: pages waiting to be synced
+ * are kept open */
+#define PAGEWRITER_MAX_SYNC 256
+
+/*
+ * Start a writer
+ *
+ * Input:
+ *   pageDirectory: directory to save pages in
+ *   queueDepth: most pages waiting to be written (> 0); pagewriter_put()
+ *     waits while this many are
+ *   syncEvery: fsync the pages in groups of this many, 1 to
+ *     PAGEWRITER_MAX_SYNC; 0 for never
+ *   arg: passed to donefunc and failfunc
+ *   donefunc: if not NULL, called with each page saved and its docID
+ *   failfunc: if not NULL, called with the docID of the first page that
+ *     could not be saved and the errno value describing why
+ *
+ * Returns:
+ *   pointer to new pagewriter_t, or NULL if any argument is invalid,
+ *   pageDirectory can't be opened, or on memory allocation failure
+ *
+ * Caller is responsible for calling pagewriter_close() on the returned
+ * pointer
+ */
+pagewriter_t* pagewriter_new(const char* pageDirectory, const int queueDepth,
+                             const int syncEvery, void* arg,
+                  void (*donefunc)(void* arg, const webpage_t* page, int docID),
+                  void (*failfunc)(void* arg, int docID, int err));
+
+/*
+ * Queue a page to be saved as docID (> 0), waiting while the queue is
+ * full. The writer takes the page over, even if it returns false.
+ *
+ * Returns:
+ *   false if any argument is invalid or a page has already failed to
+ *   be saved
+ */
+bool pagewriter_put(pagewriter_t* pw, webpage_t* page, const int docID);
+
+/*
+ * Wait until every page queued so far has been saved, and synced if
+ * syncing
+ *
+ * Returns:
+ *   false if any page has failed to be saved
+ */
+bool pagewriter_sync(pagewriter_t* pw);
+
+/*
+ * Save every page still queued, stop the writer, and free it
+ *
+ * Returns:
+ *   false if any page failed to be saved
+ */
+bool pagewriter_close(pagewriter_t* pw);
+
+#endif // __PAGEWRITER_H__
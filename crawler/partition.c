@@ -0,0 +1,462 @@
+/*
+ * partition.c    Hugo Fang    3/4/2024
+ *
+ * See partition.h for details
+ */
+
+#define _POSIX_C_SOURCE 200809L   // MSG_NOSIGNAL, fdopen
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+// libcs50.a
+#include "file.h"
+
+#include "seenset.h"
+#include "partition.h"
+
+/* Public types */
+typedef struct partition {
+  int fd;
+  int self;
+  int numParts;
+  pthread_t reader;
+  void* arg;
+  void (*urlfunc)(void* arg, const char* url, int depth);
+  void (*endfunc)(void* arg, bool finished);
+
+  // whole lines only, guarded by sendLock
+  pthread_mutex_t sendLock;
+
+  // the docIDs left in the current range, [nextDocID, endDocID), whether
+  // a new range has been asked for, and whether the socket is lost,
+  // guarded by rangeLock
+  int nextDocID;
+  int endDocID;
+  bool requested;
+  bool lost;
+  pthread_mutex_t rangeLock;
+  pthread_cond_t rangeCond;
+} partition_t;
+
+/* Local types */
+/*
+ * The coordinator's end of one worker's socket
+ */
+typedef struct worker {
+  int fd;
+  FILE* out;
+  char* buf;              // bytes read but not yet a whole line
+  size_t len;
+  size_t capacity;
+  long forwarded;         // links sent to it
+  long idleAt;            // links it had been sent when last idle, or -1
+} worker_t;
+
+/* Local constants */
+static const size_t READ_CHUNK = 65536;
+
+/* Private function prototypes */
+static void* readCoordinator(void* arg);
+static bool sendLine(partition_t* part, const char* line, const size_t len);
+static bool readWorker(worker_t* workers, const int numParts, const int w,
+                       int* nextDocID_p);
+static void handleLine(worker_t* workers, const int numParts, const int w,
+                       char* line, int* nextDocID_p);
+
+/* Public functions */
+int partition_of(const char* url, const int numParts)
+{
+  // the fingerprint's low bits pick the seen set's slot, so use the high
+  return (seenset_fingerprint(url) >> 32) % numParts;
+}
+
+partition_t* partition_open(const int fd, const int self, const int numParts,
+                   void* arg,
+                   void (*urlfunc)(void* arg, const char* url, int depth),
+                   void (*endfunc)(void* arg, bool finished))
+{
+  if (fd < 0 || numParts < 2 || self < 0 || self >= numParts
+      || urlfunc == NULL || endfunc == NULL) {
+    return NULL;
+  }
+  partition_t* part = malloc(sizeof(partition_t));
+  if (part == NULL) {
+    return NULL;
+  }
+  part->fd = fd;
+  part->self = self;
+  part->numParts = numParts;
+  part->arg = arg;
+  part->urlfunc = urlfunc;
+  part->endfunc = endfunc;
+  part->nextDocID = 0;
+  part->endDocID = 0;
+  part->requested = false;
+  part->lost = false;
+  pthread_mutex_init(&part->sendLock, NULL);
+  pthread_mutex_init(&part->rangeLock, NULL);
+  pthread_cond_init(&part->rangeCond, NULL);
+  if (pthread_create(&part->reader, NULL, readCoordinator, part) != 0) {
+    pthread_mutex_destroy(&part->sendLock);
+    pthread_mutex_destroy(&part->rangeLock);
+    pthread_cond_destroy(&part->rangeCond);
+    free(part);
+    return NULL;
+  }
+  return part;
+}
+
+bool partition_owns(const partition_t* part, const char* url)
+{
+  return part != NULL && url != NULL
+         && partition_of(url, part->numParts) == part->self;
+}
+
+bool partition_forward(partition_t* part, const char* url, const int depth)
+{
+  if (part == NULL || url == NULL || depth < 0) {
+    return false;
+  }
+  char line[strlen(url) + 32];
+  int len = sprintf(line, "U %d %s\n", depth, url);
+  return sendLine(part, line, len);
+}
+
+bool partition_idle(partition_t* part, const long received)
+{
+  if (part == NULL || received < 0) {
+    return false;
+  }
+  char line[32];
+  int len = sprintf(line, "I %ld\n", received);
+  return sendLine(part, line, len);
+}
+
+int partition_allocDocID(partition_t* part)
+{
+  if (part == NULL) {
+    return 0;
+  }
+  pthread_mutex_lock(&part->rangeLock);
+  while (part->nextDocID == part->endDocID && !part->lost) {
+    if (part->requested) {
+      pthread_cond_wait(&part->rangeCond, &part->rangeLock);
+      continue;
+    }
+    // not holding rangeLock, which the reader needs to take the reply
+    part->requested = true;
+    pthread_mutex_unlock(&part->rangeLock);
+    bool sent = sendLine(part, "R\n", 2);
+    pthread_mutex_lock(&part->rangeLock);
+    if (!sent) {
+      part->lost = true;
+    }
+  }
+  int docID = part->lost ? 0 : part->nextDocID++;
+  pthread_mutex_unlock(&part->rangeLock);
+  return docID;
+}
+
+void partition_close(partition_t* part)
+{
+  if (part == NULL) {
+    return;
+  }
+  // wakes the reader, if the coordinator hasn't closed its end already
+  shutdown(part->fd, SHUT_RDWR);
+  pthread_join(part->reader, NULL);
+  close(part->fd);
+  pthread_mutex_destroy(&part->sendLock);
+  pthread_mutex_destroy(&part->rangeLock);
+  pthread_cond_destroy(&part->rangeCond);
+  free(part);
+}
+
+bool partition_coordinate(const int* fds, const int numParts,
+                          int* lastDocID_p)
+{
+  if (fds == NULL || numParts < 1 || lastDocID_p == NULL) {
+    return false;
+  }
+  // a worker that has died is noticed by reading its socket, not writing
+  signal(SIGPIPE, SIG_IGN);
+
+  worker_t workers[numParts];
+  struct pollfd pfds[numParts];
+  bool ok = true;
+  for (int w = 0; w < numParts; w++) {
+    int fd = dup(fds[w]);
+    workers[w].fd = fds[w];
+    workers[w].out = fd == -1 ? NULL : fdopen(fd, "w");
+    workers[w].buf = NULL;
+    workers[w].len = 0;
+    workers[w].capacity = 0;
+    workers[w].forwarded = 0;
+    workers[w].idleAt = -1;
+    pfds[w].fd = fds[w];
+    pfds[w].events = POLLIN;
+    if (workers[w].out == NULL) {
+      if (fd != -1) {
+        close(fd);
+      }
+      ok = false;
+    }
+  }
+
+  int nextDocID = 1;
+  bool over = false;
+  while (ok && !over) {
+    if (poll(pfds, numParts, -1) == -1) {
+      ok = errno == EINTR;
+      continue;
+    }
+    for (int w = 0; ok && w < numParts; w++) {
+      if (pfds[w].revents != 0) {
+        ok = readWorker(workers, numParts, w, &nextDocID);
+      }
+    }
+    for (int w = 0; w < numParts; w++) {
+      if (workers[w].out != NULL) {
+        fflush(workers[w].out);
+      }
+    }
+
+    // only a busy worker finds links, and one is busy only while it has
+    // links it has not finished with: once none has, none ever will
+    over = true;
+    for (int w = 0; w < numParts; w++) {
+      if (workers[w].idleAt != workers[w].forwarded) {
+        over = false;
+      }
+    }
+  }
+
+  for (int w = 0; w < numParts; w++) {
+    if (workers[w].out != NULL) {
+      if (ok) {
+        fputs("D\n", workers[w].out);
+      }
+      fclose(workers[w].out);
+    }
+    close(workers[w].fd);
+    free(workers[w].buf);
+  }
+  *lastDocID_p = nextDocID - 1;
+  return ok;
+}
+
+int partition_compact(const char* pageDirectory, const int numParts,
+                      const int lastDocID)
+{
+  if (pageDirectory == NULL || numParts < 1 || lastDocID < 0) {
+    return -1;
+  }
+  // newID[docID] is what a page is renumbered to, or 0 if there is none
+  int* newID = calloc(lastDocID + 1, sizeof(int));
+  if (newID == NULL) {
+    return -1;
+  }
+  char from[strlen(pageDirectory) + 32];
+  char to[strlen(pageDirectory) + 32];
+  int numPages = 0;
+  for (int docID = 1; docID <= lastDocID; docID++) {
+    sprintf(from, "%s/%d", pageDirectory, docID);
+    if (access(from, F_OK) == 0) {
+      newID[docID] = docID;
+      numPages++;
+    }
+  }
+
+  // fill the lowest gap from the highest page, until they meet
+  int low = 1;
+  int high = lastDocID;
+  bool ok = true;
+  while (ok) {
+    while (low <= lastDocID && newID[low] != 0) {
+      low++;
+    }
+    while (high > 0 && newID[high] == 0) {
+      high--;
+    }
+    if (low >= high) {
+      break;
+    }
+    sprintf(from, "%s/%d", pageDirectory, high);
+    sprintf(to, "%s/%d", pageDirectory, low);
+    ok = rename(from, to) == 0;
+    newID[high] = low;
+    // marks the gap filled; no page moves here again
+    newID[low] = low;
+    high--;
+  }
+
+  // each page's validators are in the directory of the worker that
+  // saved it, and each docID belongs to one worker
+  sprintf(to, "%s/.validators", pageDirectory);
+  FILE* validators = ok ? fopen(to, "w") : NULL;
+  ok = validators != NULL;
+  for (int w = 0; w < numParts; w++) {
+    char dir[strlen(pageDirectory) + 32];
+    sprintf(dir, "%s/.part-%d", pageDirectory, w);
+    sprintf(from, "%s/.validators", dir);
+    FILE* fp = ok ? fopen(from, "r") : NULL;
+    if (fp != NULL) {
+      char* line;
+      while ((line = file_readLine(fp)) != NULL) {
+        int docID, rest;
+        if (sscanf(line, "%d%n", &docID, &rest) == 1 && docID > 0
+            && docID <= lastDocID && newID[docID] > 0) {
+          fprintf(validators, "%d%s\n", newID[docID], line + rest);
+        }
+        free(line);
+      }
+      fclose(fp);
+    }
+    if (ok) {
+      unlink(from);
+      rmdir(dir);
+    }
+  }
+  if (validators != NULL) {
+    ok = fclose(validators) == 0 && ok;
+  }
+  free(newID);
+  return ok ? numPages : -1;
+}
+
+/*
+ * Body of a worker's reading thread: passes each link forwarded on to
+ * urlfunc, and each range of docIDs to partition_allocDocID(), until
+ * the coordinator ends the crawl or the socket is lost
+ */
+static void* readCoordinator(void* arg)
+{
+  partition_t* part = arg;
+  int fd = dup(part->fd);
+  FILE* in = fd == -1 ? NULL : fdopen(fd, "r");
+  if (in == NULL && fd != -1) {
+    close(fd);
+  }
+  bool finished = false;
+  char* line;
+  while (!finished && in != NULL && (line = file_readLine(in)) != NULL) {
+    int depth, first, urlStart;
+    if (sscanf(line, "U %d %n", &depth, &urlStart) == 1) {
+      (*part->urlfunc)(part->arg, line + urlStart, depth);
+    } else if (sscanf(line, "R %d", &first) == 1) {
+      pthread_mutex_lock(&part->rangeLock);
+      part->nextDocID = first;
+      part->endDocID = first + PARTITION_RANGE;
+      part->requested = false;
+      pthread_cond_broadcast(&part->rangeCond);
+      pthread_mutex_unlock(&part->rangeLock);
+    } else if (strcmp(line, "D") == 0) {
+      finished = true;
+    }
+    free(line);
+  }
+  if (in != NULL) {
+    fclose(in);
+  }
+
+  pthread_mutex_lock(&part->rangeLock);
+  part->lost = true;
+  pthread_cond_broadcast(&part->rangeCond);
+  pthread_mutex_unlock(&part->rangeLock);
+  (*part->endfunc)(part->arg, finished);
+  return NULL;
+}
+
+/*
+ * Writes one whole line to the coordinator
+ */
+static bool sendLine(partition_t* part, const char* line, const size_t len)
+{
+  pthread_mutex_lock(&part->sendLock);
+  size_t sent = 0;
+  while (sent < len) {
+    ssize_t n = send(part->fd, line + sent, len - sent, MSG_NOSIGNAL);
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    sent += n;
+  }
+  pthread_mutex_unlock(&part->sendLock);
+  return sent == len;
+}
+
+/*
+ * Reads what worker w has sent and handles each whole line
+ *
+ * Returns:
+ *   false if its socket has closed, or on memory allocation failure
+ */
+static bool readWorker(worker_t* workers, const int numParts, const int w,
+                       int* nextDocID_p)
+{
+  worker_t* worker = &workers[w];
+  if (worker->capacity - worker->len < READ_CHUNK) {
+    char* buf = realloc(worker->buf, worker->len + READ_CHUNK);
+    if (buf == NULL) {
+      return false;
+    }
+    worker->buf = buf;
+    worker->capacity = worker->len + READ_CHUNK;
+  }
+  ssize_t n = read(worker->fd, worker->buf + worker->len, READ_CHUNK);
+  if (n == -1 && errno == EINTR) {
+    return true;
+  }
+  if (n <= 0) {
+    return false;
+  }
+  worker->len += n;
+
+  char* start = worker->buf;
+  char* end = worker->buf + worker->len;
+  char* newline;
+  while ((newline = memchr(start, '\n', end - start)) != NULL) {
+    *newline = '\0';
+    handleLine(workers, numParts, w, start, nextDocID_p);
+    start = newline + 1;
+  }
+  worker->len = end - start;
+  memmove(worker->buf, start, worker->len);
+  return true;
+}
+
+/*
+ * Handles one line from worker w: routes a link to its owner, hands out
+ * a range of docIDs, or notes the worker idle
+ */
+static void handleLine(worker_t* workers, const int numParts, const int w,
+                       char* line, int* nextDocID_p)
+{
+  int depth, urlStart;
+  long received;
+  if (sscanf(line, "U %d %n", &depth, &urlStart) == 1) {
+    worker_t* owner = &workers[partition_of(line + urlStart, numParts)];
+    fprintf(owner->out, "U %d %s\n", depth, line + urlStart);
+    owner->forwarded++;
+  } else if (strcmp(line, "R") == 0) {
+    fprintf(workers[w].out, "R %d\n", *nextDocID_p);
+    *nextDocID_p += PARTITION_RANGE;
+  } else if (sscanf(line, "I %ld", &received) == 1) {
+    // reports can pass each other; a later one never counts fewer links
+    if (received > workers[w].idleAt) {
+      workers[w].idleAt = received;
+    }
+  }
+}
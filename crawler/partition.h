@@ -0,0 +1,152 @@
+/*
+ * partition.h - header file for partition.c
+ *
+ * Splits one crawl across several crawler processes on one machine.
+ * The space of normalized URLs is cut into numParts partitions by the
+ * URL's fingerprint (see seenset_fingerprint()), and each process, a
+ * worker, owns one: only it keeps that partition's URLs in its frontier
+ * and seen set, fetches them, and saves them. A worker finding a link
+ * in another partition forwards it to the coordinator, the process that
+ * started the workers, which passes it on to the owner. Every worker
+ * talks to the coordinator over one Unix socket, in lines of text:
+ *
+ *   worker to coordinator        coordinator to worker
+ *   U depth URL  a link found    U depth URL  a link forwarded to it
+ *   R            docIDs wanted   R first      docIDs first..first+63
+ *   I received   worker idle     D            the crawl is over
+ *
+ * DocIDs are handed out by the coordinator in ranges of PARTITION_RANGE,
+ * so no two workers ever give out the same one. A worker reports itself
+ * idle, with how many links it has been forwarded, whenever it runs out
+ * of work; the crawl is over once every worker is idle and has been
+ * forwarded nothing since, because only a busy worker finds new links.
+ *
+ * The ranges a worker was still using when the crawl ended leave gaps
+ * in the docIDs, which partition_compact() closes afterwards.
+ *
+ * Thread-safe on the worker's side; the coordinator's functions are
+ * called from one thread.
+ *
+ * Hugo Fang, 3/4/2024
+ */
+
+#ifndef __PARTITION_H__
+#define __PARTITION_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* Public types */
+typedef struct partition partition_t;
+
+/* Number of docIDs in each range the coordinator hands out */
+#define PARTITION_RANGE 64
+
+/*
+ * Returns which of numParts partitions (0 to numParts-1) a normalized
+ * URL belongs to
+ */
+int partition_of(const char* url, const int numParts);
+
+/*
+ * Open a worker's end of its socket to the coordinator, and start a
+ * thread to read it
+ *
+ * Input:
+ *   fd: the worker's end of the socket, which the partition_t now owns
+ *   self: the partition this worker owns, 0 to numParts-1
+ *   numParts: number of partitions, at least 2
+ *   arg: passed through to both functions
+ *   urlfunc: called, on the reading thread, with each link forwarded to
+ *     this worker and its depth; the URL belongs to the caller only for
+ *     the call
+ *   endfunc: called once, on the reading thread, when the coordinator
+ *     ends the crawl (finished true), or when the socket is lost (false)
+ *
+ * Returns:
+ *   pointer to new partition_t, or NULL on error
+ *
+ * Caller is responsible for calling partition_close() on the returned
+ * pointer
+ */
+partition_t* partition_open(const int fd, const int self, const int numParts,
+                   void* arg,
+                   void (*urlfunc)(void* arg, const char* url, int depth),
+                   void (*endfunc)(void* arg, bool finished));
+
+/*
+ * Returns true if this worker owns the normalized URL
+ */
+bool partition_owns(const partition_t* part, const char* url);
+
+/*
+ * Forward a link this worker does not own to the coordinator
+ *
+ * Returns:
+ *   false on a write error
+ */
+bool partition_forward(partition_t* part, const char* url, const int depth);
+
+/*
+ * Report the worker idle: its frontier is empty, nothing is in
+ * progress, and every link forwarded to it so far, `received` of them,
+ * has been added to its frontier (or found already seen)
+ *
+ * Returns:
+ *   false on a write error
+ */
+bool partition_idle(partition_t* part, const long received);
+
+/*
+ * Hands out the next docID from this worker's range, first asking the
+ * coordinator for a new range if it is used up, and waiting for it
+ *
+ * Returns:
+ *   the docID, or 0 if the socket is lost
+ */
+int partition_allocDocID(partition_t* part);
+
+/*
+ * Close the socket, wait for the reading thread, and delete a
+ * partition_t created by partition_open()
+ */
+void partition_close(partition_t* part);
+
+/*
+ * Run the coordinator: route links between the workers and hand out
+ * docID ranges, until every worker is idle, then tell them all the
+ * crawl is over
+ *
+ * Input:
+ *   fds: the coordinator's end of each worker's socket, fds[i] for
+ *     partition i; they are closed before returning
+ *   numParts: number of workers
+ *   lastDocID_p: set to the last docID of the last range handed out
+ *     (0 if none)
+ *
+ * Returns:
+ *   false if a worker's socket closed before the crawl was over
+ */
+bool partition_coordinate(const int* fds, const int numParts,
+                          int* lastDocID_p);
+
+/*
+ * Close the gaps left in the docIDs of a partitioned crawl: moves the
+ * highest-numbered page files into the missing docIDs below them, so
+ * the pages are numbered 1 to n, and combines each worker's validators,
+ * in "pageDirectory/.part-<i>/.validators", into the page directory's,
+ * renumbered to match. Removes the workers' directories.
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   numParts: number of workers
+ *   lastDocID: the highest docID any worker could have used
+ *
+ * Returns:
+ *   the number of pages, or -1 on error
+ */
+int partition_compact(const char* pageDirectory, const int numParts,
+                      const int lastDocID);
+
+#endif // __PARTITION_H__
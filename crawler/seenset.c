@@ -0,0 +1,192 @@
+/*
+ * seenset.c    Hugo Fang    2/25/2024
+ *
+ * See seenset.h for details
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "seenset.h"
+
+/* Public types */
+typedef struct seenset {
+  // fingerprints, with 0 marking an empty slot; capacity is a power of 2
+  uint64_t* slots;
+  size_t capacity;
+  int size;
+} seenset_t;
+
+/* Private function prototypes */
+static size_t findSlot(const seenset_t* set, const uint64_t fp);
+static bool insertFingerprint(seenset_t* set, const uint64_t fp);
+static bool grow(seenset_t* set);
+
+/* Public functions */
+seenset_t* seenset_new(const int expected)
+{
+  seenset_t* set = malloc(sizeof(seenset_t));
+  if (set == NULL) {
+    return NULL;
+  }
+  // smallest power of 2 that holds `expected` under the load limit
+  set->capacity = 16;
+  while (expected > 0 && set->capacity / 4 * 3 < (size_t)expected) {
+    set->capacity *= 2;
+  }
+  set->slots = calloc(set->capacity, sizeof(uint64_t));
+  if (set->slots == NULL) {
+    free(set);
+    return NULL;
+  }
+  set->size = 0;
+  return set;
+}
+
+bool seenset_insert(seenset_t* set, const char* url)
+{
+  if (set == NULL || url == NULL) {
+    return false;
+  }
+  return insertFingerprint(set, seenset_fingerprint(url));
+}
+
+bool seenset_contains(const seenset_t* set, const char* url)
+{
+  if (set == NULL || url == NULL) {
+    return false;
+  }
+  uint64_t fp = seenset_fingerprint(url);
+  return set->slots[findSlot(set, fp)] == fp;
+}
+
+int seenset_size(const seenset_t* set)
+{
+  return set ? set->size : 0;
+}
+
+bool seenset_save(const seenset_t* set, FILE* fp)
+{
+  if (set == NULL || fp == NULL) {
+    return false;
+  }
+  uint64_t count = set->size;
+  if (fwrite(&count, sizeof(count), 1, fp) != 1) {
+    return false;
+  }
+  for (size_t i = 0; i < set->capacity; i++) {
+    if (set->slots[i] != 0
+        && fwrite(&set->slots[i], sizeof(uint64_t), 1, fp) != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+seenset_t* seenset_load(FILE* fp)
+{
+  uint64_t count;
+  if (fp == NULL || fread(&count, sizeof(count), 1, fp) != 1) {
+    return NULL;
+  }
+  seenset_t* set = seenset_new(count);
+  if (set == NULL) {
+    return NULL;
+  }
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t fingerprint;
+    if (fread(&fingerprint, sizeof(fingerprint), 1, fp) != 1
+        || fingerprint == 0) {
+      seenset_delete(set);
+      return NULL;
+    }
+    insertFingerprint(set, fingerprint);
+  }
+  return set;
+}
+
+void seenset_delete(seenset_t* set)
+{
+  if (set != NULL) {
+    free(set->slots);
+    free(set);
+  }
+}
+
+uint64_t seenset_fingerprint(const char* url)
+{
+  // FNV-1a over the bytes, then a final mix so the low bits used to
+  // pick a slot depend on every byte
+  uint64_t h = 14695981039346656037ULL;
+  for (const unsigned char* p = (const unsigned char*)url; *p != '\0'; p++) {
+    h ^= *p;
+    h *= 1099511628211ULL;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h != 0 ? h : 1;
+}
+
+/*
+ * Adds a fingerprint; returns false if it was already there or on
+ * memory allocation failure
+ */
+static bool insertFingerprint(seenset_t* set, const uint64_t fp)
+{
+  size_t slot = findSlot(set, fp);
+  if (set->slots[slot] == fp) {
+    return false;
+  }
+
+  // keep the table at most 3/4 full so probes stay short
+  if ((size_t)(set->size + 1) > set->capacity / 4 * 3) {
+    if (!grow(set)) {
+      return false;
+    }
+    slot = findSlot(set, fp);
+  }
+  set->slots[slot] = fp;
+  set->size++;
+  return true;
+}
+
+/*
+ * Linear probing: returns the slot holding fp, or else the empty slot
+ * where it would go
+ */
+static size_t findSlot(const seenset_t* set, const uint64_t fp)
+{
+  size_t mask = set->capacity - 1;
+  size_t slot = fp & mask;
+  while (set->slots[slot] != 0 && set->slots[slot] != fp) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/*
+ * Doubles the table and reinserts every fingerprint
+ */
+static bool grow(seenset_t* set)
+{
+  uint64_t* old = set->slots;
+  size_t oldCapacity = set->capacity;
+  uint64_t* slots = calloc(oldCapacity * 2, sizeof(uint64_t));
+  if (slots == NULL) {
+    return false;
+  }
+  set->slots = slots;
+  set->capacity = oldCapacity * 2;
+  for (size_t i = 0; i < oldCapacity; i++) {
+    if (old[i] != 0) {
+      set->slots[findSlot(set, old[i])] = old[i];
+    }
+  }
+  free(old);
+  return true;
+}
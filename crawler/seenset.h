@@ -0,0 +1,95 @@
+/*
+ * seenset.h - header file for seenset.c
+ *
+ * Set of URLs the crawler has already seen. Only a 64-bit fingerprint
+ * of each URL is kept, in an open-addressed table that doubles when it
+ * is three-quarters full, so a lookup is one hash and a short probe and
+ * each URL costs 11-21 bytes however long it is. Two different URLs
+ * share a fingerprint with probability about n^2 / 2^65 over n URLs
+ * (under one in ten million for a million URLs), in which case the
+ * second is taken for a duplicate and not crawled.
+ *
+ * Not thread-safe: callers sharing a set must hold a lock.
+ *
+ * Hugo Fang, 2/25/2024
+ */
+
+#ifndef __SEENSET_H__
+#define __SEENSET_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Public types */
+typedef struct seenset seenset_t;
+
+/*
+ * Allocate and initialize an empty set
+ *
+ * Input:
+ *   expected: how many URLs to make room for before the first growth
+ *     (may be 0)
+ *
+ * Returns:
+ *   pointer to new seenset_t, or NULL on any error
+ *
+ * Caller is responsible for calling seenset_delete() on the returned pointer
+ */
+seenset_t* seenset_new(const int expected);
+
+/*
+ * Add a URL to the set
+ *
+ * Input:
+ *   set: the set
+ *   url: the URL; not kept
+ *
+ * Returns:
+ *   true if the URL was new and is now in the set
+ *   false if it was already there, or any argument is NULL, or on
+ *   memory allocation failure
+ */
+bool seenset_insert(seenset_t* set, const char* url);
+
+/*
+ * Returns true if the URL is in the set
+ */
+bool seenset_contains(const seenset_t* set, const char* url);
+
+/*
+ * Returns the number of URLs in the set
+ */
+int seenset_size(const seenset_t* set);
+
+/*
+ * Write the set's fingerprints to a file opened for binary writing
+ *
+ * Returns:
+ *   false if any argument is NULL or on write failure
+ */
+bool seenset_save(const seenset_t* set, FILE* fp);
+
+/*
+ * Read a set written by seenset_save()
+ *
+ * Returns:
+ *   pointer to a new seenset_t, or NULL if the file is cut short or on
+ *   memory allocation failure
+ *
+ * Caller is responsible for calling seenset_delete() on the returned pointer
+ */
+seenset_t* seenset_load(FILE* fp);
+
+/*
+ * Delete a set created by seenset_new()
+ */
+void seenset_delete(seenset_t* set);
+
+/*
+ * Returns the 64-bit fingerprint the set keeps for a URL (never 0)
+ */
+uint64_t seenset_fingerprint(const char* url);
+
+#endif // __SEENSET_H__
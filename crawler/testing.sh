@@ -31,6 +31,73 @@ mkdir -p $argDir
 # negative maxDepth
 ./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir -1
 
+# missing or non-positive numThreads
+./crawler -j http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler -j 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# non-positive maxInFlight; -j and -e together
+./crawler -e 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler -j 2 -e 8 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# missing or negative delayMillis
+./crawler -d http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler -d -5 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# non-positive frontierKB
+./crawler -m 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# negative checkpointSecs
+./crawler -c -1 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# maxDistance out of range
+./crawler -s 4 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# non-positive numParsers and queueDepth
+./crawler -p 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler -p 2 -q 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# syncEvery out of range
+./crawler -f 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler -f 257 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# --connect-to without a port, and with a bad address
+./crawler --connect-to 127.0.0.1 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler --connect-to localhost:80 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# --timeouts without all three deadlines, and with a negative one
+./crawler --timeouts 1000,2000 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler --timeouts 1000,-1,5000 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# --max-page of no kilobytes
+./crawler --max-page 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# index file that cannot be written
+./crawler -i ./nonexistent/letters.index http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# non-positive numProcesses, and -P with an option it can't be used with
+./crawler -P 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler -P 2 --resume http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# --links with -P
+./crawler --links -P 2 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# --record with --replay, and an archive that doesn't exist to replay
+./crawler --record ../data/letters.warc --replay ../data/letters.warc http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler --replay ./nonexistent.warc http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+# --adapt with a ceiling below its floor, and with a floor of 0
+./crawler --adapt 4,2 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+./crawler --adapt 0,4 http://cs50tse.cs.dartmouth.edu/tse/letters/ $argDir 1
+
+
+# -----URL normalization-----
+# scheme and host lowercased, dot segments removed, query and fragment kept
+./urltest HTTP://UsEr@CS50TSE.cs.dartmouth.edu/tse/a/../letters/./index.html?x=1#top
+# no path: nothing, or a query or fragment straight after the host
+./urltest http://CS50TSE.cs.dartmouth.edu http://cs50tse.cs.dartmouth.edu?q=1 http://cs50tse.cs.dartmouth.edu#top
+# relative, and a file unlikely to be html
+./urltest tse/letters/index.html http://cs50tse.cs.dartmouth.edu/tse/logo.png
+
 
 # -----Valgrind tests-----
 # valgrindDir="../data/valgrind"
@@ -57,6 +124,64 @@ mkdir $lettersDir $toscrapeDir $wikiDir
 # letters - maxDepth 10
 ./crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
 
+# letters - maxDepth 10, 4 worker threads
+./crawler -j 4 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+
+# letters - maxDepth 10, event-driven with 32 fetches in flight
+./crawler -e 32 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+
+# letters - maxDepth 10, pipelined: 4 fetchers, 2 parsers, queues of 4
+./crawler -j 4 -p 2 -q 4 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+
+# letters - maxDepth 10, pages synced to disk in groups of 8
+./crawler -f 8 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+
+# letters - maxDepth 10, indexed as it is crawled
+./crawler -i ../data/letters.index http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+
+# letters - maxDepth 10, with its link graph
+./crawler --links http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+ls -A ../data/letters | grep links
+
+# letters - maxDepth 10, recorded, then replayed offline from the archive
+./crawler --record ../data/letters.warc http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+./crawler --replay ../data/letters.warc --connect-to 127.0.0.1:1 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+ls ../data/letters | wc -l
+
+# letters - maxDepth 10, with 8 fetches outstanding and each host's
+# share adapting between 1 and 8
+./crawler -e 8 --adapt 1,8 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+ls ../data/letters | wc -l
+
+# letters - maxDepth 10, split across 3 processes; docIDs still 1 to n
+./crawler -P 3 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+ls ../data/letters | sort -n | tail -1
+
+# letters - maxDepth 10, 4 worker threads, half-second per-host delay
+./crawler -j 4 -d 500 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+
+# letters - maxDepth 10, frontier spilled to disk beyond 1KB
+./crawler -m 1 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+ls -A ../data/letters | grep frontier
+
+# letters - maxDepth 10, killed after a checkpoint and resumed
+./crawler -c 1 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10 &
+sleep 5; kill -9 $!; wait
+./crawler --resume http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+ls ../data/letters | wc -l
+
+
+# letters - maxDepth 10, byte-identical pages recorded as aliases
+./crawler -s 0 http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+cat ../data/letters/.aliases
+
+# letters - recrawl: every page unchanged, so none listed as changed
+./crawler --recrawl http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+cat ../data/letters/.changed
+
+# --resume and --recrawl together
+./crawler --resume --recrawl http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/letters 10
+
 
 # ---toscrape---
 toscrape - maxDepth 0
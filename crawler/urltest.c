@@ -0,0 +1,34 @@
+/*
+ * urltest.c    Hugo Fang    3/12/2024
+ *
+ * Normalizes each URL given, as the crawler normalizes seed URLs and
+ * links, and prints the result on a line of its own, or "(null)" if
+ * the URL cannot be normalized.
+ *
+ * Usage: ./urltest url...
+ *
+ * Exits with:
+ *   0 if normal return
+ *   errno 1 if no URL is given
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// libcs50.a
+#include "webpage.h"
+
+int main(const int argc, char* argv[])
+{
+  // one for "./urltest", at least one URL
+  if (argc < 2) {
+    exit(1);
+  }
+  for (int i = 1; i < argc; i++) {
+    char* url = normalizeURL(argv[i]);
+    printf("%s\n", url != NULL ? url : "(null)");
+    free(url);
+  }
+  return 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * validators.c    Hugo Fang    2/28/2024
+ *
+ * See validators.h for details
+ */
+
+#define _POSIX_C_SOURCE 200809L   // strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// libcs50.a
+#include "file.h"
+
+#include "validators.h"
+
+/* Local types */
+typedef struct entry {
+  char* etag;             // NULL if none
+  char* lastModified;     // NULL if none
+} entry_t;
+
+/* Public types */
+typedef struct validators {
+  FILE* fp;               // the file, open for appending
+  // entries[docID] for the pages read from the file; docIDs are dense,
+  // so an array indexed by docID holds them all
+  entry_t* entries;
+  int numEntries;
+} validators_t;
+
+/* Private function prototypes */
+static bool parseLine(char* line, int* docID_p, char** etag_p,
+                      char** lastModified_p);
+static bool writeLine(FILE* fp, const int docID, const char* etag,
+                      const char* lastModified);
+static bool writable(const char* value);
+static bool sameValue(const char* a, const char* b);
+static char* copyValue(const char* value);
+
+/* Public functions */
+validators_t* validators_open(const char* pageDirectory, const int nextDocID)
+{
+  if (pageDirectory == NULL || nextDocID <= 0) {
+    return NULL;
+  }
+  validators_t* v = malloc(sizeof(validators_t));
+  if (v == NULL) {
+    return NULL;
+  }
+  v->fp = NULL;
+  v->numEntries = nextDocID;
+  v->entries = calloc(nextDocID, sizeof(entry_t));
+  if (v->entries == NULL) {
+    free(v);
+    return NULL;
+  }
+
+  size_t dirLen = strlen(pageDirectory);
+  char path[dirLen + strlen("/.validators.tmp") + 1];
+  char tmpPath[dirLen + strlen("/.validators.tmp") + 1];
+  sprintf(path, "%s/.validators", pageDirectory);
+  sprintf(tmpPath, "%s/.validators.tmp", pageDirectory);
+
+  // read the old file, if any; later lines replace earlier ones
+  FILE* old = nextDocID > 1 ? fopen(path, "r") : NULL;
+  if (old != NULL) {
+    char* line;
+    while ((line = file_readLine(old)) != NULL) {
+      int docID;
+      char* etag;
+      char* lastModified;
+      if (parseLine(line, &docID, &etag, &lastModified)
+          && docID < nextDocID) {
+        entry_t* entry = &v->entries[docID];
+        free(entry->etag);
+        free(entry->lastModified);
+        entry->etag = copyValue(etag);
+        entry->lastModified = copyValue(lastModified);
+      }
+      free(line);
+    }
+    fclose(old);
+  }
+
+  // write back one line per page, then append to that
+  FILE* fp = fopen(tmpPath, "w");
+  bool ok = fp != NULL;
+  for (int docID = 1; ok && docID < nextDocID; docID++) {
+    entry_t* entry = &v->entries[docID];
+    if (entry->etag != NULL || entry->lastModified != NULL) {
+      ok = writeLine(fp, docID, entry->etag, entry->lastModified);
+    }
+  }
+  if (fp != NULL) {
+    ok = (fclose(fp) == 0) && ok;
+  }
+  if (ok && rename(tmpPath, path) == 0) {
+    v->fp = fopen(path, "a");
+  }
+  if (v->fp == NULL) {
+    validators_close(v);
+    return NULL;
+  }
+  return v;
+}
+
+bool validators_get(const validators_t* v, const int docID,
+                    const char** etag_p, const char** lastModified_p)
+{
+  if (v == NULL || etag_p == NULL || lastModified_p == NULL) {
+    return false;
+  }
+  *etag_p = NULL;
+  *lastModified_p = NULL;
+  if (docID <= 0 || docID >= v->numEntries) {
+    return false;
+  }
+  *etag_p = v->entries[docID].etag;
+  *lastModified_p = v->entries[docID].lastModified;
+  return *etag_p != NULL || *lastModified_p != NULL;
+}
+
+bool validators_put(validators_t* v, const int docID, const char* etag,
+                    const char* lastModified)
+{
+  if (v == NULL || docID <= 0) {
+    return false;
+  }
+  etag = writable(etag) ? etag : NULL;
+  lastModified = writable(lastModified) ? lastModified : NULL;
+
+  if (docID < v->numEntries) {
+    // a page read from the file: record only a change
+    entry_t* entry = &v->entries[docID];
+    if (sameValue(entry->etag, etag)
+        && sameValue(entry->lastModified, lastModified)) {
+      return true;
+    }
+    free(entry->etag);
+    free(entry->lastModified);
+    entry->etag = copyValue(etag);
+    entry->lastModified = copyValue(lastModified);
+  } else if (etag == NULL && lastModified == NULL) {
+    return true;
+  }
+  return writeLine(v->fp, docID, etag, lastModified);
+}
+
+bool validators_flush(validators_t* v)
+{
+  return v != NULL && fflush(v->fp) == 0;
+}
+
+void validators_close(validators_t* v)
+{
+  if (v != NULL) {
+    if (v->fp != NULL) {
+      fclose(v->fp);
+    }
+    for (int docID = 0; docID < v->numEntries; docID++) {
+      free(v->entries[docID].etag);
+      free(v->entries[docID].lastModified);
+    }
+    free(v->entries);
+    free(v);
+  }
+}
+
+/*
+ * Splits a line of the file in place into its docID and values; a value
+ * of "-" becomes NULL
+ *
+ * Returns false if the line is malformed
+ */
+static bool parseLine(char* line, int* docID_p, char** etag_p,
+                      char** lastModified_p)
+{
+  char* etag = strchr(line, '\t');
+  char* lastModified = etag ? strchr(etag + 1, '\t') : NULL;
+  if (lastModified == NULL) {
+    return false;
+  }
+  *etag++ = '\0';
+  *lastModified++ = '\0';
+  char extra;
+  if (sscanf(line, "%d%c", docID_p, &extra) != 1 || *docID_p <= 0) {
+    return false;
+  }
+  *etag_p = strcmp(etag, "-") == 0 ? NULL : etag;
+  *lastModified_p = strcmp(lastModified, "-") == 0 ? NULL : lastModified;
+  return true;
+}
+
+/*
+ * Writes one line of the file; returns false on a write error
+ */
+static bool writeLine(FILE* fp, const int docID, const char* etag,
+                      const char* lastModified)
+{
+  return fprintf(fp, "%d\t%s\t%s\n", docID, etag ? etag : "-",
+                 lastModified ? lastModified : "-") > 0;
+}
+
+/*
+ * Returns true if a value can be written in a line of the file as is
+ */
+static bool writable(const char* value)
+{
+  return value != NULL && *value != '\0' && strcmp(value, "-") != 0
+         && strpbrk(value, "\t\r\n") == NULL;
+}
+
+/*
+ * Returns true if a and b are both NULL or equal strings
+ */
+static bool sameValue(const char* a, const char* b)
+{
+  return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+/*
+ * Returns a copy of value, or NULL if it is NULL or out of memory
+ */
+static char* copyValue(const char* value)
+{
+  return value ? strdup(value) : NULL;
+}
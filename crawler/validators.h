@@ -0,0 +1,88 @@
+/*
+ * validators.h - header file for validators.c
+ *
+ * Keeps the validators (the ETag and Last-Modified headers) sent with
+ * each page saved in a page directory, so that a later crawl with
+ * --recrawl can ask the server for each page only if it has changed.
+ * They live in "pageDirectory/.validators", one line per page:
+ *
+ *   docID<TAB>ETag<TAB>Last-Modified
+ *
+ * with "-" for a header the server did not send. Pages sent with
+ * neither get no line. The file is appended to as pages are saved, so
+ * a page fetched again with new validators gets a second line; the
+ * last line for each docID wins, and the file is compacted when opened.
+ *
+ * Not thread-safe: callers sharing a validators_t must hold a lock.
+ *
+ * Hugo Fang, 2/28/2024
+ */
+
+#ifndef __VALIDATORS_H__
+#define __VALIDATORS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* Public types */
+typedef struct validators validators_t;
+
+/*
+ * Read the validators in pageDirectory, if any, and open them for
+ * appending
+ *
+ * Input:
+ *   pageDirectory: the crawl's page directory
+ *   nextDocID: the next docID the crawl will hand out; lines for docIDs
+ *     at or above it (pages saved after the checkpoint being resumed
+ *     from, which will be crawled again) are dropped, so a new crawl
+ *     (nextDocID 1) starts with none
+ *
+ * Returns:
+ *   pointer to new validators_t, or NULL if the file can't be rewritten
+ *   or on memory allocation failure
+ *
+ * Caller is responsible for calling validators_close() on the returned
+ * pointer
+ */
+validators_t* validators_open(const char* pageDirectory, const int nextDocID);
+
+/*
+ * Find the validators of a page saved before validators_open()
+ *
+ * Input:
+ *   docID: the page
+ *   etag_p, lastModified_p: set to the page's validators, or to NULL for
+ *     those it has none of; the strings belong to v
+ *
+ * Returns:
+ *   true if the page has at least one validator
+ */
+bool validators_get(const validators_t* v, const int docID,
+                    const char** etag_p, const char** lastModified_p);
+
+/*
+ * Record the validators a page was saved (or found unchanged) with,
+ * unless they are what was already recorded for it; either may be NULL
+ *
+ * Returns:
+ *   false if any argument is invalid or on a write error
+ */
+bool validators_put(validators_t* v, const int docID, const char* etag,
+                    const char* lastModified);
+
+/*
+ * Write out any validators still buffered, e.g. before a checkpoint
+ *
+ * Returns:
+ *   false on a write error
+ */
+bool validators_flush(validators_t* v);
+
+/*
+ * Close the file and delete a validators_t created by validators_open()
+ */
+void validators_close(validators_t* v);
+
+#endif // __VALIDATORS_H__
@@ -0,0 +1,181 @@
+/*
+ * workqueue.c    Hugo Fang    3/1/2024
+ *
+ * See workqueue.h for details
+ */
+
+#define _POSIX_C_SOURCE 200809L   // clock_gettime
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "workqueue.h"
+
+/* Public types */
+typedef struct workqueue {
+  // items[head], items[head+1], ... (mod capacity), `size` of them
+  void** items;
+  int capacity;
+  int head;
+  int size;
+  bool closed;
+  pthread_mutex_t lock;
+  pthread_cond_t notFull;
+  pthread_cond_t notEmpty;
+
+  // statistics, guarded by lock
+  long puts;
+  long depthSum;
+  int maxDepth;
+  long putWaitMillis;
+  long takeWaitMillis;
+} workqueue_t;
+
+/* Private function prototypes */
+static long nowMillis(void);
+
+/* Public functions */
+workqueue_t* workqueue_new(const int capacity)
+{
+  if (capacity <= 0) {
+    return NULL;
+  }
+  workqueue_t* q = malloc(sizeof(workqueue_t));
+  if (q == NULL) {
+    return NULL;
+  }
+  q->items = malloc(sizeof(void*) * capacity);
+  if (q->items == NULL) {
+    free(q);
+    return NULL;
+  }
+  q->capacity = capacity;
+  q->head = 0;
+  q->size = 0;
+  q->closed = false;
+  pthread_mutex_init(&q->lock, NULL);
+  pthread_cond_init(&q->notFull, NULL);
+  pthread_cond_init(&q->notEmpty, NULL);
+  q->puts = 0;
+  q->depthSum = 0;
+  q->maxDepth = 0;
+  q->putWaitMillis = 0;
+  q->takeWaitMillis = 0;
+  return q;
+}
+
+bool workqueue_put(workqueue_t* q, void* item)
+{
+  if (q == NULL || item == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&q->lock);
+  if (q->size == q->capacity && !q->closed) {
+    long start = nowMillis();
+    while (q->size == q->capacity && !q->closed) {
+      pthread_cond_wait(&q->notFull, &q->lock);
+    }
+    q->putWaitMillis += nowMillis() - start;
+  }
+  if (q->closed) {
+    pthread_mutex_unlock(&q->lock);
+    return false;
+  }
+
+  q->depthSum += q->size;
+  q->puts++;
+  q->items[(q->head + q->size) % q->capacity] = item;
+  q->size++;
+  if (q->size > q->maxDepth) {
+    q->maxDepth = q->size;
+  }
+  pthread_cond_signal(&q->notEmpty);
+  pthread_mutex_unlock(&q->lock);
+  return true;
+}
+
+void* workqueue_take(workqueue_t* q)
+{
+  void* item = NULL;
+  workqueue_takeBatch(q, &item, 1);
+  return item;
+}
+
+int workqueue_takeBatch(workqueue_t* q, void** items, const int max)
+{
+  if (q == NULL || items == NULL || max <= 0) {
+    return 0;
+  }
+  pthread_mutex_lock(&q->lock);
+  if (q->size == 0 && !q->closed) {
+    long start = nowMillis();
+    while (q->size == 0 && !q->closed) {
+      pthread_cond_wait(&q->notEmpty, &q->lock);
+    }
+    q->takeWaitMillis += nowMillis() - start;
+  }
+  int taken = 0;
+  for (; taken < max && q->size > 0; taken++) {
+    items[taken] = q->items[q->head];
+    q->head = (q->head + 1) % q->capacity;
+    q->size--;
+  }
+  if (taken > 0) {
+    pthread_cond_broadcast(&q->notFull);
+  }
+  pthread_mutex_unlock(&q->lock);
+  return taken;
+}
+
+void workqueue_close(workqueue_t* q)
+{
+  if (q != NULL) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = true;
+    pthread_cond_broadcast(&q->notFull);
+    pthread_cond_broadcast(&q->notEmpty);
+    pthread_mutex_unlock(&q->lock);
+  }
+}
+
+void workqueue_stats(workqueue_t* q, workqueueStats_t* stats)
+{
+  if (q == NULL || stats == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&q->lock);
+  stats->capacity = q->capacity;
+  stats->puts = q->puts;
+  stats->meanDepth = q->puts > 0 ? (double)q->depthSum / q->puts : 0;
+  stats->maxDepth = q->maxDepth;
+  stats->putWaitMillis = q->putWaitMillis;
+  stats->takeWaitMillis = q->takeWaitMillis;
+  pthread_mutex_unlock(&q->lock);
+}
+
+void workqueue_delete(workqueue_t* q, void (*itemdelete)(void* item))
+{
+  if (q != NULL) {
+    for (int i = 0; itemdelete != NULL && i < q->size; i++) {
+      itemdelete(q->items[(q->head + i) % q->capacity]);
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->notFull);
+    pthread_cond_destroy(&q->notEmpty);
+    free(q->items);
+    free(q);
+  }
+}
+
+/*
+ * Returns the monotonic clock, in milliseconds
+ */
+static long nowMillis(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000L + now.tv_nsec / 1000000L;
+}
@@ -0,0 +1,98 @@
+/*
+ * workqueue.h - header file for workqueue.c
+ *
+ * A bounded first-in, first-out queue for handing work from the threads
+ * of one crawler stage to those of the next. Putting to a full queue
+ * blocks until there is room, so a slow stage holds back the stages
+ * feeding it instead of letting work pile up in memory; taking from an
+ * empty queue blocks until there is work, or the queue is closed.
+ *
+ * Each queue keeps statistics: how deep it was as items went in, and
+ * how long producers waited for room and consumers waited for work. A
+ * queue that is usually full points to its consumer stage as the limit
+ * on throughput; one that is usually empty, to its producer.
+ *
+ * Thread-safe.
+ *
+ * Hugo Fang, 3/1/2024
+ */
+
+#ifndef __WORKQUEUE_H__
+#define __WORKQUEUE_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* Public types */
+typedef struct workqueue workqueue_t;
+
+typedef struct workqueueStats {
+  int capacity;           // most items the queue holds
+  long puts;              // items put so far
+  double meanDepth;       // mean number of items already queued at a put
+  int maxDepth;           // most items queued at once
+  long putWaitMillis;     // total time producers waited for room
+  long takeWaitMillis;    // total time consumers waited for work
+} workqueueStats_t;
+
+/*
+ * Allocate and initialize an empty queue
+ *
+ * Input:
+ *   capacity: most items the queue holds (> 0)
+ *
+ * Returns:
+ *   pointer to new workqueue_t, or NULL if capacity is not positive or
+ *   on memory allocation failure
+ *
+ * Caller is responsible for calling workqueue_delete() on the returned
+ * pointer
+ */
+workqueue_t* workqueue_new(const int capacity);
+
+/*
+ * Add an item (not NULL) at the back, waiting while the queue is full
+ *
+ * Returns:
+ *   true if added, false if any argument is invalid or the queue has
+ *   been closed (the item then still belongs to the caller)
+ */
+bool workqueue_put(workqueue_t* q, void* item);
+
+/*
+ * Remove the item at the front, waiting while the queue is empty
+ *
+ * Returns:
+ *   the item, or NULL once the queue is closed and empty
+ */
+void* workqueue_take(workqueue_t* q);
+
+/*
+ * Like workqueue_take(), but removes up to max items at once, in order,
+ * into items; waits only while the queue is empty
+ *
+ * Returns:
+ *   the number of items removed, or 0 once the queue is closed and empty
+ */
+int workqueue_takeBatch(workqueue_t* q, void** items, const int max);
+
+/*
+ * Close the queue: no more items may be put, and workqueue_take()
+ * returns NULL once those already queued are taken; wakes every thread
+ * waiting on the queue
+ */
+void workqueue_close(workqueue_t* q);
+
+/*
+ * Fill in stats with the queue's statistics so far
+ */
+void workqueue_stats(workqueue_t* q, workqueueStats_t* stats);
+
+/*
+ * Delete a queue created by workqueue_new(); no thread may be using it.
+ * Calls itemdelete, if not NULL, on any items still queued.
+ */
+void workqueue_delete(workqueue_t* q, void (*itemdelete)(void* item));
+
+#endif // __WORKQUEUE_H__
@@ -10,21 +10,31 @@
  * where each (docID, count) pair corresponds to a page that
  * contains `word`
  * 
- * Usage: ./indexer pageDirectory indexFilename
+ * Usage: ./indexer [--update] pageDirectory indexFilename
+ * 
+ * With --update, indexFilename must hold the index of pageDirectory as
+ * it was before a `crawler --recrawl`; only the pages that recrawl
+ * listed in pageDirectory/.changed are indexed again, and the list is
+ * removed once the updated index is written.
  * 
  * Exits with:
  *   0 if normal return
  *   errno 1 if error parsing arguments: pageDirectory doesn't exist
  *     or doesn't contain ".crawler", failure to write to indexFilename,
  *     or failure to create a file at the path indexFilename 
+ *   errno 2 if --update and indexFilename can't be read as an index
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
 
 // libcs50.a
 #include "hashtable.h"
+#include "counters.h"
+#include "file.h"
 
 // common.a
 #include "pagedir.h"
@@ -32,24 +42,44 @@
 #include "index.h"
 
 /* Private functions */
-static void parseArgs(const int argc, char* argv[],
+static void parseArgs(const int argc, char* argv[], bool* update_p,
                       char** pageDirectory_p, char** indexFilename_p);
 index_t* indexBuild(const char* pageDirectory);
-static void indexPage(index_t* idx, webpage_t* page, const int docID);
+static bool indexUpdate(index_t* idx, const char* pageDirectory);
 
 int main(const int argc, char* argv[])
 {
+  bool update = false;
   char* pageDirectory = NULL;
   char* indexFilename = NULL;
-  parseArgs(argc, argv, &pageDirectory, &indexFilename);
-  index_t* idx = indexBuild(pageDirectory);
-  index_saveToFile(idx, indexFilename);
+  parseArgs(argc, argv, &update, &pageDirectory, &indexFilename);
+  if (!update) {
+    index_t* idx = indexBuild(pageDirectory);
+    index_saveToFile(idx, indexFilename);
+    index_delete(idx);
+    return 0;
+  }
+
+  index_t* idx = index_readIndexFile(indexFilename);
+  if (idx == NULL) {
+    fprintf(stderr, "Indexer: can't read index %s\n", indexFilename);
+    exit(2);
+  }
+  if (indexUpdate(idx, pageDirectory)) {
+    index_saveToFile(idx, indexFilename);
+    // the list has been used; the next recrawl starts a new one
+    size_t dirLen = strlen(pageDirectory);
+    char changedPath[dirLen + strlen("/.changed") + 1];
+    sprintf(changedPath, "%s/.changed", pageDirectory);
+    unlink(changedPath);
+  }
   index_delete(idx);
   return 0;
 }
 
 /*
- * Checks argc == 3 (1 for "indexer", 2 for inputs),
+ * Reads a leading --update, if any, into update_p,
+ * checks 2 inputs remain after it,
  * make sure pageDirectory exists and contains ".crawler"
  * check indexFilename either:
  *   1. exists and is writeable (will be erased if nonempty), or
@@ -57,21 +87,27 @@ int main(const int argc, char* argv[])
  *      the new file
  * prints error to stderr and exit 1 on invalid argument
  */
-static void parseArgs(const int argc, char* argv[],
+static void parseArgs(const int argc, char* argv[], bool* update_p,
                       char** pageDirectory_p, char** indexFilename_p)
 {
-  if (argc != 3) {
-    fprintf(stdout, "Usage: %s pageDirectory indexFilename\n", argv[0]);
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "--update") == 0) {
+    *update_p = true;
+    arg++;
+  }
+  if (argc - arg != 2) {
+    fprintf(stdout, "Usage: %s [--update] pageDirectory indexFilename\n",
+            argv[0]);
     exit(1);
   }
 
-  *pageDirectory_p = argv[1];
+  *pageDirectory_p = argv[arg];
   if (!pagedir_isCrawlerDirectory(*pageDirectory_p)) {
     printerrln("Indexer: pageDirectory doesn't exist or doesn't contain \".crawler\"");
     exit(1);
   }
 
-  *indexFilename_p = argv[2];
+  *indexFilename_p = argv[arg + 1];
   if (!pagedir_isFileWriteable(*indexFilename_p)) {
     fprintf(stderr, "Indexer: failed to write to %s\n", *indexFilename_p);
     exit(1);
@@ -98,7 +134,7 @@ index_t* indexBuild(const char* pageDirectory)
   int docID = 1;
   webpage_t* page;
   while ((page = pagedir_loadPageFromFile(pageDirectory, docID)) != NULL) {
-    indexPage(idx, page, docID);
+    index_addPage(idx, page, docID);
     webpage_delete(page);
     docID++;
   }
@@ -106,19 +142,45 @@ index_t* indexBuild(const char* pageDirectory)
 }
 
 /*
- * For a webpage, update index with the words in the html
+ * Indexes again each page listed in pageDirectory/.changed (one docID
+ * per line, possibly repeated): removes its old entries from the index,
+ * then adds the words in its current file, if any
  *
  * Inputs:
- *   idx: index to update
- *   page: webpage_t* containing the html
- *   docID: name of file that `page` was read from
+ *   idx: the index of pageDirectory before the pages changed
+ *   pageDirectory: directory to read files from
+ * 
+ * Returns:
+ *   false if there is no list of changed pages, so nothing was done
  */
-void indexPage(index_t* idx, webpage_t* page, const int docID)
+static bool indexUpdate(index_t* idx, const char* pageDirectory)
 {
-  char* word;
-  int pos = 0;
-  while ((word = webpage_getNextWord(page, &pos)) != NULL) {
-    index_addWord(idx, word, docID);
-    free(word);
+  size_t dirLen = strlen(pageDirectory);
+  char changedPath[dirLen + strlen("/.changed") + 1];
+  sprintf(changedPath, "%s/.changed", pageDirectory);
+  FILE* fp = fopen(changedPath, "r");
+  if (fp == NULL) {
+    return false;
+  }
+
+  // <docID, 1> for each page indexed again, so each is done once
+  counters_t* done = counters_new();
+  char* line;
+  while ((line = file_readLine(fp)) != NULL) {
+    int docID;
+    char extra;
+    if (sscanf(line, "%d%c", &docID, &extra) == 1 && docID > 0
+        && counters_add(done, docID) == 1) {
+      index_removeDoc(idx, docID);
+      webpage_t* page = pagedir_loadPageFromFile(pageDirectory, docID);
+      if (page != NULL) {
+        index_addPage(idx, page, docID);
+        webpage_delete(page);
+      }
+    }
+    free(line);
   }
+  counters_delete(done);
+  fclose(fp);
+  return true;
 }
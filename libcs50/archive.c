@@ -0,0 +1,545 @@
+/*
+ * archive.c - CS50 'archive' module
+ *
+ * see archive.h for more information.
+ *
+ * Records are appended through a stdio stream, one whole record under
+ * the lock at a time, so records from different threads never mix.
+ * Both the archive and the index are read through mmap: the index is
+ * searched where it lies, and a record's block is fed to the parser
+ * straight from the mapping, so replaying a page copies its body once,
+ * into the parser's buffer, as reading it from a socket would.
+ *
+ * Hugo Fang, 3/8/2024
+ */
+
+#define _GNU_SOURCE       // memmem, strdup, gmtime_r
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "archive.h"
+#include "http.h"
+
+/**************** file-local global variables ****************/
+static const char INDEX_MAGIC[8] = { 'T', 'S', 'E', 'A', 'I', 'D', 'X', '1' };
+static const char RECORD_START[] = "WARC/1.0\r\n";
+static const size_t HEADER_MAX = 65536;   // longest record header accepted
+static const size_t ENTRIES_INIT = 1024;  // initial index entries
+
+/**************** local types ****************/
+/* one entry of the index */
+typedef struct indexentry {
+  uint64_t hash;              // of the record's URL
+  uint64_t offset;            // of the record in the archive
+} indexentry_t;
+
+/* the fields of one record, pointing into the archive */
+typedef struct record {
+  const char* url;
+  size_t urlLen;
+  const char* block;          // the response
+  size_t blockLen;
+  size_t next;                // offset of the record after this one
+} record_t;
+
+/**************** global types ****************/
+typedef struct archive {
+  char* path;
+  FILE* fp;
+  bool failed;                // a record could not be written
+  pthread_mutex_t lock;
+} archive_t;
+
+typedef struct replay {
+  const char* map;            // the archive, or NULL if empty
+  size_t size;
+  const char* indexMap;       // the index
+  size_t indexSize;
+  const indexentry_t* entries;  // the index's entries, sorted
+  size_t count;
+} replay_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool nextRecord(const char* map, const size_t size,
+                       size_t* offset, record_t* rec);
+static bool parseRecord(const char* map, const size_t size,
+                        const size_t offset, record_t* rec);
+static const char* findField(const char* header, const size_t len,
+                             const char* name, size_t* valueLen);
+static bool writeIndex(const char* path, const char* map, const size_t size);
+static bool loadIndex(replay_t* replay, const char* path);
+static bool mapFile(const char* path, const char** map, size_t* size);
+static void unmapFile(const char* map, const size_t size);
+static int compareEntries(const void* a, const void* b);
+static uint64_t hashURL(const char* url, const size_t len);
+
+/**************** archive_new() ****************/
+/* see archive.h for description */
+archive_t*
+archive_new(const char* path)
+{
+  if (path == NULL) {
+    return NULL;
+  }
+  archive_t* archive = malloc(sizeof(archive_t));
+  if (archive == NULL) {
+    return NULL;
+  }
+  archive->path = strdup(path);
+  archive->fp = NULL;
+  archive->failed = false;
+  if (archive->path == NULL) {
+    free(archive);
+    return NULL;
+  }
+
+  // refuse a file that is not an archive; drop a record torn by a crash
+  // from the end, so new records follow the last whole one rather than
+  // being lost behind it, but leave one damaged further in for readers
+  // to skip, along with the whole records after it
+  const char* map;
+  size_t size;
+  bool ok = true;
+  if (mapFile(path, &map, &size)) {
+    size_t startLen = strlen(RECORD_START);
+    ok = (size == 0 || memcmp(map, RECORD_START,
+                              size < startLen ? size : startLen) == 0);
+    size_t end = 0;
+    record_t rec;
+    for (size_t offset = 0; ok && nextRecord(map, size, &offset, &rec);
+         offset = rec.next) {
+      end = rec.next;
+    }
+    unmapFile(map, size);
+    ok = ok && (end == size || truncate(path, end) == 0);
+  }
+  if (ok) {
+    archive->fp = fopen(path, "ab");
+  }
+  if (archive->fp == NULL) {
+    free(archive->path);
+    free(archive);
+    return NULL;
+  }
+  pthread_mutex_init(&archive->lock, NULL);
+  return archive;
+}
+
+/**************** archive_add() ****************/
+/* see archive.h for description */
+bool
+archive_add(archive_t* archive, const char* url, const http_response_t* resp)
+{
+  size_t headersLen, bodyLen;
+  const char* headers = http_response_headers(resp, &headersLen);
+  const char* body = http_response_body(resp, &bodyLen);
+  if (archive == NULL || url == NULL || headers == NULL || body == NULL) {
+    return false;
+  }
+
+  // the headers kept end before the blank line, and lack a length
+  char length[48];
+  size_t lengthLen = sprintf(length, "Content-Length: %zu\r\n\r\n", bodyLen);
+  char date[32];
+  time_t now = time(NULL);
+  struct tm tm;
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&now, &tm));
+
+  pthread_mutex_lock(&archive->lock);
+  FILE* fp = archive->fp;
+  bool ok = fprintf(fp, "%sWARC-Type: response\r\n"
+                    "WARC-Target-URI: %s\r\nWARC-Date: %s\r\n"
+                    "Content-Type: application/http; msgtype=response\r\n"
+                    "Content-Length: %zu\r\n\r\n", RECORD_START, url, date,
+                    headersLen + lengthLen + bodyLen) > 0
+            && fwrite(headers, 1, headersLen, fp) == headersLen
+            && fwrite(length, 1, lengthLen, fp) == lengthLen
+            && fwrite(body, 1, bodyLen, fp) == bodyLen
+            && fwrite("\r\n\r\n", 1, 4, fp) == 4;
+  if (!ok) {
+    archive->failed = true;
+  }
+  pthread_mutex_unlock(&archive->lock);
+  return ok;
+}
+
+/**************** archive_close() ****************/
+/* see archive.h for description */
+bool
+archive_close(archive_t* archive)
+{
+  if (archive == NULL) {
+    return false;
+  }
+  bool ok = (fclose(archive->fp) == 0) && !archive->failed;
+
+  // index every whole record, old and new
+  const char* map;
+  size_t size;
+  if (mapFile(archive->path, &map, &size)) {
+    ok = writeIndex(archive->path, map, size) && ok;
+    unmapFile(map, size);
+  } else {
+    ok = false;
+  }
+
+  pthread_mutex_destroy(&archive->lock);
+  free(archive->path);
+  free(archive);
+  return ok;
+}
+
+/**************** archive_replayOpen() ****************/
+/* see archive.h for description */
+replay_t*
+archive_replayOpen(const char* path)
+{
+  if (path == NULL) {
+    return NULL;
+  }
+  replay_t* replay = calloc(1, sizeof(replay_t));
+  if (replay == NULL) {
+    return NULL;
+  }
+  if (!mapFile(path, &replay->map, &replay->size)) {
+    free(replay);
+    return NULL;
+  }
+  if (!loadIndex(replay, path)
+      && (!writeIndex(path, replay->map, replay->size)
+          || !loadIndex(replay, path))) {
+    archive_replayClose(replay);
+    return NULL;
+  }
+  return replay;
+}
+
+/**************** archive_replay() ****************/
+/* see archive.h for description
+ *
+ * Entries with the same hash are in the order of their records, so the
+ * last one whose record names url is the latest.
+ */
+http_result_t
+archive_replay(const replay_t* replay, const char* url, http_response_t* resp)
+{
+  if (replay == NULL || url == NULL || resp == NULL) {
+    return HTTP_ERROR;
+  }
+  size_t urlLen = strlen(url);
+  uint64_t hash = hashURL(url, urlLen);
+
+  // the first entry with this hash
+  size_t lo = 0, hi = replay->count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (replay->entries[mid].hash < hash) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  record_t found;
+  bool any = false;
+  for (size_t i = lo; i < replay->count && replay->entries[i].hash == hash;
+       i++) {
+    record_t rec;
+    if (parseRecord(replay->map, replay->size, replay->entries[i].offset,
+                    &rec)
+        && rec.urlLen == urlLen && memcmp(rec.url, url, urlLen) == 0) {
+      found = rec;
+      any = true;
+    }
+  }
+  if (!any) {
+    return HTTP_ERROR;
+  }
+
+  http_result_t result = http_response_feed(resp, found.block, found.blockLen);
+  return result == HTTP_MORE ? http_response_eof(resp) : result;
+}
+
+/**************** archive_replayClose() ****************/
+/* see archive.h for description */
+void
+archive_replayClose(replay_t* replay)
+{
+  if (replay != NULL) {
+    unmapFile(replay->map, replay->size);
+    unmapFile(replay->indexMap, replay->indexSize);
+    free(replay);
+  }
+}
+
+/**************** nextRecord ****************/
+/* Parse the first whole record at or after *offset in the size-byte
+ * archive map into *rec, storing its offset in *offset. A damaged
+ * record is skipped by looking for the next record start after the
+ * blank line that ends every record. Return false if there is none.
+ */
+static bool
+nextRecord(const char* map, const size_t size, size_t* offset,
+           record_t* rec)
+{
+  char start[strlen(RECORD_START) + 5];
+  sprintf(start, "\r\n\r\n%s", RECORD_START);
+  while (*offset < size) {
+    if (parseRecord(map, size, *offset, rec)) {
+      return true;
+    }
+    const char* found = memmem(&map[*offset], size - *offset,
+                               start, strlen(start));
+    if (found == NULL) {
+      return false;
+    }
+    *offset = found - map + 4;
+  }
+  return false;
+}
+
+/**************** parseRecord ****************/
+/* Parse the record at offset in the size-byte archive map into *rec.
+ * Return false if there is no whole, well-formed record there, as at
+ * the end of the archive, or where a crash tore the last one.
+ */
+static bool
+parseRecord(const char* map, const size_t size, const size_t offset,
+            record_t* rec)
+{
+  size_t startLen = strlen(RECORD_START);
+  if (map == NULL || offset > size || size - offset < startLen
+      || memcmp(&map[offset], RECORD_START, startLen) != 0) {
+    return false;
+  }
+  const char* header = &map[offset];
+  size_t avail = size - offset < HEADER_MAX ? size - offset : HEADER_MAX;
+  const char* end = memmem(header, avail, "\r\n\r\n", 4);
+  if (end == NULL) {
+    return false;
+  }
+  size_t headerLen = end - header + 2;      // through the last CRLF
+
+  size_t lengthLen;
+  const char* length = findField(header, headerLen, "Content-Length",
+                                 &lengthLen);
+  rec->url = findField(header, headerLen, "WARC-Target-URI", &rec->urlLen);
+  if (length == NULL || lengthLen == 0 || rec->url == NULL) {
+    return false;
+  }
+  size_t blockLen = 0;
+  for (size_t i = 0; i < lengthLen; i++) {
+    if (length[i] < '0' || length[i] > '9' || blockLen > (SIZE_MAX - 9) / 10) {
+      return false;
+    }
+    blockLen = blockLen * 10 + (length[i] - '0');
+  }
+
+  // the block, then the blank line that ends the record
+  size_t blockStart = offset + headerLen + 2;
+  if (blockLen > size - blockStart || size - blockStart - blockLen < 4
+      || memcmp(&map[blockStart + blockLen], "\r\n\r\n", 4) != 0) {
+    return false;
+  }
+  rec->block = &map[blockStart];
+  rec->blockLen = blockLen;
+  rec->next = blockStart + blockLen + 4;
+  return true;
+}
+
+/**************** findField ****************/
+/* Find the field called name, ignoring case, among the CRLF-ended lines
+ * of the len-byte record header. Return its value, storing its length
+ * in *valueLen, or NULL if there is no such field.
+ */
+static const char*
+findField(const char* header, const size_t len, const char* name,
+          size_t* valueLen)
+{
+  size_t nameLen = strlen(name);
+  const char* end = header + len;
+  for (const char* line = header; line < end; ) {
+    const char* eol = memchr(line, '\r', end - line);
+    if (eol == NULL) {
+      eol = end;
+    }
+    if ((size_t)(eol - line) > nameLen && line[nameLen] == ':'
+        && strncasecmp(line, name, nameLen) == 0) {
+      const char* value = line + nameLen + 1;
+      while (value < eol && *value == ' ') {
+        value++;
+      }
+      *valueLen = eol - value;
+      return value;
+    }
+    line = eol + 2;
+  }
+  return NULL;
+}
+
+/**************** writeIndex ****************/
+/* Index the whole records of the size-byte archive map, read from path,
+ * into "path.idx", by way of a ".tmp" file renamed into place.
+ * Return false on any error, leaving any previous index in place.
+ */
+static bool
+writeIndex(const char* path, const char* map, const size_t size)
+{
+  size_t count = 0;
+  size_t cap = ENTRIES_INIT;
+  indexentry_t* entries = malloc(sizeof(indexentry_t) * cap);
+  record_t rec;
+  for (size_t offset = 0; entries != NULL
+       && nextRecord(map, size, &offset, &rec); offset = rec.next) {
+    if (count == cap) {
+      cap *= 2;
+      indexentry_t* grown = realloc(entries, sizeof(indexentry_t) * cap);
+      if (grown == NULL) {
+        free(entries);
+        return false;
+      }
+      entries = grown;
+    }
+    entries[count].hash = hashURL(rec.url, rec.urlLen);
+    entries[count].offset = offset;
+    count++;
+  }
+  if (entries == NULL) {
+    return false;
+  }
+  qsort(entries, count, sizeof(indexentry_t), compareEntries);
+
+  char indexPath[strlen(path) + strlen(".idx") + 1];
+  char tmpPath[strlen(path) + strlen(".idx.tmp") + 1];
+  sprintf(indexPath, "%s.idx", path);
+  sprintf(tmpPath, "%s.idx.tmp", path);
+  FILE* fp = fopen(tmpPath, "wb");
+  if (fp == NULL) {
+    free(entries);
+    return false;
+  }
+  uint64_t header[2] = { size, count };
+  bool ok = fwrite(INDEX_MAGIC, sizeof(INDEX_MAGIC), 1, fp) == 1
+            && fwrite(header, sizeof(header), 1, fp) == 1
+            && fwrite(entries, sizeof(indexentry_t), count, fp) == count;
+  free(entries);
+  ok = (fclose(fp) == 0) && ok;
+  if (ok) {
+    ok = rename(tmpPath, indexPath) == 0;
+  }
+  if (!ok) {
+    remove(tmpPath);
+  }
+  return ok;
+}
+
+/**************** loadIndex ****************/
+/* Map "path.idx" as replay's index, if it indexes the archive as it is
+ * now. Return false if it is missing, damaged, or out of date.
+ */
+static bool
+loadIndex(replay_t* replay, const char* path)
+{
+  char indexPath[strlen(path) + strlen(".idx") + 1];
+  sprintf(indexPath, "%s.idx", path);
+  const char* map;
+  size_t size;
+  if (!mapFile(indexPath, &map, &size)) {
+    return false;
+  }
+  uint64_t header[2];
+  size_t start = sizeof(INDEX_MAGIC) + sizeof(header);
+  bool ok = size >= start && memcmp(map, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0;
+  if (ok) {
+    memcpy(header, &map[sizeof(INDEX_MAGIC)], sizeof(header));
+    ok = header[0] == replay->size
+         && header[1] == (size - start) / sizeof(indexentry_t)
+         && (size - start) % sizeof(indexentry_t) == 0;
+  }
+  if (!ok) {
+    unmapFile(map, size);
+    return false;
+  }
+  replay->indexMap = map;
+  replay->indexSize = size;
+  replay->entries = (const indexentry_t*)&map[start];
+  replay->count = header[1];
+  return true;
+}
+
+/**************** mapFile ****************/
+/* Map the file at path into memory, read-only, setting *map to where
+ * (NULL if the file is empty) and *size to its size. Return false if it
+ * cannot be opened or mapped.
+ */
+static bool
+mapFile(const char* path, const char** map, size_t* size)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0;
+  *map = NULL;
+  *size = ok ? st.st_size : 0;
+  if (ok && *size > 0) {
+    void* mapped = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ok = (mapped != MAP_FAILED);
+    if (ok) {
+      *map = mapped;
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+/**************** unmapFile ****************/
+/* Unmap what mapFile mapped, if anything.
+ */
+static void
+unmapFile(const char* map, const size_t size)
+{
+  if (map != NULL) {
+    munmap((void*)map, size);
+  }
+}
+
+/**************** compareEntries ****************/
+/* Order index entries by hash, then offset, for qsort.
+ */
+static int
+compareEntries(const void* a, const void* b)
+{
+  const indexentry_t* entryA = a;
+  const indexentry_t* entryB = b;
+  if (entryA->hash != entryB->hash) {
+    return entryA->hash < entryB->hash ? -1 : 1;
+  }
+  return (entryA->offset > entryB->offset) - (entryA->offset < entryB->offset);
+}
+
+/**************** hashURL ****************/
+/* The 64-bit FNV-1a hash of the len-byte url.
+ */
+static uint64_t
+hashURL(const char* url, const size_t len)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)url[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
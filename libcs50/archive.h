@@ -0,0 +1,115 @@
+/*
+ * archive.h - header file for the CS50 'archive' module
+ *
+ * Records the responses the fetchers receive in an append-only archive
+ * file, and replays them from it, so a crawl can be run again offline,
+ * page for page, at the speed of the disk.
+ *
+ * The archive is a series of WARC-style records, one per response:
+ *
+ *   WARC/1.0
+ *   WARC-Type: response
+ *   WARC-Target-URI: <url>
+ *   WARC-Date: <when it was recorded, e.g. 2024-03-08T14:02:11Z>
+ *   Content-Type: application/http; msgtype=response
+ *   Content-Length: <length of the block>
+ *   <blank line>
+ *   <block: the response's status line and headers, and its body>
+ *   <blank line>
+ *
+ * with every line ending in CRLF. The block is the response as the
+ * parser kept it (see http_response_headers): the body is decoded, and
+ * cut off at any limit set when it was fetched, and the headers that
+ * described its framing on the wire are replaced by its Content-Length.
+ * A record torn by a crash is dropped from the end of the archive the
+ * next time it is opened for recording; a damaged record further in is
+ * skipped, and the records after it kept.
+ *
+ * Next to the archive, "<archive>.idx" indexes it: the magic
+ * "TSEAIDX1", the size of the archive indexed and the number of
+ * records, as 64-bit integers in the machine's own byte order, then a
+ * hash of each record's URL and its offset, sorted. Closing an archive
+ * after recording writes the index; replaying maps the archive and the
+ * index into memory, rebuilding the index first if it is missing or out
+ * of date, and finds each URL by binary search. A URL recorded more
+ * than once is replayed from its last record.
+ *
+ * Hugo Fang, 3/8/2024
+ */
+
+#ifndef __ARCHIVE_H
+#define __ARCHIVE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "http.h"
+
+/**************** global types ****************/
+typedef struct archive archive_t;  // an archive open for recording
+typedef struct replay replay_t;    // an archive open for replaying
+
+/**************** archive_new ****************/
+/* Open the archive at path for recording, creating it if need be;
+ * records are added after those already in it.
+ *
+ * We return:
+ *   pointer to the open archive, or NULL if it cannot be opened, or
+ *   the file there is not empty and does not start like an archive.
+ * Caller is responsible for:
+ *   later calling archive_close.
+ */
+archive_t* archive_new(const char* path);
+
+/**************** archive_add ****************/
+/* Record the response fetched from url.
+ *
+ * Caller provides:
+ *   a complete response, parsed with http_response_keepHeaders, whose
+ *   body has not been taken.
+ * We return:
+ *   false if the response has no headers kept or cannot be written.
+ * Safe to call from several threads at once.
+ */
+bool archive_add(archive_t* archive, const char* url,
+                 const http_response_t* resp);
+
+/**************** archive_close ****************/
+/* Finish writing the archive, write its index, and free it.
+ *
+ * We return:
+ *   false if either could not be written completely.
+ */
+bool archive_close(archive_t* archive);
+
+/**************** archive_replayOpen ****************/
+/* Open the archive at path for replaying, indexing it if its index is
+ * missing or out of date.
+ *
+ * We return:
+ *   pointer to the open archive, or NULL if it cannot be read or
+ *   indexed.
+ * Caller is responsible for:
+ *   later calling archive_replayClose.
+ */
+replay_t* archive_replayOpen(const char* path);
+
+/**************** archive_replay ****************/
+/* Feed the response recorded for url to resp, as if it were arriving
+ * from the server.
+ *
+ * Caller provides:
+ *   resp, a new parser, limited as it would be for a fetch.
+ * We return:
+ *   as http_response_feed would for the whole response, then its end;
+ *   HTTP_ERROR, leaving resp untouched, if url was never recorded.
+ * Safe to call from several threads at once.
+ */
+http_result_t archive_replay(const replay_t* replay, const char* url,
+                             http_response_t* resp);
+
+/**************** archive_replayClose ****************/
+/* Unmap the archive and its index, and free replay.
+ */
+void archive_replayClose(replay_t* replay);
+
+#endif // __ARCHIVE_H
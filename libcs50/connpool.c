@@ -0,0 +1,193 @@
+/*
+ * connpool.c - CS50 'connpool' module
+ *
+ * see connpool.h for more information.
+ *
+ * The pool is a short list of hosts, each with a small stack of idle
+ * sockets; crawls touch few hosts, so a linear search is plenty. The
+ * most recently returned socket is handed out first, since it is the
+ * least likely to have been closed by the server.
+ *
+ * Hugo Fang, 2/21/2024
+ */
+
+#define _GNU_SOURCE       // strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include "connpool.h"
+
+/**************** local types ****************/
+typedef struct idleconn {
+  int fd;                     // open socket
+  time_t since;               // when it went idle
+} idleconn_t;
+
+typedef struct poolhost {
+  char* hostname;
+  int port;
+  idleconn_t* conns;          // stack of idle connections
+  int numConns;
+  struct poolhost* next;
+} poolhost_t;
+
+/**************** global types ****************/
+typedef struct connpool {
+  poolhost_t* hosts;          // list of hosts seen so far
+  int maxIdlePerHost;
+  int maxIdleSecs;
+  pthread_mutex_t lock;       // guards everything above
+} connpool_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static poolhost_t* findHost(connpool_t* pool, const char* hostname,
+                            const int port, const bool create);
+static bool isAlive(const int fd);
+
+/**************** connpool_new() ****************/
+/* see connpool.h for description */
+connpool_t*
+connpool_new(const int maxIdlePerHost, const int maxIdleSecs)
+{
+  if (maxIdlePerHost <= 0 || maxIdleSecs < 0) {
+    return NULL;
+  }
+
+  connpool_t* pool = malloc(sizeof(connpool_t));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->hosts = NULL;
+  pool->maxIdlePerHost = maxIdlePerHost;
+  pool->maxIdleSecs = maxIdleSecs;
+  pthread_mutex_init(&pool->lock, NULL);
+  return pool;
+}
+
+/**************** connpool_get() ****************/
+/* see connpool.h for description */
+int
+connpool_get(connpool_t* pool, const char* hostname, const int port)
+{
+  if (pool == NULL || hostname == NULL) {
+    return -1;
+  }
+
+  int fd = -1;
+  time_t now = time(NULL);
+  pthread_mutex_lock(&pool->lock);
+  poolhost_t* host = findHost(pool, hostname, port, false);
+  while (host != NULL && fd < 0 && host->numConns > 0) {
+    idleconn_t conn = host->conns[--host->numConns];
+    if (now - conn.since <= pool->maxIdleSecs && isAlive(conn.fd)) {
+      fd = conn.fd;
+    } else {
+      close(conn.fd);         // stale; try the next one
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return fd;
+}
+
+/**************** connpool_put() ****************/
+/* see connpool.h for description */
+void
+connpool_put(connpool_t* pool, const char* hostname, const int port,
+             const int fd)
+{
+  if (fd < 0) {
+    return;
+  }
+  if (pool == NULL || hostname == NULL) {
+    close(fd);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  poolhost_t* host = findHost(pool, hostname, port, true);
+  if (host == NULL || host->numConns >= pool->maxIdlePerHost) {
+    close(fd);
+  } else {
+    host->conns[host->numConns].fd = fd;
+    host->conns[host->numConns].since = time(NULL);
+    host->numConns++;
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**************** connpool_delete() ****************/
+/* see connpool.h for description */
+void
+connpool_delete(connpool_t* pool)
+{
+  if (pool != NULL) {
+    for (poolhost_t* host = pool->hosts; host != NULL; ) {
+      for (int i = 0; i < host->numConns; i++) {
+        close(host->conns[i].fd);
+      }
+      poolhost_t* next = host->next;
+      free(host->hostname);
+      free(host->conns);
+      free(host);
+      host = next;
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+  }
+}
+
+/**************** findHost ****************/
+/* Find the entry for hostname:port, adding one if create is true.
+ * Caller must hold the pool lock.
+ * Return NULL if not found (or out of memory).
+ */
+static poolhost_t*
+findHost(connpool_t* pool, const char* hostname, const int port,
+         const bool create)
+{
+  for (poolhost_t* host = pool->hosts; host != NULL; host = host->next) {
+    if (host->port == port && strcmp(host->hostname, hostname) == 0) {
+      return host;
+    }
+  }
+  if (!create) {
+    return NULL;
+  }
+
+  poolhost_t* host = malloc(sizeof(poolhost_t));
+  if (host == NULL) {
+    return NULL;
+  }
+  host->hostname = strdup(hostname);
+  host->conns = malloc(sizeof(idleconn_t) * pool->maxIdlePerHost);
+  if (host->hostname == NULL || host->conns == NULL) {
+    free(host->hostname);
+    free(host->conns);
+    free(host);
+    return NULL;
+  }
+  host->port = port;
+  host->numConns = 0;
+  host->next = pool->hosts;
+  pool->hosts = host;
+  return host;
+}
+
+/**************** isAlive ****************/
+/* An idle connection should have nothing to read; if it is readable,
+ * the server has closed it (or sent something unexpected), so it is
+ * no good for another request.
+ */
+static bool
+isAlive(const int fd)
+{
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+  return poll(&pfd, 1, 0) == 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * connpool.h - header file for the CS50 'connpool' module
+ *
+ * A connpool holds open, idle HTTP connections (sockets) for reuse,
+ * keyed by host and port, so that consecutive fetches from the same
+ * server skip the TCP handshake. A connection is returned to the pool
+ * after a complete response on a kept-alive connection, and taken out
+ * again for the next request to that host. Connections idle for too long,
+ * or that the server has since closed, are discarded rather than handed
+ * out. All functions are safe to call from several threads at once.
+ *
+ * Hugo Fang, 2/21/2024
+ */
+
+#ifndef __CONNPOOL_H
+#define __CONNPOOL_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct connpool connpool_t;  // opaque to users of the module
+
+/**************** connpool_new ****************/
+/* Create a new, empty pool.
+ *
+ * Caller provides:
+ *   maxIdlePerHost, the most idle connections to keep for one host (> 0);
+ *   maxIdleSecs, how long a connection may sit idle before it is dropped.
+ * We return:
+ *   pointer to a new pool, or NULL if error.
+ * Caller is responsible for:
+ *   later calling connpool_delete.
+ */
+connpool_t* connpool_new(const int maxIdlePerHost, const int maxIdleSecs);
+
+/**************** connpool_get ****************/
+/* Take an idle connection to hostname:port out of the pool.
+ *
+ * We return:
+ *   an open socket that the caller now owns, or
+ *   -1 if the pool holds no usable connection to that host.
+ * Note:
+ *   the server may still close a reused connection before answering;
+ *   callers should be ready to retry once on a fresh connection.
+ */
+int connpool_get(connpool_t* pool, const char* hostname, const int port);
+
+/**************** connpool_put ****************/
+/* Give an idle connection to hostname:port back to the pool.
+ *
+ * Caller provides:
+ *   fd, an open socket on which a response has been read completely.
+ * We guarantee:
+ *   the pool takes ownership of fd; if the pool is full for that host
+ *   (or NULL), fd is closed.
+ */
+void connpool_put(connpool_t* pool, const char* hostname, const int port,
+                  const int fd);
+
+/**************** connpool_delete ****************/
+/* Close every idle connection and delete the pool.
+ */
+void connpool_delete(connpool_t* pool);
+
+#endif // __CONNPOOL_H
@@ -0,0 +1,33 @@
+/*
+ * deadline.c - CS50 'deadline' module
+ *
+ * see deadline.h for more information.
+ *
+ * Hugo Fang, 3/1/2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // clock_gettime
+
+#include <time.h>
+#include "deadline.h"
+
+/**************** deadline_now ****************/
+/* see deadline.h for description */
+long
+deadline_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/**************** deadline_earlier ****************/
+/* see deadline.h for description */
+long
+deadline_earlier(const long a, const long b)
+{
+  if (a < 0) {
+    return b;
+  }
+  return (b < 0 || a < b) ? a : b;
+}
@@ -0,0 +1,25 @@
+/*
+ * deadline.h - header file for the CS50 'deadline' module
+ *
+ * Times in milliseconds on the monotonic clock, which neither jumps nor
+ * goes back when the system clock is set, for deadlines and delays. A
+ * deadline of -1 means none.
+ *
+ * Hugo Fang, 3/1/2024
+ */
+
+#ifndef __DEADLINE_H
+#define __DEADLINE_H
+
+/**************** deadline_now ****************/
+/* Return the current time, in milliseconds on the monotonic clock.
+ */
+long deadline_now(void);
+
+/**************** deadline_earlier ****************/
+/* Return the earlier of two deadlines, either of which may be -1 for
+ * none; -1 only if both are.
+ */
+long deadline_earlier(const long a, const long b);
+
+#endif // __DEADLINE_H
@@ -0,0 +1,179 @@
+/*
+ * dnscache.c - CS50 'dnscache' module
+ *
+ * see dnscache.h for more information.
+ *
+ * Entries live in a hashtable keyed by hostname; an entry is updated in
+ * place when it is refreshed, since the hashtable cannot remove keys.
+ * getaddrinfo runs without the lock held, so a slow lookup for one host
+ * does not hold up fetches from hosts already in the cache; two threads
+ * missing on the same host at once may both resolve it, which is harmless.
+ *
+ * Hugo Fang, 2/22/2024
+ */
+
+#define _GNU_SOURCE       // getaddrinfo
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "dnscache.h"
+#include "hashtable.h"
+
+/**************** local types ****************/
+typedef struct dnsentry {
+  bool resolved;              // did the lookup succeed?
+  struct in_addr addr;        // the address, if so
+  time_t expires;             // when to look it up again
+} dnsentry_t;
+
+/**************** file-local global variables ****************/
+static const int NUM_SLOTS = 64;         // hashtable slots; few hosts per crawl
+
+static hashtable_t* cache = NULL;        // <char* hostname, dnsentry_t*>
+static int ttl = 300;                    // seconds to keep a good answer
+static int negativeTTL = 30;             // seconds to keep a failed lookup
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static bool connectTo = false;           // answer every lookup with...
+static struct sockaddr_in connectToAddr; // ...this address and port
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool lookup(const char* hostname, struct in_addr* addr);
+
+/**************** dnscache_resolve() ****************/
+/* see dnscache.h for description */
+bool
+dnscache_resolve(const char* hostname, const int port, struct sockaddr_in* addr)
+{
+  if (hostname == NULL || addr == NULL) {
+    return false;
+  }
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sin_family = AF_INET;
+  addr->sin_port = htons(port);
+
+  // answer from the cache if we have a fresh entry
+  time_t now = time(NULL);
+  pthread_mutex_lock(&lock);
+  if (connectTo) {
+    *addr = connectToAddr;
+    pthread_mutex_unlock(&lock);
+    return true;
+  }
+  dnsentry_t* entry = cache ? hashtable_find(cache, hostname) : NULL;
+  if (entry != NULL && now < entry->expires) {
+    bool resolved = entry->resolved;
+    addr->sin_addr = entry->addr;
+    pthread_mutex_unlock(&lock);
+    return resolved;
+  }
+  pthread_mutex_unlock(&lock);
+
+  // miss or expired: ask the resolver, then remember the answer
+  struct in_addr found;
+  bool resolved = lookup(hostname, &found);
+
+  pthread_mutex_lock(&lock);
+  if (cache == NULL) {
+    cache = hashtable_new(NUM_SLOTS);
+  }
+  entry = cache ? hashtable_find(cache, hostname) : NULL;
+  if (entry == NULL && cache != NULL) {
+    entry = malloc(sizeof(dnsentry_t));
+    if (entry != NULL && !hashtable_insert(cache, hostname, entry)) {
+      free(entry);
+      entry = NULL;
+    }
+  }
+  if (entry != NULL) {
+    entry->resolved = resolved;
+    entry->addr = found;
+    entry->expires = now + (resolved ? ttl : negativeTTL);
+  }
+  pthread_mutex_unlock(&lock);
+
+  addr->sin_addr = found;
+  return resolved;
+}
+
+/**************** dnscache_setTTL() ****************/
+/* see dnscache.h for description */
+void
+dnscache_setTTL(const int ttlSecs, const int negativeTTLSecs)
+{
+  pthread_mutex_lock(&lock);
+  if (ttlSecs >= 0) {
+    ttl = ttlSecs;
+  }
+  if (negativeTTLSecs >= 0) {
+    negativeTTL = negativeTTLSecs;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+/**************** dnscache_connectTo() ****************/
+/* see dnscache.h for description */
+bool
+dnscache_connectTo(const char* address, const int port)
+{
+  struct sockaddr_in target;
+  memset(&target, 0, sizeof(target));
+  target.sin_family = AF_INET;
+  target.sin_port = htons(port);
+  if (address != NULL
+      && (port <= 0 || port > 65535
+          || inet_pton(AF_INET, address, &target.sin_addr) != 1)) {
+    return false;
+  }
+
+  pthread_mutex_lock(&lock);
+  connectTo = (address != NULL);
+  connectToAddr = target;
+  pthread_mutex_unlock(&lock);
+  return true;
+}
+
+/**************** dnscache_clear() ****************/
+/* see dnscache.h for description */
+void
+dnscache_clear(void)
+{
+  pthread_mutex_lock(&lock);
+  if (cache != NULL) {
+    hashtable_delete(cache, free);
+    cache = NULL;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+/**************** lookup ****************/
+/* Resolve hostname to an IPv4 address with getaddrinfo, which, unlike
+ * gethostbyname, is safe to call from several threads.
+ * Return false if it does not resolve.
+ */
+static bool
+lookup(const char* hostname, struct in_addr* addr)
+{
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  memset(addr, 0, sizeof(*addr));
+  struct addrinfo* result;
+  if (getaddrinfo(hostname, NULL, &hints, &result) != 0) {
+    return false;
+  }
+  *addr = ((struct sockaddr_in*)result->ai_addr)->sin_addr;
+  freeaddrinfo(result);
+  return true;
+}
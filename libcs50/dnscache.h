@@ -0,0 +1,62 @@
+/*
+ * dnscache.h - header file for the CS50 'dnscache' module
+ *
+ * A process-wide cache of hostname lookups for the fetchers. The first
+ * fetch from a host resolves it with getaddrinfo; later fetches reuse
+ * the answer until it expires. Failed lookups are cached too (for a
+ * shorter time), so a crawl full of links to a dead host does not pay
+ * for a resolver timeout on every one. getaddrinfo does not report the
+ * record's real TTL, so expiry uses configurable times instead.
+ * All functions are safe to call from several threads at once.
+ *
+ * Hugo Fang, 2/22/2024
+ */
+
+#ifndef __DNSCACHE_H
+#define __DNSCACHE_H
+
+#include <stdbool.h>
+#include <netinet/in.h>
+
+/**************** dnscache_resolve ****************/
+/* Find the address of hostname:port, from the cache if possible.
+ *
+ * Caller provides:
+ *   hostname, a non-NULL host name or dotted IPv4 address;
+ *   port, in host byte order;
+ *   addr, where to store the result.
+ * We return:
+ *   true, filling in *addr, if the host resolved (now or recently);
+ *   false if it did not, now or within the negative-cache time.
+ */
+bool dnscache_resolve(const char* hostname, const int port,
+                      struct sockaddr_in* addr);
+
+/**************** dnscache_setTTL ****************/
+/* Set how long answers are kept, in seconds: ttlSecs for successful
+ * lookups (default 300) and negativeTTLSecs for failed ones (default 30).
+ * Applies to lookups made after the call; negative values are ignored.
+ */
+void dnscache_setTTL(const int ttlSecs, const int negativeTTLSecs);
+
+/**************** dnscache_connectTo ****************/
+/* Answer every later lookup, whatever the host and port, with
+ * address:port instead, so fetches go to a server of our choosing (say,
+ * a test server on this machine) while the URLs and Host headers sent
+ * stay the same.
+ *
+ * Caller provides:
+ *   address, a dotted IPv4 address, or NULL to go back to real lookups;
+ *   port, in host byte order.
+ * We return:
+ *   false if address is not a dotted IPv4 address or port is out of
+ *   range, leaving lookups as they were.
+ */
+bool dnscache_connectTo(const char* address, const int port);
+
+/**************** dnscache_clear ****************/
+/* Forget every cached answer and release the cache's memory.
+ */
+void dnscache_clear(void);
+
+#endif // __DNSCACHE_H
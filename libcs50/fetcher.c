@@ -0,0 +1,548 @@
+/*
+ * fetcher.c - CS50 'fetcher' module
+ *
+ * see fetcher.h for more information.
+ *
+ * Each outstanding fetch moves through three states: connecting
+ * (waiting for a non-blocking connect to finish), sending the request,
+ * and receiving the response, which is fed to an http_response_t parser
+ * as bytes arrive. A connection that fails to open is retried, up to
+ * MAX_TRY attempts, like webpage_fetch.
+ *
+ * Each attempt has a deadline, from webpage_setTimeouts: first to
+ * connect, then for the first byte of the response, and always for the
+ * whole attempt. epoll_wait sleeps no later than the earliest deadline
+ * of the fetches outstanding, and an attempt past its deadline is
+ * abandoned and counts as failed; it is retried if attempts are left.
+ *
+ * When webpage_replay has pages come from an archive, there is nothing
+ * to wait for: each page is fetched with webpage_fetch as soon as
+ * nextfunc gives it. When webpage_record is recording one, each
+ * complete response but a 304 is added to it, as by webpage_fetch.
+ *
+ * Hugo Fang, 2/20/2024
+ */
+
+#define _GNU_SOURCE       // SOCK_NONBLOCK
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "fetcher.h"
+#include "http.h"
+#include "dnscache.h"
+#include "deadline.h"
+#include "webpage.h"
+
+/**************** file-local global variables ****************/
+static const int MAX_TRY = 3;            // maximum attempts to connect
+static const int MAX_EVENTS = 64;        // events handled per epoll_wait
+static const size_t READ_SIZE = 65536;   // bytes read per read() call
+
+/**************** local types ****************/
+typedef enum {
+  FETCH_CONNECTING,
+  FETCH_SENDING,
+  FETCH_RECEIVING
+} fetch_state_t;
+
+/* one outstanding fetch */
+typedef struct fetch {
+  webpage_t* page;            // page being fetched
+  fetch_state_t state;
+  int fd;                     // socket, or -1
+  int tries;                  // connection attempts so far
+  char* hostname;             // from the page URL
+  int port;
+  char* request;              // text of the GET request
+  size_t requestLen;
+  size_t requestSent;         // bytes of request written so far
+  http_response_t* resp;      // parser for the response
+  long start;                 // when this attempt began (deadline_now())
+  long deadline;              // when it times out, or -1 for never
+  int slot;                   // index in the fetcher's fetches
+} fetch_t;
+
+/**************** global types ****************/
+typedef struct fetcher {
+  int epfd;                   // epoll instance
+  int maxInFlight;            // most fetches outstanding at once
+  int inFlight;               // fetches outstanding now
+  fetch_t** fetches;          // fetches[0..inFlight), to check deadlines
+  char* readBuf;              // shared buffer for read()
+} fetcher_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static fetch_t* fetch_new(webpage_t* page);
+static void fetch_delete(fetch_t* fetch);
+static bool fetch_connect(fetcher_t* fetcher, fetch_t* fetch);
+static void fetch_close(fetcher_t* fetcher, fetch_t* fetch);
+static bool fetch_handle(fetcher_t* fetcher, fetch_t* fetch,
+                         const uint32_t events, bool* success);
+static bool fetch_send(fetcher_t* fetcher, fetch_t* fetch, bool* success);
+static bool fetch_receive(fetcher_t* fetcher, fetch_t* fetch, bool* success);
+static bool fetch_finish(fetch_t* fetch);
+static bool fetch_retry(fetcher_t* fetcher, fetch_t* fetch);
+static void fetcher_add(fetcher_t* fetcher, fetch_t* fetch);
+static void fetcher_remove(fetcher_t* fetcher, fetch_t* fetch);
+static bool fetcher_expire(fetcher_t* fetcher, void* arg,
+            void (*donefunc)(void* arg, webpage_t* page, bool success),
+            long* deadline);
+
+/**************** fetcher_new() ****************/
+/* see fetcher.h for description */
+fetcher_t*
+fetcher_new(const int maxInFlight)
+{
+  if (maxInFlight <= 0) {
+    return NULL;
+  }
+
+  fetcher_t* fetcher = malloc(sizeof(fetcher_t));
+  if (fetcher == NULL) {
+    return NULL;
+  }
+  fetcher->readBuf = malloc(READ_SIZE);
+  fetcher->fetches = malloc(sizeof(fetch_t*) * maxInFlight);
+  fetcher->epfd = epoll_create1(0);
+  if (fetcher->readBuf == NULL || fetcher->fetches == NULL
+      || fetcher->epfd < 0) {
+    free(fetcher->readBuf);
+    free(fetcher->fetches);
+    if (fetcher->epfd >= 0) {
+      close(fetcher->epfd);
+    }
+    free(fetcher);
+    return NULL;
+  }
+  fetcher->maxInFlight = maxInFlight;
+  fetcher->inFlight = 0;
+  return fetcher;
+}
+
+/**************** fetcher_run() ****************/
+/* see fetcher.h for description */
+void
+fetcher_run(fetcher_t* fetcher, void* arg,
+            webpage_t* (*nextfunc)(void* arg, long* waitMillis),
+            void (*donefunc)(void* arg, webpage_t* page, bool success))
+{
+  if (fetcher == NULL || nextfunc == NULL || donefunc == NULL) {
+    return;
+  }
+
+  struct epoll_event events[MAX_EVENTS];
+  while (true) {
+    // start as many new fetches as we have room for
+    long waitMillis = -1;     // how long until nextfunc may have more
+    while (fetcher->inFlight < fetcher->maxInFlight) {
+      waitMillis = -1;
+      webpage_t* page = (*nextfunc)(arg, &waitMillis);
+      if (page == NULL) {
+        break;
+      }
+      if (webpage_isReplaying()) {
+        (*donefunc)(arg, page, webpage_fetch(page));
+        continue;
+      }
+      fetch_t* fetch = fetch_new(page);
+      if (fetch == NULL) {
+        (*donefunc)(arg, page, false);
+        continue;
+      }
+      if (!fetch_connect(fetcher, fetch)) {
+        fetch_delete(fetch);
+        (*donefunc)(arg, page, false);
+        continue;
+      }
+      fetcher_add(fetcher, fetch);
+    }
+
+    // nothing outstanding and nothing more to start: all done
+    if (fetcher->inFlight == 0 && waitMillis < 0) {
+      break;
+    }
+
+    // a fetch that timed out with no attempts left frees its slot, and
+    // its donefunc may give nextfunc more work
+    long deadline;
+    if (fetcher_expire(fetcher, arg, donefunc, &deadline)) {
+      continue;
+    }
+
+    // wait for a socket, for nextfunc to have more work, or for the
+    // next deadline
+    long timeout = -1;
+    if (fetcher->inFlight < fetcher->maxInFlight && waitMillis >= 0) {
+      timeout = waitMillis;
+    }
+    if (deadline >= 0) {
+      long left = deadline - deadline_now();
+      timeout = deadline_earlier(timeout, left > 0 ? left : 0);
+    }
+    int n = epoll_wait(fetcher->epfd, events, MAX_EVENTS, timeout);
+    if (n < 0 && errno != EINTR) {
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      fetch_t* fetch = events[i].data.ptr;
+      bool success = false;
+      if (fetch_handle(fetcher, fetch, events[i].events, &success)) {
+        // this fetch is finished, one way or another
+        webpage_t* done = fetch->page;
+        fetch_close(fetcher, fetch);
+        fetcher_remove(fetcher, fetch);
+        fetch_delete(fetch);
+        (*donefunc)(arg, done, success);
+      }
+    }
+  }
+}
+
+/**************** fetcher_delete() ****************/
+/* see fetcher.h for description */
+void
+fetcher_delete(fetcher_t* fetcher)
+{
+  if (fetcher != NULL) {
+    close(fetcher->epfd);
+    free(fetcher->readBuf);
+    free(fetcher->fetches);
+    free(fetcher);
+  }
+}
+
+/**************** fetch_new ****************/
+/* Allocate a fetch for page, with its request ready to send.
+ * Return NULL if the URL cannot be fetched or we are out of memory.
+ */
+static fetch_t*
+fetch_new(webpage_t* page)
+{
+  fetch_t* fetch = calloc(1, sizeof(fetch_t));
+  if (fetch == NULL) {
+    return NULL;
+  }
+  fetch->page = page;
+  fetch->fd = -1;
+  webpage_setStatus(page, 0);
+
+  char* pathname;
+  if (webpage_getURL(page) == NULL || webpage_getHTML(page) != NULL
+      || !http_burstURL(webpage_getURL(page), &fetch->hostname,
+                        &fetch->port, &pathname)) {
+    free(fetch);
+    return NULL;
+  }
+  fetch->request = http_formatRequest(fetch->hostname, pathname, false,
+                                      webpage_getETag(page),
+                                      webpage_getLastModified(page),
+                                      &fetch->requestLen);
+  free(pathname);
+  if (fetch->request == NULL) {
+    fetch_delete(fetch);
+    return NULL;
+  }
+  return fetch;
+}
+
+/**************** fetch_delete ****************/
+/* Free a fetch; its page is left alone.
+ */
+static void
+fetch_delete(fetch_t* fetch)
+{
+  if (fetch != NULL) {
+    free(fetch->hostname);
+    free(fetch->request);
+    http_response_delete(fetch->resp);
+    free(fetch);
+  }
+}
+
+/**************** fetch_connect ****************/
+/* Start a non-blocking connection for fetch, retrying failures up to
+ * MAX_TRY attempts in all, and register it with epoll; the attempt must
+ * connect by the connect deadline.
+ * Return false if every remaining attempt failed.
+ */
+static bool
+fetch_connect(fetcher_t* fetcher, fetch_t* fetch)
+{
+  int connectMillis, totalMillis;
+  webpage_getTimeouts(&connectMillis, NULL, &totalMillis);
+  while (fetch->tries < MAX_TRY) {
+    fetch->tries++;
+    fetch->start = deadline_now();
+    fetch->deadline = deadline_earlier(
+        connectMillis > 0 ? fetch->start + connectMillis : -1,
+        totalMillis > 0 ? fetch->start + totalMillis : -1);
+
+    struct sockaddr_in server;
+    if (!dnscache_resolve(fetch->hostname, fetch->port, &server)) {
+      continue;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+      continue;
+    }
+    int rc = connect(fd, (struct sockaddr*) &server, sizeof(server));
+    if (rc < 0 && errno != EINPROGRESS) {
+      close(fd);
+      continue;
+    }
+
+    // writable once the connection completes (or fails)
+    struct epoll_event event;
+    event.events = EPOLLOUT;
+    event.data.ptr = fetch;
+    if (epoll_ctl(fetcher->epfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+    fetch->fd = fd;
+    fetch->state = FETCH_CONNECTING;
+    return true;
+  }
+  return false;
+}
+
+/**************** fetch_close ****************/
+/* Close the fetch's socket, if open; closing also removes it from epoll.
+ */
+static void
+fetch_close(fetcher_t* fetcher, fetch_t* fetch)
+{
+  if (fetch->fd >= 0) {
+    epoll_ctl(fetcher->epfd, EPOLL_CTL_DEL, fetch->fd, NULL);
+    close(fetch->fd);
+    fetch->fd = -1;
+  }
+}
+
+/**************** fetch_handle ****************/
+/* Advance fetch given the epoll events on its socket.
+ * Return true if the fetch is finished, setting *success.
+ */
+static bool
+fetch_handle(fetcher_t* fetcher, fetch_t* fetch, const uint32_t events,
+             bool* success)
+{
+  if (fetch->state == FETCH_CONNECTING) {
+    int err = 0;
+    socklen_t errLen = sizeof(err);
+    if (getsockopt(fetch->fd, SOL_SOCKET, SO_ERROR, &err, &errLen) < 0
+        || err != 0) {
+      // connection failed; try again if we have attempts left
+      fetch_close(fetcher, fetch);
+      if (!fetch_connect(fetcher, fetch)) {
+        *success = false;
+        return true;
+      }
+      return false;
+    }
+    fetch->state = FETCH_SENDING;
+  }
+
+  if (fetch->state == FETCH_SENDING) {
+    return fetch_send(fetcher, fetch, success);
+  }
+  return fetch_receive(fetcher, fetch, success);
+}
+
+/**************** fetch_send ****************/
+/* Write as much of the request as the socket takes; once it has all
+ * been sent, switch to waiting for the response.
+ * Return true if the fetch is finished (failed), setting *success.
+ */
+static bool
+fetch_send(fetcher_t* fetcher, fetch_t* fetch, bool* success)
+{
+  while (fetch->requestSent < fetch->requestLen) {
+    ssize_t n = send(fetch->fd, &fetch->request[fetch->requestSent],
+                     fetch->requestLen - fetch->requestSent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return false;         // wait for the socket to drain
+      }
+      *success = false;
+      return true;
+    }
+    fetch->requestSent += n;
+  }
+
+  // the response must start by the first-byte deadline
+  int firstByteMillis, totalMillis;
+  webpage_getTimeouts(NULL, &firstByteMillis, &totalMillis);
+  fetch->deadline = deadline_earlier(
+      firstByteMillis > 0 ? deadline_now() + firstByteMillis : -1,
+      totalMillis > 0 ? fetch->start + totalMillis : -1);
+
+  fetch->resp = http_response_new();
+  http_response_limit(fetch->resp, webpage_getMaxBody(), true);
+  if (webpage_getRecording() != NULL) {
+    http_response_keepHeaders(fetch->resp);
+  }
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = fetch;
+  if (fetch->resp == NULL
+      || epoll_ctl(fetcher->epfd, EPOLL_CTL_MOD, fetch->fd, &event) < 0) {
+    *success = false;
+    return true;
+  }
+  fetch->state = FETCH_RECEIVING;
+  return false;
+}
+
+/**************** fetch_receive ****************/
+/* Read whatever the server has sent and feed it to the parser.
+ * Return true if the fetch is finished, setting *success.
+ */
+static bool
+fetch_receive(fetcher_t* fetcher, fetch_t* fetch, bool* success)
+{
+  while (true) {
+    // once into the body, read straight into the body's buffer
+    char* space;
+    size_t room = http_response_bodySpace(fetch->resp, &space);
+    ssize_t n = room > 0 ? read(fetch->fd, space, room)
+                         : read(fetch->fd, fetcher->readBuf, READ_SIZE);
+    http_result_t result;
+    if (n > 0) {
+      result = room > 0 ? http_response_bodyFilled(fetch->resp, n)
+                        : http_response_feed(fetch->resp, fetcher->readBuf, n);
+      // it has started; now only the whole attempt's deadline applies
+      int totalMillis;
+      webpage_getTimeouts(NULL, NULL, &totalMillis);
+      fetch->deadline = totalMillis > 0 ? fetch->start + totalMillis : -1;
+    } else if (n == 0) {
+      result = http_response_eof(fetch->resp);
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return false;           // wait for more
+    } else if (errno == EINTR) {
+      continue;
+    } else {
+      result = HTTP_ERROR;
+    }
+
+    if (result == HTTP_DONE) {
+      archive_t* recording = webpage_getRecording();
+      if (recording != NULL && http_response_status(fetch->resp) != 304) {
+        archive_add(recording, webpage_getURL(fetch->page), fetch->resp);
+      }
+      *success = fetch_finish(fetch);
+      return true;
+    } else if (result == HTTP_ERROR) {
+      *success = false;
+      return true;
+    }
+  }
+}
+
+/**************** fetch_finish ****************/
+/* Move a complete response's body and validators into the page, if the
+ * fetch succeeded, as webpage_fetch does. Return true if the page now
+ * has its html, or was fetched conditionally and has not changed.
+ */
+static bool
+fetch_finish(fetch_t* fetch)
+{
+  int status = http_response_status(fetch->resp);
+  webpage_setStatus(fetch->page, status);
+  const char* etag = http_response_etag(fetch->resp);
+  const char* lastModified = http_response_lastModified(fetch->resp);
+  if (status == 304 && webpage_setNotModified(fetch->page)) {
+    if (etag != NULL || lastModified != NULL) {
+      webpage_setValidators(fetch->page, etag, lastModified);
+    }
+    return true;
+  }
+  if (status != 200 || http_response_skipped(fetch->resp)) {
+    return false;
+  }
+  size_t len;
+  char* html = http_response_takeBody(fetch->resp, &len);
+  if (html == NULL) {
+    return false;
+  }
+  if (!webpage_setHTML(fetch->page, html, len)) {
+    free(html);
+    return false;
+  }
+  return webpage_setValidators(fetch->page, etag, lastModified);
+}
+
+/**************** fetch_retry ****************/
+/* Abandon the fetch's current attempt, which has missed its deadline,
+ * and start the next, if it has any left.
+ * Return false if every remaining attempt failed.
+ */
+static bool
+fetch_retry(fetcher_t* fetcher, fetch_t* fetch)
+{
+  fetch_close(fetcher, fetch);
+  http_response_delete(fetch->resp);
+  fetch->resp = NULL;
+  fetch->requestSent = 0;
+  return fetch_connect(fetcher, fetch);
+}
+
+/**************** fetcher_add ****************/
+/* Count a fetch outstanding, once its connection has been started.
+ */
+static void
+fetcher_add(fetcher_t* fetcher, fetch_t* fetch)
+{
+  fetch->slot = fetcher->inFlight;
+  fetcher->fetches[fetcher->inFlight++] = fetch;
+}
+
+/**************** fetcher_remove ****************/
+/* No longer count a fetch outstanding, once finished.
+ */
+static void
+fetcher_remove(fetcher_t* fetcher, fetch_t* fetch)
+{
+  fetch_t* last = fetcher->fetches[--fetcher->inFlight];
+  fetcher->fetches[fetch->slot] = last;
+  last->slot = fetch->slot;
+}
+
+/**************** fetcher_expire ****************/
+/* Retry every fetch whose attempt is past its deadline, finishing, with
+ * donefunc, those with no attempts left; set *deadline to the earliest
+ * deadline of the fetches still outstanding, or -1 if none has one.
+ * Return true if any fetch was finished.
+ */
+static bool
+fetcher_expire(fetcher_t* fetcher, void* arg,
+               void (*donefunc)(void* arg, webpage_t* page, bool success),
+               long* deadline)
+{
+  long now = deadline_now();
+  bool finished = false;
+  *deadline = -1;
+  // from the end, so removing one moves only fetches already checked
+  for (int i = fetcher->inFlight - 1; i >= 0; i--) {
+    fetch_t* fetch = fetcher->fetches[i];
+    if (fetch->deadline >= 0 && fetch->deadline <= now
+        && !fetch_retry(fetcher, fetch)) {
+      webpage_t* page = fetch->page;
+      fetcher_remove(fetcher, fetch);
+      fetch_delete(fetch);
+      (*donefunc)(arg, page, false);
+      finished = true;
+      continue;
+    }
+    *deadline = deadline_earlier(*deadline, fetch->deadline);
+  }
+  return finished;
+}
@@ -0,0 +1,75 @@
+/*
+ * fetcher.h - header file for the CS50 'fetcher' module
+ *
+ * An event-driven page fetcher. Where webpage_fetch() blocks on one
+ * page at a time, a fetcher drives many non-blocking connections at
+ * once from a single thread, using epoll to wait for whichever server
+ * is ready next. Pages come from a caller-supplied `nextfunc`, and each
+ * finished page is handed back through a caller-supplied `donefunc`;
+ * the donefunc may make more pages available to nextfunc, so a crawler
+ * can keep hundreds of fetches outstanding while it scans for links.
+ *
+ * Usage example:
+ *   fetcher_t* fetcher = fetcher_new(200);
+ *   fetcher_run(fetcher, frontier, frontierNext, pageFetched);
+ *   fetcher_delete(fetcher);
+ *
+ * Hugo Fang, 2/20/2024
+ */
+
+#ifndef __FETCHER_H
+#define __FETCHER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "webpage.h"
+
+/**************** global types ****************/
+typedef struct fetcher fetcher_t;  // opaque to users of the module
+
+/**************** fetcher_new ****************/
+/* Create a new fetcher.
+ *
+ * Caller provides:
+ *   maxInFlight, the most fetches to have outstanding at once (> 0).
+ * We return:
+ *   pointer to a new fetcher, or NULL if error.
+ * Caller is responsible for:
+ *   later calling fetcher_delete.
+ */
+fetcher_t* fetcher_new(const int maxInFlight);
+
+/**************** fetcher_run ****************/
+/* Fetch pages until there is no more work.
+ *
+ * Caller provides:
+ *   a valid fetcher;
+ *   arg, passed through to both functions;
+ *   nextfunc, returning the next page to fetch (a webpage_t* with a URL
+ *     and no html, as for webpage_fetch), or NULL if none is available
+ *     right now; when returning NULL it sets *waitMillis to how soon
+ *     one may become available without any fetch finishing (e.g., when
+ *     a host's politeness delay runs out), or leaves it at -1 if not;
+ *   donefunc, called once for every page nextfunc returned, with
+ *     success true if its html was fetched (see webpage_getHTML), or
+ *     if it was fetched conditionally and has not changed (see
+ *     webpage_isNotModified); pages with validators are fetched
+ *     conditionally, as by webpage_fetch.
+ * We guarantee:
+ *   nextfunc is called whenever a slot is free, including after each
+ *   donefunc and once any requested wait has passed; the run ends when
+ *   nextfunc returns NULL with no wait requested and no fetch is
+ *   outstanding. Both functions are called from the calling thread.
+ * Caller is responsible for:
+ *   the pages: donefunc takes them back and must eventually delete them.
+ */
+void fetcher_run(fetcher_t* fetcher, void* arg,
+                 webpage_t* (*nextfunc)(void* arg, long* waitMillis),
+                 void (*donefunc)(void* arg, webpage_t* page, bool success));
+
+/**************** fetcher_delete ****************/
+/* Delete the fetcher; must not be called from within fetcher_run.
+ */
+void fetcher_delete(fetcher_t* fetcher);
+
+#endif // __FETCHER_H
@@ -23,7 +23,7 @@ file_numLines(FILE* fp)
   rewind(fp);
 
   int nlines = 0;
-  char c = '\0';
+  int c = '\0';
   while ( (c = fgetc(fp)) != EOF) {
     if (c == '\n') {
       nlines++;
@@ -70,14 +70,17 @@ file_readUntil(FILE* fp, int (*stopfunc)(int c))
 
   // Read characters from file until stop-character or EOF, 
   // expanding the buffer when needed to hold more.
+  // (c is an int so EOF is distinct from a 0xFF byte.)
   int pos;
-  char c;
+  int c;
   for (pos = 0; (c = fgetc(fp)) != EOF && !(*stopfunc)(c); pos++) {
     // We need to save buf[pos+1] for the terminating null
     // and buf[len-1] is the last usable slot, 
     // so if pos+1 is past that slot, we need to grow the buffer.
+    // Doubling it keeps the total copying linear in the length read.
     if (pos+1 > len-1) {
-      char* newbuf = realloc(buf, ++len * sizeof(char));
+      len *= 2;
+      char* newbuf = realloc(buf, len * sizeof(char));
       if (newbuf == NULL) {
         free(buf);
         return NULL;
@@ -0,0 +1,1053 @@
+/*
+ * http.c - CS50 'http' module
+ *
+ * see http.h for more information.
+ *
+ * Hugo Fang, 2/20/2024
+ */
+
+#define _GNU_SOURCE       // strncasecmp, strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <zlib.h>
+#include "http.h"
+
+/**************** file-local global variables ****************/
+static const int HTTP_PORT = 80;         // default web server port
+static const size_t LINE_INIT = 128;     // initial header line buffer
+static const size_t LINE_LIMIT = 65536;    // longest header line accepted
+static const size_t HEADERS_MAX = 1L << 20;  // most header bytes kept
+static const size_t BODY_INIT = 16384;   // initial body buffer
+static const size_t BODY_BLOCK = 16384;  // least space offered for a read
+static const long PREALLOC_MAX = 64L << 20; // most Content-Length trusted
+static const size_t DECODED_MAX = 64L << 20; // most a body may inflate to
+
+/**************** local types ****************/
+typedef enum {
+  PARSE_STATUS,           // reading the status line
+  PARSE_HEADERS,          // reading header lines
+  PARSE_BODY,             // reading a body framed by length or connection
+  PARSE_CHUNK_SIZE,       // reading the size line of a chunk
+  PARSE_CHUNK_DATA,       // reading the data of a chunk
+  PARSE_CHUNK_END,        // reading the CRLF that ends a chunk
+  PARSE_TRAILERS,         // reading trailer lines after the last chunk
+  PARSE_DONE,             // response complete
+  PARSE_ERROR             // malformed response
+} parse_state_t;
+
+typedef enum {
+  ENCODING_NONE,          // body is sent as is
+  ENCODING_GZIP,          // Content-Encoding: gzip
+  ENCODING_DEFLATE        // Content-Encoding: deflate (zlib, or raw)
+} encoding_t;
+
+/**************** global types ****************/
+typedef struct http_response {
+  parse_state_t state;
+  int status;             // status code from the status line
+  long contentLength;     // from Content-Length, or -1 if none
+  bool chunked;           // Transfer-Encoding: chunked
+  bool keepAlive;         // server will keep the connection open
+  size_t chunkLeft;       // bytes left in the current chunk
+  char* etag;             // from ETag, or NULL if none
+  char* lastModified;     // from Last-Modified, or NULL if none
+  encoding_t encoding;    // from Content-Encoding
+  z_stream* inflater;     // decodes the body, once it starts, if encoded
+  bool inflateEnded;      // inflater has reached the end of the stream
+  unsigned char head;     // first byte of a deflate body, if it came alone
+  bool headHeld;          // holding it until the second arrives
+  size_t maxBody;         // most body kept, or 0 for no limit
+  bool htmlOnly;          // skip the body of a 200 response not in HTML
+  bool notHTML;           // Content-Type is given, and is not HTML
+  bool skipped;           // body was skipped, not being HTML
+  bool truncated;         // body was cut off at maxBody
+
+  bool keepHeaders;       // keep the status and header lines
+  char* headers;          // those kept, each ending in CRLF, or NULL
+  size_t headersLen;
+  size_t headersCap;
+
+  char* line;             // partial status or header line, split by a read
+  size_t lineLen;
+  size_t lineCap;
+
+  char* body;             // body received so far (decoded), null-terminated
+  size_t bodyLen;
+  size_t bodyCap;
+  size_t bodyRead;        // bytes of body read (before decoding)
+} http_response_t;
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool appendLine(http_response_t* resp, const char* buf, const size_t len);
+static void parseLine(http_response_t* resp, const char* line, size_t len);
+static void parseStatus(http_response_t* resp, const char* line, const size_t len);
+static void parseHeader(http_response_t* resp, const char* line, const size_t len);
+static void endHeaders(http_response_t* resp);
+static void parseChunkSize(http_response_t* resp, const char* line, const size_t len);
+static bool isName(const char* name, const size_t len, const char* want);
+static bool hasToken(const char* value, const size_t len, const char* token);
+static bool isHTMLType(const char* value, const size_t len);
+static bool setValue(char** field, const char* value, size_t len);
+static bool keepLine(http_response_t* resp, const char* line, const size_t len);
+static bool reserveBody(http_response_t* resp, const size_t len);
+static bool appendBody(http_response_t* resp, const char* buf, const size_t len);
+static bool receiveBody(http_response_t* resp, const char* buf, const size_t len);
+static bool inflateBody(http_response_t* resp, const char* buf, const size_t len);
+static bool feedInflater(http_response_t* resp, const Bytef* buf,
+                         const size_t len);
+static void bodyReceived(http_response_t* resp);
+static void limitBody(http_response_t* resp);
+static void endBody(http_response_t* resp);
+static http_result_t result(const http_response_t* resp);
+
+/**************** http_burstURL() ****************/
+/* see http.h for description
+ *
+ * Each string is allocated enough space to hold the whole URL,
+ * which is more than necessary, allowing a little growth if needed.
+ */
+bool
+http_burstURL(const char* url, char** hostname, int* port, char** pathname)
+{
+  // make plenty of space for the resulting strings
+  int length = strlen(url);
+
+  // initialize hostname to empty string
+  *hostname = calloc(sizeof(char), length); // initialized to all nulls
+  if (*hostname == NULL) {
+    return false;
+  }
+
+  // initialize pathname to slash
+  *pathname = calloc(sizeof(char), length); // initialized to all nulls
+  if (*pathname == NULL) {
+    free(*hostname);
+    *hostname = NULL;
+    return false;
+  } else {
+    **pathname = '/';
+  }
+
+  // initialize port to default port
+  *port = HTTP_PORT;
+
+  // parse various forms of the URL
+  if (sscanf(url, "http://%[^:]:%d/%s", *hostname, port, *pathname+1) == 3) {
+    return true;
+  } else if (sscanf(url, "http://%[^/]/%s", *hostname, *pathname+1) == 2) {
+    return true;
+  } else if (sscanf(url, "http://%[^:]:%d", *hostname, port) == 2) {
+    return true;
+  } else if (sscanf(url, "http://%[^/]/", *hostname) == 1) {
+    return true;
+  } else if (sscanf(url, "http://%s", *hostname) == 1) {
+    return true;
+  } else {
+    free(*hostname); *hostname = NULL;
+    free(*pathname); *pathname = NULL;
+    return false;
+  }
+}
+
+/**************** http_formatRequest() ****************/
+/* see http.h for description */
+char*
+http_formatRequest(const char* hostname, const char* pathname,
+                   const bool keepAlive, const char* etag,
+                   const char* lastModified, size_t* len)
+{
+  if (hostname == NULL || pathname == NULL) {
+    return NULL;
+  }
+
+  const char* httpFormat =
+    "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\n"
+    "Accept-Encoding: gzip, deflate\r\n%s%s%s%s%s%s\r\n";
+  const char* connection = keepAlive ? "keep-alive" : "close";
+  const char* inm = etag ? "If-None-Match: " : "";
+  const char* ims = lastModified ? "If-Modified-Since: " : "";
+  const char* inmEnd = etag ? "\r\n" : "";
+  const char* imsEnd = lastModified ? "\r\n" : "";
+  etag = etag ? etag : "";
+  lastModified = lastModified ? lastModified : "";
+  int reqLen = snprintf(NULL, 0, httpFormat, pathname, hostname, connection,
+                        inm, etag, inmEnd, ims, lastModified, imsEnd);
+  char* request = malloc(reqLen + 1);
+  if (request == NULL) {
+    return NULL;
+  }
+  snprintf(request, reqLen + 1, httpFormat, pathname, hostname, connection,
+           inm, etag, inmEnd, ims, lastModified, imsEnd);
+  if (len != NULL) {
+    *len = reqLen;
+  }
+  return request;
+}
+
+/**************** http_response_new() ****************/
+/* see http.h for description */
+http_response_t*
+http_response_new(void)
+{
+  http_response_t* resp = malloc(sizeof(http_response_t));
+  if (resp == NULL) {
+    return NULL;
+  }
+
+  resp->state = PARSE_STATUS;
+  resp->status = 0;
+  resp->contentLength = -1;
+  resp->chunked = false;
+  resp->keepAlive = false;
+  resp->chunkLeft = 0;
+  resp->etag = resp->lastModified = NULL;
+  resp->encoding = ENCODING_NONE;
+  resp->inflater = NULL;
+  resp->inflateEnded = false;
+  resp->headHeld = false;
+  resp->maxBody = 0;
+  resp->htmlOnly = resp->notHTML = false;
+  resp->skipped = resp->truncated = false;
+  resp->keepHeaders = false;
+  resp->headers = NULL;
+  resp->headersLen = resp->headersCap = 0;
+  resp->line = NULL;
+  resp->lineLen = resp->lineCap = 0;
+  resp->body = NULL;
+  resp->bodyLen = resp->bodyCap = 0;
+  resp->bodyRead = 0;
+  return resp;
+}
+
+/**************** http_response_limit() ****************/
+/* see http.h for description */
+void
+http_response_limit(http_response_t* resp, const size_t maxBody,
+                    const bool htmlOnly)
+{
+  if (resp != NULL && resp->state == PARSE_STATUS) {
+    resp->maxBody = maxBody;
+    resp->htmlOnly = htmlOnly;
+  }
+}
+
+/**************** http_response_keepHeaders() ****************/
+/* see http.h for description */
+void
+http_response_keepHeaders(http_response_t* resp)
+{
+  if (resp != NULL && resp->state == PARSE_STATUS) {
+    resp->keepHeaders = true;
+  }
+}
+
+/**************** http_response_feed() ****************/
+/* see http.h for description
+ *
+ * Lines are parsed where they lie in buf; only a line split between
+ * two calls is copied, into resp->line, until the rest arrives.
+ */
+http_result_t
+http_response_feed(http_response_t* resp, const char* buf, const size_t len)
+{
+  if (resp == NULL || (buf == NULL && len > 0)) {
+    return HTTP_ERROR;
+  }
+
+  size_t pos = 0;
+  while (pos < len && resp->state != PARSE_DONE && resp->state != PARSE_ERROR) {
+    if (resp->state == PARSE_BODY) {
+      // take as much of the body as this buffer holds
+      size_t want = len - pos;
+      if (resp->contentLength >= 0
+          && want > (size_t)resp->contentLength - resp->bodyRead) {
+        want = resp->contentLength - resp->bodyRead;
+      }
+      if (!receiveBody(resp, &buf[pos], want)) {
+        resp->state = PARSE_ERROR;
+        break;
+      }
+      pos += want;
+      bodyReceived(resp);
+      limitBody(resp);
+    } else if (resp->state == PARSE_CHUNK_DATA) {
+      size_t want = len - pos;
+      if (want > resp->chunkLeft) {
+        want = resp->chunkLeft;
+      }
+      if (!receiveBody(resp, &buf[pos], want)) {
+        resp->state = PARSE_ERROR;
+        break;
+      }
+      pos += want;
+      resp->chunkLeft -= want;
+      if (resp->chunkLeft == 0) {
+        resp->state = PARSE_CHUNK_END;
+      }
+      limitBody(resp);
+    } else {
+      // status, header, chunk-size, or trailer line: up to the newline
+      const char* start = &buf[pos];
+      const char* newline = memchr(start, '\n', len - pos);
+      size_t lineLen = newline ? (size_t)(newline - start) : len - pos;
+      if (newline != NULL && resp->lineLen == 0) {
+        parseLine(resp, start, lineLen);          // whole line is here
+      } else if (!appendLine(resp, start, lineLen)) {
+        resp->state = PARSE_ERROR;
+      } else if (newline != NULL) {
+        parseLine(resp, resp->line, resp->lineLen);
+        resp->lineLen = 0;
+      }
+      pos += lineLen + (newline ? 1 : 0);
+    }
+  }
+
+  return result(resp);
+}
+
+/**************** http_response_bodySpace() ****************/
+/* see http.h for description */
+size_t
+http_response_bodySpace(http_response_t* resp, char** space)
+{
+  // an encoded body must go through the inflater
+  if (resp == NULL || space == NULL || resp->state != PARSE_BODY
+      || resp->encoding != ENCODING_NONE) {
+    return 0;
+  }
+
+  size_t want = BODY_BLOCK;
+  if (resp->contentLength >= 0) {
+    want = resp->contentLength - resp->bodyLen;
+  }
+  if (resp->maxBody > 0 && want > resp->maxBody - resp->bodyLen) {
+    want = resp->maxBody - resp->bodyLen;
+  }
+  // use what is free if it is a reasonable read, else grow
+  size_t room = resp->bodyCap ? resp->bodyCap - resp->bodyLen - 1 : 0;
+  if (room < want && room < BODY_BLOCK) {
+    if (!reserveBody(resp, want < BODY_BLOCK ? want : BODY_BLOCK)) {
+      return 0;
+    }
+    room = resp->bodyCap - resp->bodyLen - 1;
+  }
+  *space = &resp->body[resp->bodyLen];
+  return room < want ? room : want;
+}
+
+/**************** http_response_bodyFilled() ****************/
+/* see http.h for description */
+http_result_t
+http_response_bodyFilled(http_response_t* resp, const size_t len)
+{
+  if (resp == NULL) {
+    return HTTP_ERROR;
+  }
+  if (len > 0) {
+    if (resp->state != PARSE_BODY || resp->encoding != ENCODING_NONE
+        || resp->bodyLen + len >= resp->bodyCap
+        || (resp->contentLength >= 0
+            && resp->bodyLen + len > (size_t)resp->contentLength)) {
+      resp->state = PARSE_ERROR;
+    } else {
+      resp->bodyLen += len;
+      resp->bodyRead += len;
+      resp->body[resp->bodyLen] = '\0';
+      bodyReceived(resp);
+      limitBody(resp);
+    }
+  }
+  return result(resp);
+}
+
+/**************** http_response_eof() ****************/
+/* see http.h for description */
+http_result_t
+http_response_eof(http_response_t* resp)
+{
+  if (resp == NULL) {
+    return HTTP_ERROR;
+  }
+  if (resp->state == PARSE_BODY && resp->contentLength < 0) {
+    // body delimited by end of connection
+    endBody(resp);
+  } else if (resp->state != PARSE_DONE) {
+    resp->state = PARSE_ERROR;
+  }
+  return resp->state == PARSE_DONE ? HTTP_DONE : HTTP_ERROR;
+}
+
+/**************** http_response_status() ****************/
+/* see http.h for description */
+int
+http_response_status(const http_response_t* resp)
+{
+  return resp ? resp->status : 0;
+}
+
+/**************** http_response_keepAlive() ****************/
+/* see http.h for description */
+bool
+http_response_keepAlive(const http_response_t* resp)
+{
+  return resp != NULL && resp->state == PARSE_DONE && resp->keepAlive;
+}
+
+/**************** http_response_etag() ****************/
+/* see http.h for description */
+const char*
+http_response_etag(const http_response_t* resp)
+{
+  return resp ? resp->etag : NULL;
+}
+
+/**************** http_response_lastModified() ****************/
+/* see http.h for description */
+const char*
+http_response_lastModified(const http_response_t* resp)
+{
+  return resp ? resp->lastModified : NULL;
+}
+
+/**************** http_response_skipped() ****************/
+/* see http.h for description */
+bool
+http_response_skipped(const http_response_t* resp)
+{
+  return resp != NULL && resp->skipped;
+}
+
+/**************** http_response_truncated() ****************/
+/* see http.h for description */
+bool
+http_response_truncated(const http_response_t* resp)
+{
+  return resp != NULL && resp->truncated;
+}
+
+/**************** http_response_headers() ****************/
+/* see http.h for description */
+const char*
+http_response_headers(const http_response_t* resp, size_t* len)
+{
+  if (resp == NULL || resp->headers == NULL) {
+    return NULL;
+  }
+  if (len != NULL) {
+    *len = resp->headersLen;
+  }
+  return resp->headers;
+}
+
+/**************** http_response_body() ****************/
+/* see http.h for description */
+const char*
+http_response_body(const http_response_t* resp, size_t* len)
+{
+  if (resp == NULL) {
+    return NULL;
+  }
+  if (len != NULL) {
+    *len = resp->bodyLen;
+  }
+  return resp->body != NULL ? resp->body : "";
+}
+
+/**************** http_response_takeBody() ****************/
+/* see http.h for description */
+char*
+http_response_takeBody(http_response_t* resp, size_t* len)
+{
+  if (resp == NULL) {
+    return NULL;
+  }
+  if (resp->body == NULL && !appendBody(resp, "", 0)) {
+    return NULL;
+  }
+
+  char* body = resp->body;
+  if (len != NULL) {
+    *len = resp->bodyLen;
+  }
+  resp->body = NULL;
+  resp->bodyLen = resp->bodyCap = 0;
+  return body;
+}
+
+/**************** http_response_delete() ****************/
+/* see http.h for description */
+void
+http_response_delete(http_response_t* resp)
+{
+  if (resp != NULL) {
+    free(resp->line);
+    free(resp->headers);
+    free(resp->body);
+    free(resp->etag);
+    free(resp->lastModified);
+    if (resp->inflater != NULL) {
+      inflateEnd(resp->inflater);
+      free(resp->inflater);
+    }
+    free(resp);
+  }
+}
+
+/**************** appendLine ****************/
+/* Add len bytes to the partial line, growing the buffer as needed.
+ * Return false if out of memory or the line is unreasonably long.
+ */
+static bool
+appendLine(http_response_t* resp, const char* buf, const size_t len)
+{
+  if (resp->lineLen + len > LINE_LIMIT) {
+    return false;
+  }
+  // keep room for the terminating null
+  if (resp->lineLen + len + 1 > resp->lineCap) {
+    size_t cap = resp->lineCap ? resp->lineCap : LINE_INIT;
+    while (resp->lineLen + len + 1 > cap) {
+      cap *= 2;
+    }
+    char* line = realloc(resp->line, cap);
+    if (line == NULL) {
+      return false;
+    }
+    resp->line = line;
+    resp->lineCap = cap;
+  }
+  memcpy(&resp->line[resp->lineLen], buf, len);
+  resp->lineLen += len;
+  resp->line[resp->lineLen] = '\0';
+  return true;
+}
+
+/**************** parseLine ****************/
+/* Handle a complete line of len bytes, which has had its '\n' removed
+ * but may still end in '\r', according to where we are in the response.
+ * The line need not be null-terminated, and is not modified.
+ */
+static void
+parseLine(http_response_t* resp, const char* line, size_t len)
+{
+  if (len > 0 && line[len - 1] == '\r') {
+    len--;
+  }
+
+  switch (resp->state) {
+  case PARSE_STATUS:
+    parseStatus(resp, line, len);
+    break;
+  case PARSE_HEADERS:
+    if (len == 0) {
+      endHeaders(resp);       // blank line: the body follows
+    } else {
+      parseHeader(resp, line, len);
+    }
+    break;
+  case PARSE_CHUNK_SIZE:
+    parseChunkSize(resp, line, len);
+    break;
+  case PARSE_CHUNK_END:
+    resp->state = (len == 0) ? PARSE_CHUNK_SIZE : PARSE_ERROR;
+    break;
+  case PARSE_TRAILERS:
+    if (len == 0) {
+      endBody(resp);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/**************** parseStatus ****************/
+/* Parse the status line, e.g., "HTTP/1.1 200 OK". HTTP/1.1 connections
+ * persist unless the server says otherwise; HTTP/1.0 ones do not.
+ */
+static void
+parseStatus(http_response_t* resp, const char* line, const size_t len)
+{
+  // "HTTP/" digit "." digit, one or more spaces, three digits
+  if (len < 12 || strncmp(line, "HTTP/", 5) != 0
+      || !isdigit(line[5]) || line[6] != '.' || !isdigit(line[7])
+      || line[8] != ' ') {
+    resp->state = PARSE_ERROR;
+    return;
+  }
+  int major = line[5] - '0';
+  int minor = line[7] - '0';
+  size_t i = 8;
+  while (i < len && line[i] == ' ') {
+    i++;
+  }
+  if (i + 3 > len || !isdigit(line[i]) || !isdigit(line[i + 1])
+      || !isdigit(line[i + 2])) {
+    resp->state = PARSE_ERROR;
+    return;
+  }
+  resp->status = (line[i] - '0') * 100 + (line[i + 1] - '0') * 10
+                 + (line[i + 2] - '0');
+  resp->keepAlive = (major > 1 || (major == 1 && minor >= 1));
+  resp->state = keepLine(resp, line, len) ? PARSE_HEADERS : PARSE_ERROR;
+}
+
+/**************** parseHeader ****************/
+/* Record what we need to know from one header line, and keep the line
+ * if asked to, unless it says how the body was framed or encoded: the
+ * body kept is decoded, and read to its end or the limit.
+ */
+static void
+parseHeader(http_response_t* resp, const char* line, const size_t len)
+{
+  const char* colon = memchr(line, ':', len);
+  if (colon == NULL) {
+    return;                   // not a header; ignore it
+  }
+  size_t nameLen = colon - line;
+  const char* value = colon + 1;
+  size_t valueLen = len - nameLen - 1;
+  while (valueLen > 0 && isspace(*value)) {
+    value++;
+    valueLen--;
+  }
+
+  if (resp->keepHeaders && !isName(line, nameLen, "Content-Length")
+      && !isName(line, nameLen, "Transfer-Encoding")
+      && !isName(line, nameLen, "Content-Encoding")
+      && !keepLine(resp, line, len)) {
+    resp->state = PARSE_ERROR;
+    return;
+  }
+
+  if (isName(line, nameLen, "Content-Length")) {
+    long length = 0;
+    size_t i;
+    for (i = 0; i < valueLen && isdigit(value[i]); i++) {
+      if (length > (LONG_MAX - 9) / 10) {
+        resp->state = PARSE_ERROR;
+        return;
+      }
+      length = length * 10 + (value[i] - '0');
+    }
+    if (i == 0) {
+      resp->state = PARSE_ERROR;
+    } else {
+      resp->contentLength = length;
+    }
+  } else if (isName(line, nameLen, "Transfer-Encoding")) {
+    resp->chunked = hasToken(value, valueLen, "chunked");
+  } else if (isName(line, nameLen, "ETag")) {
+    if (!setValue(&resp->etag, value, valueLen)) {
+      resp->state = PARSE_ERROR;
+    }
+  } else if (isName(line, nameLen, "Last-Modified")) {
+    if (!setValue(&resp->lastModified, value, valueLen)) {
+      resp->state = PARSE_ERROR;
+    }
+  } else if (isName(line, nameLen, "Content-Encoding")) {
+    // we ask only for these; anything else we could not decode
+    if (hasToken(value, valueLen, "gzip")) {
+      resp->encoding = ENCODING_GZIP;
+    } else if (hasToken(value, valueLen, "deflate")) {
+      resp->encoding = ENCODING_DEFLATE;
+    } else if (valueLen > 0 && !hasToken(value, valueLen, "identity")) {
+      resp->state = PARSE_ERROR;
+    }
+  } else if (isName(line, nameLen, "Content-Type")) {
+    resp->notHTML = !isHTMLType(value, valueLen);
+  } else if (isName(line, nameLen, "Connection")) {
+    if (hasToken(value, valueLen, "close")) {
+      resp->keepAlive = false;
+    } else if (hasToken(value, valueLen, "keep-alive")) {
+      resp->keepAlive = true;
+    }
+  }
+}
+
+/**************** endHeaders ****************/
+/* Decide how the body is framed once all headers are in. Responses
+ * with no body (1xx, 204, 304) end here; chunked encoding takes
+ * precedence over Content-Length; with neither, the body runs to the
+ * end of the connection, which therefore cannot be reused. A body of
+ * known length gets its whole buffer now, so it is never copied to
+ * grow it; the length is only trusted up to PREALLOC_MAX, and only
+ * the part of it under any limit on the body is allocated.
+ *
+ * If only HTML is wanted, a 200 response whose Content-Type says it is
+ * something else ends here too, with its body unread; the connection
+ * cannot be reused, as the body is still coming.
+ */
+static void
+endHeaders(http_response_t* resp)
+{
+  if ((resp->status >= 100 && resp->status < 200)
+      || resp->status == 204 || resp->status == 304) {
+    resp->state = PARSE_DONE;
+  } else if (resp->htmlOnly && resp->notHTML && resp->status == 200) {
+    resp->skipped = true;
+    resp->keepAlive = false;
+    resp->state = PARSE_DONE;
+  } else if (resp->chunked) {
+    resp->contentLength = -1;
+    resp->state = PARSE_CHUNK_SIZE;
+  } else if (resp->contentLength == 0) {
+    resp->state = PARSE_DONE;
+  } else {
+    long prealloc = resp->contentLength;
+    if (resp->maxBody > 0 && prealloc > (long)resp->maxBody) {
+      prealloc = resp->maxBody;
+    }
+    if (resp->contentLength < 0) {
+      resp->keepAlive = false;
+    } else if (prealloc <= PREALLOC_MAX && !reserveBody(resp, prealloc)) {
+      resp->state = PARSE_ERROR;
+      return;
+    }
+    resp->state = PARSE_BODY;
+  }
+}
+
+/**************** parseChunkSize ****************/
+/* Parse a chunk-size line (hex size, possibly followed by extensions);
+ * a zero size is the last chunk, followed by optional trailers.
+ */
+static void
+parseChunkSize(http_response_t* resp, const char* line, const size_t len)
+{
+  size_t size = 0;
+  size_t i;
+  for (i = 0; i < len && isxdigit(line[i]); i++) {
+    if (size > ((size_t)LONG_MAX >> 4)) {
+      resp->state = PARSE_ERROR;
+      return;
+    }
+    int c = tolower(line[i]);
+    size = size * 16 + (isdigit(c) ? c - '0' : c - 'a' + 10);
+  }
+  if (i == 0) {
+    resp->state = PARSE_ERROR;
+  } else if (size == 0) {
+    resp->state = PARSE_TRAILERS;
+  } else {
+    resp->chunkLeft = size;
+    resp->state = PARSE_CHUNK_DATA;
+  }
+}
+
+/**************** isName ****************/
+/* Return true if the len-byte header name is want, ignoring case.
+ */
+static bool
+isName(const char* name, const size_t len, const char* want)
+{
+  return strlen(want) == len && strncasecmp(name, want, len) == 0;
+}
+
+/**************** hasToken ****************/
+/* Return true if the len-byte header value contains token, ignoring case.
+ */
+static bool
+hasToken(const char* value, const size_t len, const char* token)
+{
+  size_t tokenLen = strlen(token);
+  for (size_t i = 0; i + tokenLen <= len; i++) {
+    if (strncasecmp(&value[i], token, tokenLen) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**************** isHTMLType ****************/
+/* Return true if the len-byte Content-Type value is an HTML media type,
+ * text/html or application/xhtml+xml, with or without parameters.
+ */
+static bool
+isHTMLType(const char* value, const size_t len)
+{
+  size_t typeLen = 0;
+  while (typeLen < len && value[typeLen] != ';' && !isspace(value[typeLen])) {
+    typeLen++;
+  }
+  return isName(value, typeLen, "text/html")
+         || isName(value, typeLen, "application/xhtml+xml");
+}
+
+/**************** setValue ****************/
+/* Replace *field with a copy of the len-byte header value, less any
+ * trailing whitespace. Return false if out of memory.
+ */
+static bool
+setValue(char** field, const char* value, size_t len)
+{
+  while (len > 0 && isspace(value[len - 1])) {
+    len--;
+  }
+  char* copy = malloc(len + 1);
+  if (copy == NULL) {
+    return false;
+  }
+  memcpy(copy, value, len);
+  copy[len] = '\0';
+  free(*field);
+  *field = copy;
+  return true;
+}
+
+/**************** keepLine ****************/
+/* Add the len-byte line, and a CRLF, to the headers kept, if they are
+ * being kept. Headers longer than HEADERS_MAX stop being kept, and those
+ * kept so far are dropped, but the response is still read. Return false
+ * if out of memory.
+ */
+static bool
+keepLine(http_response_t* resp, const char* line, const size_t len)
+{
+  if (!resp->keepHeaders) {
+    return true;
+  }
+  if (resp->headersLen + len + 2 > HEADERS_MAX) {
+    free(resp->headers);
+    resp->headers = NULL;
+    resp->headersLen = resp->headersCap = 0;
+    resp->keepHeaders = false;
+    return true;
+  }
+  if (resp->headersLen + len + 3 > resp->headersCap) {
+    size_t cap = resp->headersCap ? resp->headersCap : LINE_INIT * 4;
+    while (resp->headersLen + len + 3 > cap) {
+      cap *= 2;
+    }
+    char* headers = realloc(resp->headers, cap);
+    if (headers == NULL) {
+      return false;
+    }
+    resp->headers = headers;
+    resp->headersCap = cap;
+  }
+  memcpy(&resp->headers[resp->headersLen], line, len);
+  memcpy(&resp->headers[resp->headersLen + len], "\r\n", 3);
+  resp->headersLen += len + 2;
+  return true;
+}
+
+/**************** reserveBody ****************/
+/* Make room for len more bytes of body plus the terminating null:
+ * exactly that much for the first allocation if it is at least
+ * BODY_INIT, else doubling. Return false if out of memory.
+ */
+static bool
+reserveBody(http_response_t* resp, const size_t len)
+{
+  if (resp->bodyLen + len + 1 <= resp->bodyCap) {
+    return true;
+  }
+  size_t cap;
+  if (resp->bodyCap == 0) {
+    cap = len + 1 > BODY_INIT ? len + 1 : BODY_INIT;
+  } else {
+    cap = resp->bodyCap;
+    while (resp->bodyLen + len + 1 > cap) {
+      cap *= 2;
+    }
+  }
+  char* body = realloc(resp->body, cap);
+  if (body == NULL) {
+    return false;
+  }
+  resp->body = body;
+  resp->bodyCap = cap;
+  return true;
+}
+
+/**************** appendBody ****************/
+/* Add len bytes to the body, growing the buffer as needed, and keep
+ * the body null-terminated. Return false if out of memory.
+ */
+static bool
+appendBody(http_response_t* resp, const char* buf, const size_t len)
+{
+  if (!reserveBody(resp, len)) {
+    return false;
+  }
+  memcpy(&resp->body[resp->bodyLen], buf, len);
+  resp->bodyLen += len;
+  resp->body[resp->bodyLen] = '\0';
+  return true;
+}
+
+/**************** receiveBody ****************/
+/* Add len bytes received as part of the body, decoding them if the
+ * body is encoded, and keeping no more than maxBody bytes of it (the
+ * rest are dropped, and limitBody ends the response). Return false if
+ * out of memory or they can't be decoded.
+ */
+static bool
+receiveBody(http_response_t* resp, const char* buf, const size_t len)
+{
+  resp->bodyRead += len;
+  if (resp->encoding == ENCODING_NONE) {
+    size_t keep = len;
+    if (resp->maxBody > 0 && keep > resp->maxBody - resp->bodyLen) {
+      keep = resp->maxBody - resp->bodyLen;
+    }
+    return appendBody(resp, buf, keep);
+  }
+  return inflateBody(resp, buf, len);
+}
+
+/**************** inflateBody ****************/
+/* Decompress len more bytes of a gzip- or deflate-encoded body onto
+ * the body (see feedInflater). "deflate" is meant to be zlib-wrapped,
+ * but some servers send raw deflate data; we tell which from the first
+ * two bytes, a valid zlib header or not, holding the first back if it
+ * arrives alone. Return false if out of memory, the data are corrupt,
+ * or the body inflates past the limit.
+ */
+static bool
+inflateBody(http_response_t* resp, const char* buf, const size_t len)
+{
+  if (resp->inflateEnded || len == 0) {
+    return true;
+  }
+  if (resp->inflater == NULL) {
+    // 15 + 32: the largest window, and detect a gzip or zlib header
+    int windowBits = 15 + 32;
+    if (resp->encoding == ENCODING_DEFLATE) {
+      if (!resp->headHeld && len == 1) {
+        resp->head = (unsigned char)buf[0];
+        resp->headHeld = true;
+        return true;
+      }
+      unsigned char cmf = resp->headHeld ? resp->head : (unsigned char)buf[0];
+      unsigned char flg = resp->headHeld ? (unsigned char)buf[0]
+                                         : (unsigned char)buf[1];
+      bool zlib = (cmf & 0x0f) == 8 && (cmf >> 4) <= 7
+                  && ((cmf << 8) | flg) % 31 == 0;
+      windowBits = zlib ? 15 : -15;
+    }
+    resp->inflater = calloc(1, sizeof(z_stream));
+    if (resp->inflater == NULL
+        || inflateInit2(resp->inflater, windowBits) != Z_OK) {
+      free(resp->inflater);
+      resp->inflater = NULL;
+      return false;
+    }
+    if (resp->headHeld && !feedInflater(resp, &resp->head, 1)) {
+      return false;
+    }
+  }
+  return feedInflater(resp, (const Bytef*)buf, len);
+}
+
+/**************** feedInflater ****************/
+/* Run len bytes through the inflater, onto the body, growing it as
+ * needed, up to DECODED_MAX bytes; decoding stops once the body holds
+ * maxBody bytes, if limited. Bytes after the end of the compressed
+ * stream are ignored. Return false if out of memory, the data are
+ * corrupt, or the body inflates past the limit.
+ */
+static bool
+feedInflater(http_response_t* resp, const Bytef* buf, const size_t len)
+{
+  if (resp->inflateEnded) {
+    return true;
+  }
+  z_stream* zs = resp->inflater;
+  zs->next_in = (Bytef*)buf;
+  zs->avail_in = len;
+  do {
+    if (!reserveBody(resp, BODY_BLOCK)) {
+      return false;
+    }
+    zs->next_out = (Bytef*)&resp->body[resp->bodyLen];
+    zs->avail_out = resp->bodyCap - resp->bodyLen - 1;
+    if (resp->maxBody > 0 && zs->avail_out > resp->maxBody - resp->bodyLen) {
+      zs->avail_out = resp->maxBody - resp->bodyLen;
+    }
+    size_t before = zs->avail_out;
+    int ret = inflate(zs, Z_NO_FLUSH);
+    resp->bodyLen += before - zs->avail_out;
+    resp->body[resp->bodyLen] = '\0';
+
+    if (ret == Z_STREAM_END) {
+      resp->inflateEnded = true;
+      break;
+    }
+    if ((ret != Z_OK && ret != Z_BUF_ERROR) || resp->bodyLen > DECODED_MAX) {
+      return false;
+    }
+    if (resp->maxBody > 0 && resp->bodyLen >= resp->maxBody) {
+      break;                  // limitBody ends the response
+    }
+  } while (zs->avail_in > 0 || zs->avail_out == 0);
+  return true;
+}
+
+/**************** bodyReceived ****************/
+/* Finish a body framed by Content-Length once all of it is in.
+ */
+static void
+bodyReceived(http_response_t* resp)
+{
+  if (resp->state == PARSE_BODY && resp->contentLength >= 0
+      && resp->bodyRead == (size_t)resp->contentLength) {
+    endBody(resp);
+  }
+}
+
+/**************** limitBody ****************/
+/* End the response, cut off, once the body in the middle of arriving
+ * holds maxBody bytes. The rest is never read, so the connection cannot
+ * be reused.
+ */
+static void
+limitBody(http_response_t* resp)
+{
+  if (resp->maxBody > 0 && resp->bodyLen >= resp->maxBody
+      && !resp->inflateEnded
+      && (resp->state == PARSE_BODY || resp->state == PARSE_CHUNK_DATA
+          || resp->state == PARSE_CHUNK_END)) {
+    resp->truncated = true;
+    resp->keepAlive = false;
+    resp->state = PARSE_DONE;
+  }
+}
+
+/**************** endBody ****************/
+/* Finish the response once its body is all in; an encoded body must
+ * have decoded completely, unless decoding stopped at maxBody.
+ */
+static void
+endBody(http_response_t* resp)
+{
+  if ((resp->inflater != NULL || resp->headHeld) && !resp->inflateEnded) {
+    limitBody(resp);
+    if (resp->state != PARSE_DONE) {
+      resp->state = PARSE_ERROR;
+    }
+  } else {
+    resp->state = PARSE_DONE;
+  }
+}
+
+/**************** result ****************/
+/* Return what the parser's state means to a caller feeding it.
+ */
+static http_result_t
+result(const http_response_t* resp)
+{
+  switch (resp->state) {
+  case PARSE_DONE:  return HTTP_DONE;
+  case PARSE_ERROR: return HTTP_ERROR;
+  default:          return HTTP_MORE;
+  }
+}
@@ -0,0 +1,231 @@
+/*
+ * http.h - header file for the CS50 'http' module
+ *
+ * Helpers shared by the page fetchers: splitting a URL into the pieces
+ * needed to connect, formatting a GET request, and an incremental parser
+ * for HTTP/1.x responses. The parser is fed bytes as they arrive from the
+ * socket, in chunks of any size, so it works equally well for blocking
+ * reads and for event-driven (non-blocking) fetching. It understands
+ * bodies framed by Content-Length, by chunked transfer-encoding, or by
+ * the end of the connection, so it can tell when a kept-alive
+ * connection is ready for the next request. Header lines are parsed in
+ * the caller's buffer, without copying, unless split between reads.
+ * Requests accept gzip and deflate Content-Encoding, and the parser
+ * decompresses such bodies as they arrive, refusing any that inflate
+ * past 64MB. A parser may also be told to keep only so much of a body,
+ * and to skip the body of any response that is not HTML, so a fetcher
+ * never holds more of a page than it wants, and to keep the status and
+ * header lines, so a fetcher can archive what it was sent.
+ *
+ * Hugo Fang, 2/20/2024
+ */
+
+#ifndef __HTTP_H
+#define __HTTP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct http_response http_response_t;  // opaque to users of the module
+
+/* result of feeding bytes to the parser */
+typedef enum {
+  HTTP_MORE,     // response is incomplete; feed more bytes
+  HTTP_DONE,     // response is complete
+  HTTP_ERROR     // response is malformed, or out of memory
+} http_result_t;
+
+/**************** http_burstURL ****************/
+/* Burst a URL into the components needed to fetch it.
+ *
+ * Caller provides:
+ *   url, assumed non-NULL and already normalized, of the form
+ *   http://hostname[:port][/pathname]
+ * We return:
+ *   true if successful, filling in
+ *     *hostname, a new string containing the hostname,
+ *     *port, the port (80 if none given),
+ *     *pathname, a new string containing the pathname (at least "/");
+ *   false otherwise, with *hostname and *pathname set to NULL.
+ * Caller is responsible for:
+ *   later free()ing *hostname and *pathname on success.
+ */
+bool http_burstURL(const char* url, char** hostname, int* port, char** pathname);
+
+/**************** http_formatRequest ****************/
+/* Build the text of a GET request for pathname on hostname, asking the
+ * server to keep the connection open afterward if keepAlive is true.
+ * If etag or lastModified is not NULL, the request is conditional
+ * (If-None-Match, If-Modified-Since): a server whose copy still matches
+ * answers 304 Not Modified, with no body.
+ *
+ * We return:
+ *   a new string holding the request, or NULL if out of memory;
+ *   its length is stored in *len if len is not NULL.
+ * Caller is responsible for:
+ *   later free()ing the returned string.
+ */
+char* http_formatRequest(const char* hostname, const char* pathname,
+                         const bool keepAlive, const char* etag,
+                         const char* lastModified, size_t* len);
+
+/**************** http_response_new ****************/
+/* Create a parser for one response.
+ *
+ * We return:
+ *   pointer to a new parser, or NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling http_response_delete.
+ */
+http_response_t* http_response_new(void);
+
+/**************** http_response_limit ****************/
+/* Limit what the parser keeps of the response's body; call before
+ * feeding it anything.
+ *
+ * Caller provides:
+ *   maxBody, the most bytes of body (after decoding) to keep, or 0 for
+ *     no limit: the response is complete once the body holds that
+ *     many, the rest being left unread;
+ *   htmlOnly, true to skip the body of a 200 response whose Content-Type
+ *     is given and is neither text/html nor application/xhtml+xml: the
+ *     response is complete once its headers are in.
+ * A response cut short either way has left part of itself unread, so
+ * its connection is not reused (see http_response_keepAlive), and is
+ * flagged by http_response_truncated or http_response_skipped.
+ */
+void http_response_limit(http_response_t* resp, const size_t maxBody,
+                         const bool htmlOnly);
+
+/**************** http_response_keepHeaders ****************/
+/* Have the parser keep the response's status line and header lines, as
+ * received, for http_response_headers; call before feeding it anything.
+ */
+void http_response_keepHeaders(http_response_t* resp);
+
+/**************** http_response_feed ****************/
+/* Feed the next len bytes received from the server to the parser.
+ *
+ * We return:
+ *   HTTP_MORE if the response is not yet complete,
+ *   HTTP_DONE once the response is complete (any bytes beyond the end
+ *     of the response are ignored),
+ *   HTTP_ERROR if the response cannot be parsed, or its body decoded.
+ * Once HTTP_DONE or HTTP_ERROR has been returned, further calls return
+ * the same result without consuming anything.
+ */
+http_result_t http_response_feed(http_response_t* resp, const char* buf,
+                                 const size_t len);
+
+/**************** http_response_bodySpace ****************/
+/* Offer the caller space to read the next bytes of the body into
+ * directly, rather than reading into a buffer of its own and calling
+ * http_response_feed, which would then copy them. A body of known
+ * length is allocated whole once the headers are in, so reading into
+ * this space copies each byte of the body exactly once.
+ *
+ * We return:
+ *   the number of bytes that may be stored at *space, if the parser is
+ *     in the middle of a body framed by Content-Length or by the end of
+ *     the connection (never more than the rest of the body);
+ *   0 otherwise, including when the body is compressed or we are out
+ *     of memory, in which case the caller should use http_response_feed.
+ * Caller is responsible for:
+ *   calling http_response_bodyFilled with the number of bytes stored,
+ *   before calling any other function on resp.
+ */
+size_t http_response_bodySpace(http_response_t* resp, char** space);
+
+/**************** http_response_bodyFilled ****************/
+/* Tell the parser len bytes were stored at the space given by
+ * http_response_bodySpace (len no more than the size it returned).
+ *
+ * We return:
+ *   as for http_response_feed.
+ */
+http_result_t http_response_bodyFilled(http_response_t* resp, const size_t len);
+
+/**************** http_response_eof ****************/
+/* Tell the parser the server closed the connection.
+ *
+ * We return:
+ *   HTTP_DONE if the response is complete, which is the case for a
+ *     body delimited by the end of the connection;
+ *   HTTP_ERROR if the connection closed before the response was complete.
+ */
+http_result_t http_response_eof(http_response_t* resp);
+
+/**************** http_response_status ****************/
+/* Return the status code (e.g., 200), or 0 if not yet parsed.
+ */
+int http_response_status(const http_response_t* resp);
+
+/**************** http_response_keepAlive ****************/
+/* Return true if the response is complete and the connection it came
+ * on may be reused for another request: the server did not ask to
+ * close it, and the body was framed by length or chunking rather than
+ * by the end of the connection.
+ */
+bool http_response_keepAlive(const http_response_t* resp);
+
+/**************** http_response_etag ****************/
+/* Return the response's ETag header, or NULL if it had none (or the
+ * headers are not yet parsed). The string belongs to resp.
+ */
+const char* http_response_etag(const http_response_t* resp);
+
+/**************** http_response_lastModified ****************/
+/* Return the response's Last-Modified header, or NULL if it had none
+ * (or the headers are not yet parsed). The string belongs to resp.
+ */
+const char* http_response_lastModified(const http_response_t* resp);
+
+/**************** http_response_skipped ****************/
+/* Return true if the response is complete, but its body was skipped
+ * as not HTML (see http_response_limit).
+ */
+bool http_response_skipped(const http_response_t* resp);
+
+/**************** http_response_truncated ****************/
+/* Return true if the response is complete, but its body was cut off at
+ * the limit given to http_response_limit.
+ */
+bool http_response_truncated(const http_response_t* resp);
+
+/**************** http_response_headers ****************/
+/* Return the status line and header lines kept (see
+ * http_response_keepHeaders), each ending in CRLF, without the blank
+ * line after them, storing their length in *len if len is not NULL; or
+ * NULL if they were not kept, or ran past 1MB. Content-Length, Transfer-Encoding and
+ * Content-Encoding are left out, as the body the parser keeps is
+ * decoded (and may have been cut off); a copy of the response as kept
+ * needs a Content-Length of its own. The lines belong to resp.
+ */
+const char* http_response_headers(const http_response_t* resp, size_t* len);
+
+/**************** http_response_body ****************/
+/* Return the body received so far, null-terminated, storing its length
+ * in *len if len is not NULL; or NULL if resp is NULL. The body still
+ * belongs to resp, until taken by http_response_takeBody.
+ */
+const char* http_response_body(const http_response_t* resp, size_t* len);
+
+/**************** http_response_takeBody ****************/
+/* Take ownership of the body received so far.
+ *
+ * We return:
+ *   a null-terminated string holding the body (possibly empty), storing
+ *   its length in *len if len is not NULL; NULL if out of memory.
+ * Caller is responsible for:
+ *   later free()ing the returned string.
+ */
+char* http_response_takeBody(http_response_t* resp, size_t* len);
+
+/**************** http_response_delete ****************/
+/* Delete the parser and anything it still holds.
+ */
+void http_response_delete(http_response_t* resp);
+
+#endif // __HTTP_H
@@ -20,8 +20,17 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <time.h>
 #include <netdb.h>
-#include "file.h"
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "http.h"
+#include "archive.h"
+#include "connpool.h"
+#include "dnscache.h"
+#include "deadline.h"
 #include "webpage.h"
 #include "mem.h"
 
@@ -44,20 +53,33 @@ typedef struct webpage {
   char* html;                              // html code of the page
   size_t html_len;                         // length of html code
   int depth;                               // depth of crawl
+  char* etag;                              // validators, or NULL if none
+  char* lastModified;
+  bool notModified;                        // last fetch got 304
+  int status;                              // of last fetch, 0 if none
 } webpage_t;
 
 /* *********************************************************************** */
 /* Private function prototypes */
 
-static FILE* connectToHost(const char* hostname, const int port);
-static inline bool isBlankLine(const char* line);
-static char* removeDotSegments(char* input);
-static void removeWhitespace(char* str);
+static int connectToHost(const char* hostname, const int port,
+                         const long start, bool* timedOut);
+static http_result_t exchange(const int comm_sock, const char* request,
+                              const size_t requestLen, http_response_t* resp,
+                              const long start, bool* timedOut);
+static bool waitFor(const int fd, const short events, const long deadline,
+                    bool* timedOut);
+static void poolInit(void);
+static bool takeResponse(webpage_t* page, http_response_t* resp);
+static bool replayFetch(webpage_t* page);
+static size_t removeDotSegments(const char* input, const size_t in_len,
+                                char* out);
+static const char* scanTag(const char* tag, const char** href,
+                           size_t* hrefLen);
+static char* hrefToURL(char* base, const char* href, const size_t len);
 static char* fixRelativeURL(char* base, char* rel, size_t len);
 static bool parseURL(const char* str, struct URL* url);
 static void freeURL(struct URL url);
-static bool burstURL(const char* url, char** hostname, 
-                     int* port, char** pathname);
 #ifdef DEBUG
 static void printURL(struct URL url);
 #endif // DEBUG
@@ -66,7 +88,27 @@ static void printURL(struct URL url);
 /* Private global variables */
 
 static const int MAX_TRY = 3;    // maximum attempts to fetch
-static const int HTTP_PORT = 80; // default web server port
+#define READ_SIZE 16384          // bytes read from the socket at a time
+static const int POOL_PER_HOST = 8;    // idle connections kept per host
+static const int POOL_IDLE_SECS = 5;   // seconds an idle connection is kept
+
+// deadlines on each attempt to fetch, in milliseconds, or 0 for none;
+// see webpage_setTimeouts
+static int connectMillis = 5000;
+static int firstByteMillis = 10000;
+static int totalMillis = 30000;
+
+// most bytes of a page's html kept, or 0 for no limit; see webpage_setMaxBody
+static size_t maxBodyBytes = 0;
+
+// archive responses are recorded in, and archive pages are fetched from
+// instead of the network, if any; see webpage_record and webpage_replay
+static archive_t* recording = NULL;
+static replay_t* replaying = NULL;
+
+// kept-alive connections shared by all fetches, created on first use
+static connpool_t* pool = NULL;
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
 
 static const char* EXTS[] = {  // valid extensions
   "html",
@@ -91,6 +133,18 @@ char* webpage_getHTML(const webpage_t* page)  {
 char* webpage_getURL(const webpage_t* page)   { 
   return page ? page->url   : NULL; 
 }
+const char* webpage_getETag(const webpage_t* page) {
+  return page ? page->etag : NULL;
+}
+const char* webpage_getLastModified(const webpage_t* page) {
+  return page ? page->lastModified : NULL;
+}
+bool webpage_isNotModified(const webpage_t* page) {
+  return page ? page->notModified : false;
+}
+int webpage_getStatus(const webpage_t* page) {
+  return page ? page->status : 0;
+}
 
 /**************** webpage_new ****************/
 /* see webpage.h for documentation */
@@ -107,10 +161,76 @@ webpage_new(char* url, const int depth, char* html)
   page->depth = depth;
   page->html = html;
   page->html_len = html ? strlen(html) : 0;
+  page->etag = NULL;
+  page->lastModified = NULL;
+  page->notModified = false;
+  page->status = 0;
 
   return page;
 }
 
+/**************** webpage_setHTML ****************/
+/* see webpage.h for documentation */
+bool
+webpage_setHTML(webpage_t* page, char* html, const size_t html_len)
+{
+  if (page == NULL || html == NULL || page->html != NULL) {
+    return false;
+  }
+
+  page->html = html;
+  page->html_len = html_len;
+  return true;
+}
+
+/**************** webpage_setValidators ****************/
+/* see webpage.h for documentation */
+bool
+webpage_setValidators(webpage_t* page, const char* etag,
+                      const char* lastModified)
+{
+  if (page == NULL) {
+    return false;
+  }
+
+  char* etagCopy = etag ? strdup(etag) : NULL;
+  char* lastModifiedCopy = lastModified ? strdup(lastModified) : NULL;
+  if ((etag && etagCopy == NULL) || (lastModified && lastModifiedCopy == NULL)) {
+    free(etagCopy);
+    free(lastModifiedCopy);
+    return false;
+  }
+  free(page->etag);
+  free(page->lastModified);
+  page->etag = etagCopy;
+  page->lastModified = lastModifiedCopy;
+  return true;
+}
+
+/**************** webpage_setNotModified ****************/
+/* see webpage.h for documentation */
+bool
+webpage_setNotModified(webpage_t* page)
+{
+  if (page == NULL || page->html != NULL
+      || (page->etag == NULL && page->lastModified == NULL)) {
+    return false;
+  }
+
+  page->notModified = true;
+  return true;
+}
+
+/**************** webpage_setStatus ****************/
+/* see webpage.h for documentation */
+void
+webpage_setStatus(webpage_t* page, const int status)
+{
+  if (page != NULL) {
+    page->status = status;
+  }
+}
+
 /**************** webpage_delete ****************/
 /* see webpage.h for documentation */
 void
@@ -120,6 +240,8 @@ webpage_delete(void* data)
   if (page != NULL) {
     if (page->url) free(page->url);
     if (page->html) free(page->html);
+    free(page->etag);
+    free(page->lastModified);
     free(page);
   }
 }
@@ -136,10 +258,29 @@ webpage_delete(void* data)
  * Pseudocode:
  *     1. check for valid page 
  *     2. parse url into hostname, port, and filename
- *     3. open a connection to the given host
+ *     3. take a kept-alive connection to the host from the pool,
+ *        or open a new one
  *     4. send http request
- *     5. fetch html response
- *     6. cleanup
+ *     5. fetch and parse the response (conditionally, if the page has
+ *        validators)
+ *     6. return the connection to the pool if the server keeps it open
+ *     7. cleanup
+ *
+ * When replaying an archive, the page comes from it instead, and
+ * nothing else is done. When recording one, every response except a
+ * 304 is added to it.
+ *
+ * A reused connection may have been closed by the server since it went
+ * idle; if the exchange on one fails, we retry on a fresh connection
+ * without counting it as one of the MAX_TRY attempts.
+ *
+ * Sockets are non-blocking, and every wait on one is a poll() bounded by
+ * the deadlines of webpage_setTimeouts. An attempt that misses one
+ * counts as failed, and is retried while attempts are left.
+*
+ * We pause only before retrying a failed connection. Politeness between
+ * fetches from the same server is left to the caller, which knows which
+ * other servers it could be fetching from in the meantime.
  */
 bool 
 webpage_fetch(webpage_t* page)
@@ -148,82 +289,209 @@ webpage_fetch(webpage_t* page)
   if (page == NULL || page->url == NULL || page->html != NULL) {
     return false;
   }
+  page->notModified = false;
+  page->status = 0;
+  if (replaying != NULL) {
+    return replayFetch(page);
+  }
 
   // burst the URL into its components;
   // all we care about are hostname, port, and pathname
-  char* hostname; // will be initialized by burstURL
-  int port;       // will be initialized by burstURL
-  char* pathname; // will be initialized by burstURL
-  if (!burstURL(page->url, &hostname, &port, &pathname)) {
+  char* hostname; // will be initialized by http_burstURL
+  int port;       // will be initialized by http_burstURL
+  char* pathname; // will be initialized by http_burstURL
+  if (!http_burstURL(page->url, &hostname, &port, &pathname)) {
     return false;
   }
 
-  // attempt to connect to server 
-  FILE* http_fp = NULL; 
-  for (int try = 0;  http_fp == NULL && try < MAX_TRY; try++) {
-    // open connection - exit on error
-    http_fp = connectToHost(hostname, port);
-
-#ifndef NOSLEEP // CS50 students: please don't turn off the sleep!
-    sleep(1);   // sleep one second between fetches, to lighten load on server
-#endif
-  }
-
-  // failed to connect?
-  if (http_fp == NULL) {
+  // prepare the HTTP request, asking the server to keep the connection,
+  // and for the page only if changed when we have its validators
+  size_t requestLen;
+  char* request = http_formatRequest(hostname, pathname, true, page->etag,
+                                     page->lastModified, &requestLen);
+  free(pathname);
+  if (request == NULL) {
+    free(hostname);
     return false;
   }
 
-  // prepare and send HTTP request; receive response
-  char* httpResponse = NULL;
-  const char* httpFormat =
-    "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n";
-  if (fprintf(http_fp, httpFormat, pathname, hostname) >= 0) {
-    // ensure stdio buffer is flushed to socket
-    fflush(http_fp);
-    // read the server's response
-    httpResponse = file_readLine(http_fp);
-  }
-
-  free(hostname);
-  free(pathname);
+  pthread_once(&poolOnce, poolInit);
 
-  // did we succeed? check the response
   bool success = false;
+  bool done = false;
+  for (int try = 0; !done && try < MAX_TRY; ) {
+    // reuse an idle connection if we have one; otherwise open a new one
+    long start = deadline_now();
+    bool timedOut = false;
+    int comm_sock = connpool_get(pool, hostname, port);
+    bool reused = (comm_sock >= 0);
+    if (!reused) {
+      try++;
+      comm_sock = connectToHost(hostname, port, start, &timedOut);
+    }
+    if (comm_sock < 0) {
+#ifndef NOSLEEP
+      // back off before trying a server that refused us again; one that
+      // timed out has kept us waiting already. Spacing out successful
+      // fetches is up to the caller (see crawler's hostsched)
+      if (try < MAX_TRY && !timedOut) {
+        sleep(1);
+      }
+#endif
+      continue;
+    }
 
-  if (httpResponse != NULL) {
-    // check response code to see whether we succeeded
-    int httpResponseCode = 0;
-    if (sscanf(httpResponse, "HTTP/1.1 %d", &httpResponseCode) == 1
-        && httpResponseCode == 200) {
-      // success! ignore the rest of the header, then grab the page
-      // read lines until we read a blank line or fail to read a line
-      char* line = file_readLine(http_fp);
-      while (line != NULL && !isBlankLine(line)) {
-        free(line);
-        line = file_readLine(http_fp);
+    // send the request and receive the response
+    http_response_t* resp = http_response_new();
+    if (resp == NULL) {
+      close(comm_sock);
+      break;
+    }
+    http_response_limit(resp, maxBodyBytes, true);
+    if (recording != NULL) {
+      http_response_keepHeaders(resp);
+    }
+    if (exchange(comm_sock, request, requestLen, resp, start, &timedOut)
+        == HTTP_DONE) {
+      done = true;
+      if (recording != NULL && http_response_status(resp) != 304) {
+        archive_add(recording, page->url, resp);
+      }
+      success = takeResponse(page, resp);
+      if (http_response_keepAlive(resp)) {
+        connpool_put(pool, hostname, port, comm_sock);
+      } else {
+        close(comm_sock);
       }
-      // did we exit the loop because we read an empty line?
-      if (line != NULL) {
-        free(line); // the blank line
-
-        // then grab everything else - that should be the page content
-        char* html = file_readFile(http_fp);
-        if (html != NULL) {
-          page->html = html;
-          success = true;
-        } 
+    } else if (timedOut) {
+      // a failed attempt, whether the connection was fresh or reused
+      close(comm_sock);
+      if (reused) {
+        try++;
       }
+    } else {
+      // a fresh connection that fails is not retried, as before;
+      // a reused one may just have been closed by the server
+      close(comm_sock);
+      done = !reused;
     }
-    free(httpResponse);
+    http_response_delete(resp);
   }
 
   // clean up
-  fclose(http_fp);
-
+  free(hostname);
+  free(request);
   return success;
 }
 
+/**************** webpage_setTimeouts ****************/
+/* see webpage.h for documentation */
+void
+webpage_setTimeouts(const int connect, const int firstByte, const int total)
+{
+  if (connect >= 0) {
+    connectMillis = connect;
+  }
+  if (firstByte >= 0) {
+    firstByteMillis = firstByte;
+  }
+  if (total >= 0) {
+    totalMillis = total;
+  }
+}
+
+/**************** webpage_getTimeouts ****************/
+/* see webpage.h for documentation */
+void
+webpage_getTimeouts(int* connect_p, int* firstByte_p, int* total_p)
+{
+  if (connect_p != NULL) {
+    *connect_p = connectMillis;
+  }
+  if (firstByte_p != NULL) {
+    *firstByte_p = firstByteMillis;
+  }
+  if (total_p != NULL) {
+    *total_p = totalMillis;
+  }
+}
+
+/**************** webpage_setMaxBody ****************/
+/* see webpage.h for documentation */
+void
+webpage_setMaxBody(const size_t maxBytes)
+{
+  maxBodyBytes = maxBytes;
+}
+
+/**************** webpage_getMaxBody ****************/
+/* see webpage.h for documentation */
+size_t
+webpage_getMaxBody(void)
+{
+  return maxBodyBytes;
+}
+
+/**************** webpage_record ****************/
+/* see webpage.h for documentation */
+bool
+webpage_record(const char* archivePath)
+{
+  if (recording != NULL || replaying != NULL) {
+    return false;
+  }
+  recording = archive_new(archivePath);
+  return recording != NULL;
+}
+
+/**************** webpage_replay ****************/
+/* see webpage.h for documentation */
+bool
+webpage_replay(const char* archivePath)
+{
+  if (recording != NULL || replaying != NULL) {
+    return false;
+  }
+  replaying = archive_replayOpen(archivePath);
+  return replaying != NULL;
+}
+
+/**************** webpage_getRecording ****************/
+/* see webpage.h for documentation */
+archive_t*
+webpage_getRecording(void)
+{
+  return recording;
+}
+
+/**************** webpage_isReplaying ****************/
+/* see webpage.h for documentation */
+bool
+webpage_isReplaying(void)
+{
+  return replaying != NULL;
+}
+
+/**************** webpage_fetchCleanup ****************/
+/* see webpage.h for documentation */
+bool
+webpage_fetchCleanup(void)
+{
+  pthread_once(&poolOnce, poolInit);
+  connpool_delete(pool);
+  pool = NULL;
+  dnscache_clear();
+
+  bool ok = true;
+  if (recording != NULL) {
+    ok = archive_close(recording);
+    recording = NULL;
+  }
+  archive_replayClose(replaying);
+  replaying = NULL;
+  return ok;
+}
+
 /**************** webpage_getNextWord ****************/
 /* see webpage.h for usage documentation.
  *
@@ -306,6 +574,19 @@ webpage_getNextWord(webpage_t* page, int* pos)
 }
 
 /**************** webpage_getNextURL ****************/
+/* See "webpage.h" for full documentation.
+ */
+char* 
+webpage_getNextURL(webpage_t* page, int* pos)
+{
+  char* url;
+  if (webpage_getURLs(page, pos, &url, 1) == 1) {
+    return url;
+  }
+  return NULL;
+}
+
+/**************** webpage_getURLs ****************/
 /* See "webpage.h" for full documentation.
  *
  * Assumptions:
@@ -314,141 +595,54 @@ webpage_getNextWord(webpage_t* page, int* pos)
  *
  * Pseudocode:
  *     1. check arguments
- *     2. if *pos = 0 (first call for this page): remove whitespace from html
- *     3. find hyperlink starting tags "<a" or "<A"
- *     4. find next href attribute "href="
- *     5. find next end tag ">"
- *     6. check that href comes before end tag
- *     7. deal with quoted and unquoted urls
- *     8. determine if url is absolute
- *     9. fixup relative links
- *    10. update *pos to position after the URL
- *    11. create new character buffer for result and return it
+ *     2. find the next '<' from *pos; stop if none, or if urls is full
+ *     3. skip comments <!-- ... -->
+ *     4. scan the tag's name and attributes, through its closing '>'
+ *     5. if it is an <a> tag with an href, turn the href into a url
+ *     6. update *pos to the position after the tag
+ *
+ * Each character is looked at a bounded number of times, so a page is
+ * scanned in time linear in its length, however many tags it holds.
  */
-char* 
-webpage_getNextURL(webpage_t* page, int* pos)
+int
+webpage_getURLs(const webpage_t* page, int* pos, char** urls, const int max)
 {
-  // make sure we have text and base url, and valid arg
-  if (page == NULL || page->html == NULL || page->url == NULL || pos == NULL) {
-    return NULL;
-  }
-
-  char* html = page->html;                 // the html document
-  char* base_url = page->url;              // the base URL for this html
-  int bad_link;                            // is this link ill formatted?
-  int relative;                            // is this link relative?
-  char delim;                              // url delimiter: ' ', ''', '"'
-  char* lnk;                               // hyperlink tags
-  char* href;                              // href in a tag
-  char* end;                               // end of hyperlink tag or url
-  char* ptr;                               // absolute vs. relative
-  char* hash;                              // hash mark character
-
-  // condense html, makes parsing easier
-  if (*pos == 0) {
-    removeWhitespace(html);
+  // make sure we have text and base url, and valid args
+  if (page == NULL || page->html == NULL || page->url == NULL || pos == NULL
+      || urls == NULL || max <= 0) {
+    return 0;
   }
 
-  // parse for hyperlinks
-  do {
-    relative = 0;                        // assume absolute link
-    bad_link = 0;                        // assume valid link
-
-    // find tag "<a" or "<A""
-    lnk = strcasestr(&html[*pos], "<a");
-
-    // no more links on this page
-    if (!lnk) { return NULL; }
-
-    // find next href after hyperlink tag
-    href = strcasestr(lnk, "href=");
-
-    // no more links on this page
-    if (!href) { return NULL; }
-
-    // find end of hyperlink tag
-    end = strchr(lnk, '>');
-
-    // if the href we have is outside the current tag, continue
-    if (end && (end < href)) {
-      bad_link = 1; (*pos) += 2; continue;
-    }
-
-    // move href to beginning of url
-    href+=5;
-
-    // something went wrong, just continue
-    if (!href) { bad_link=1; (*pos) += 2; continue; }
-
-    // is the url quoted?
-    if (*href == '\'' || *href == '"') {  // yes, href="url" or href='url'
-      delim = *(href++);               // remember delimiter
-      end = strchr(href, delim);       // find next of same delimiter
-    } else {             // no, href=url
-      end = strchr(href, '>');         // hope: <a ... href=url>
-      // since we've stripped whitespace
-      // this could mangle things like:
-      // <a ... href=url name=val>
+  const char* html = page->html;           // the html document
+  const char* p = &html[*pos];             // where to look for a tag
+  int found = 0;                           // urls stored so far
+  const char* href;                        // href value in a tag
+  size_t hrefLen;                          // length of href value
+  char* url;                               // href, as an absolute url
+
+  while (found < max && (p = strchr(p, '<')) != NULL) {
+    if (strncmp(p, "<!--", 4) == 0) {      // comment; skip to its end
+      const char* end = strstr(p + 4, "-->");
+      p = end ? end + 3 : p + strlen(p);
+      continue;
     }
-
-    // if there is a # before the end of the url, exclude the #fragment
-    hash = strchr(href, '#');
-    if (hash && hash < end) {
-      end = hash;
-    }
-
-    // if we don't know where to end the url, continue
-    if (!end) {
-      bad_link = 1; (*pos) += 2; continue;
-    }
-
-    // have a link now
-    if (*href == '#') {                   // internal reference
-      bad_link = 1; (*pos) += 2; continue;
-    }
-
-    // is the url absolute, i.e, ':' must precede any '/', '?', or '#'
-    ptr = strpbrk(href, ":/?#");
-    if (!ptr || *ptr != ':') { 
-      relative = 1; 
-    } else if (strncasecmp(href, "http", 4)) { // absolute, but not http(s)
-      bad_link = 1; (*pos) += 2; continue;
-    }
-  } while (bad_link);                       // keep parsing
-
-  // update position after the end of the url
-  *pos = end - html;
-
-  // have a good link now
-  if (relative) {                           // need to fixup relative links
-    char* result = fixRelativeURL(base_url, href, end - href);
-    return result; // may be NULL if Fixup failed.
-  } else {
-    // create new buffer
-    char* result = calloc(end-href+1, sizeof(char));
-    if (result == NULL) {
-      // out of memory
-      return NULL;
-    } else {
-      // copy over absolute url
-      strncpy(result, href, end - href);
-      return result;
+    p = scanTag(p, &href, &hrefLen);
+    if (href != NULL && (url = hrefToURL(page->url, href, hrefLen)) != NULL) {
+      urls[found++] = url;
     }
   }
+
+  // update position after the last tag scanned
+  *pos = (p != NULL) ? p - html : *pos + strlen(&html[*pos]);
+  return found;
 }
 
 /******************** normalizeURL *******************************/
 /* Normalize the url according to RFC 3986 chapter 3.
  * see webpage.h for documentation.
  *
- * Pseudocode:
- *     1. check arguments
- *     2. try to parse url
- *     3. check any file extensions
- *     4. clear the url
- *     5. remove dot segments and lowercase scheme and host
- *     6. allocate space for the new url string
- *     7. assemble the new url from pieces
+ * The normalized url is never longer than url, so we build it with
+ * normalizeURLInto in a buffer of the same size.
  */
 char*
 normalizeURL(const char* url)
@@ -457,78 +651,124 @@ normalizeURL(const char* url)
     return NULL;
   }
 
-  // try to parse the url
-  struct URL tmp;               // pieces of the parsed url
-  if (!parseURL(url, &tmp)) {
-    freeURL(tmp);
+  // Allocate space for resulting URL - which will be no longer than url.
+  size_t size = strlen(url) + 1;
+  char* result = malloc(size);
+  if (result == NULL) {
     return NULL;
   }
+  if (!normalizeURLInto(url, result, size)) {
+    free(result);
+    return NULL;
+  }
+  return result;
+}
 
-  // check file extension
-  if (tmp.path != NULL) {               // if we have a path
-    char* dot = strrchr(tmp.path, '.');   // where is last '.' within string
-    char* slash = strrchr(tmp.path, '/'); // where is last '/' within string
-
-    // We expect to see URL of form /path/to/file.ext
-    if (dot != NULL && slash != NULL && dot > slash) {
-      char* ext = dot+1;                  // extension begins after '.'
-
-      // check against list of known extensions
-      if (strlen(ext) > 0) {
-        bool isKnownExt = false;      // is the extension valid?
-        for (int i = 0; EXTS[i] != NULL; i++) {
-          if (strncasecmp(ext, EXTS[i], strlen(EXTS[i])) == 0) {
-            isKnownExt = true;
-            break;
-          }
-        }
-
-        // no recognized extension found
-        if (!isKnownExt) {
-          freeURL(tmp);
-          return NULL;
-        }
-      }
-    }
+/******************** normalizeURLInto ***************************/
+/* see webpage.h for documentation.
+ *
+ * Pseudocode:
+ *     1. check arguments
+ *     2. find the end of the scheme, user info, host, and path
+ *     3. check any file extension
+ *     4. copy the scheme, user info, and host, lowercasing scheme and host
+ *     5. copy the path with . and .. segments removed
+ *     6. copy the query and fragment as they are
+ *
+ * The url is split much as parseURL would split it, an empty path
+ * included, but nothing is copied out of it until the result is
+ * assembled in buf, so there is nothing to allocate or free.
+ */
+bool
+normalizeURLInto(const char* url, char* buf, const size_t size)
+{
+  if (url == NULL || buf == NULL || size <= strlen(url)) {
+    return false;
   }
 
-  // Allocate space for resulting URL - which will be no longer than url.
-  char* result = malloc(strlen(url)+1);
-  if (result == NULL) {
-    freeURL(tmp);
-    return NULL;
+  const char* url_end = url + strlen(url); // end of url
+  const char* scheme_end;                  // scheme end point, : or ://
+  const char* user_end;                    // end of user info, after @
+  const char* host_beg;                    // beginning of host
+  const char* host_end;                    // end of host, / ? # or end
+  const char* path_end;                    // end of path, ? or # or end
+  char* out = buf;                         // where to write next
+
+  // make sure absolute url, i.e., ':' must precede any '/', '?', or '#'
+  scheme_end = strpbrk(url, ":/?#");
+  if (scheme_end == NULL || *scheme_end != ':') {
+    return false;
+  }
+  scheme_end++;                            // consume ':'
+  if (strncmp(scheme_end, "//", 2) == 0) { // have host
+    scheme_end += 2;                       // consume "//"
+  }
+
+  // user information, anything between scheme and first '@'
+  user_end = strpbrk(scheme_end, "@/");
+  if (user_end != NULL && *user_end == '@') {
+    user_end++;                            // consume '@'
+    host_beg = user_end;
   } else {
-    // initialize it to empty string
-    *result = '\0';
+    user_end = NULL;
+    host_beg = scheme_end;
   }
 
-  // put normalized url back together
-  if (tmp.scheme) {                         // scheme
-    strcat(result, tmp.scheme);
+  // host runs to the first '/', '?' or '#', and the path from there to
+  // '?' or '#'; with no '/' after the host the path is empty
+  host_end = strpbrk(host_beg, "/?#");
+  if (host_end == NULL) {
+    host_end = url_end;
   }
-  if (tmp.user) {                           // user
-    strcat(result, tmp.user);
+  path_end = strpbrk(host_end, "?#");
+  if (path_end == NULL) {
+    path_end = url_end;
   }
-  if (tmp.host) {                           // host
-    strcat(result, tmp.host);
+
+  // check file extension
+  const char* dot = NULL;                  // last '.' within path
+  const char* slash = NULL;                // last '/' within path
+  for (const char* ptr = host_end; ptr < path_end; ptr++) {
+    if (*ptr == '.') {
+      dot = ptr;
+    } else if (*ptr == '/') {
+      slash = ptr;
+    }
   }
-  if (tmp.path) {                           // path
-    // remove . and .. segments
-    char* path = removeDotSegments(tmp.path);
-    if (path == NULL) {
-      freeURL(tmp);
-      return NULL;
-    } else {
-      strcat(result, path);
-      free(path);
+  // We expect to see URL of form /path/to/file.ext
+  if (dot != NULL && slash != NULL && dot > slash && dot + 1 < path_end) {
+    const char* ext = dot + 1;             // extension begins after '.'
+    size_t ext_len = path_end - ext;
+    bool isKnownExt = false;               // is the extension valid?
+    for (int i = 0; EXTS[i] != NULL; i++) {
+      size_t len = strlen(EXTS[i]);
+      if (ext_len >= len && strncasecmp(ext, EXTS[i], len) == 0) {
+        isKnownExt = true;
+        break;
+      }
+    }
+    // no recognized extension found
+    if (!isKnownExt) {
+      return false;
     }
   }
-  if (tmp.query) {                          // query
-    strcat(result, tmp.query);
+
+  // put normalized url together: scheme and host lowercased
+  for (const char* ptr = url; ptr < scheme_end; ptr++) {
+    *out++ = tolower(*ptr);
   }
-  if (tmp.fragment) {                       // fragment
-    strcat(result, tmp.fragment);
+  if (user_end != NULL) {
+    memcpy(out, scheme_end, user_end - scheme_end);
+    out += user_end - scheme_end;
   }
+  for (const char* ptr = host_beg; ptr < host_end; ptr++) {
+    *out++ = tolower(*ptr);
+  }
+  out += removeDotSegments(host_end, path_end - host_end, out);
+  // query and fragment
+  memcpy(out, path_end, url_end - path_end);
+  out += url_end - path_end;
+  *out = '\0';
 
 #ifdef REMOVE_SLASH
   // Remove trailing slash [DFK 2017].
@@ -537,16 +777,12 @@ normalizeURL(const char* url)
   // but doing so actually prevents the crawler from following the 
   // server's implicit redirect to http://www.cs.dartmouth.edu/index.html
   // So, I've decided not to include it.
-  if (*result != '\0') {
-    char* last = result + strlen(result) - 1;
-    if (*last == '/'){
-      *last = '\0';
-    }
+  if (out > buf && out[-1] == '/') {
+    out[-1] = '\0';
   }
 #endif // REMOVE_SLASH
 
-  freeURL(tmp);
-  return result;
+  return true;
 }
 
 /***********************************************************************
@@ -562,6 +798,26 @@ isInternalURL(const char* url)
   }
 }
 
+/***********************************************************************
+ * mayBeInternalURL - see webpage.h for interface description.
+ *
+ * Normalizing lowercases the scheme and host and changes nothing else
+ * before the path, so a url can only normalize to an internal one if it
+ * begins with INTERNAL_PREFIX's scheme and host, "http://host/", in any
+ * case; its path may still change, e.g., "/./tse/" becomes "/tse/".
+ */
+bool
+mayBeInternalURL(const char* url)
+{
+  if (url == NULL) {
+    return false;
+  }
+  // INTERNAL_PREFIX up to and including the '/' after its host
+  const char* path = strchr(INTERNAL_PREFIX + strlen("http://"), '/');
+  size_t len = path - INTERNAL_PREFIX + 1;
+  return strncasecmp(url, INTERNAL_PREFIX, len) == 0;
+}
+
 
 /***********************************************************************
  * INTERNAL FUNCTIONS
@@ -779,117 +1035,231 @@ printURL(struct URL url)
 }
 #endif // DEBUG
 
-/* ****************** burstURL ********************* */
-/* Burst the URL into components (hostname, port, pathname).
+/* ********************* connectToHost ************************** */
+/* Connect to the given hostname and port, 
+ * returning an open, non-blocking socket,
+ * or -1 on failure, setting *timedOut if the connection did not open
+ * within the connect or total deadline of an attempt begun at start.
  *
- * Input: URL, assumed non-NULL and already normalized.
- * 
- * Output: fill in the other parameters:
- *   a pointer to new string containing the hostname
- *   an integer representing the port
- *   a pointer to new string containing the pathname.
- * and
- *   return true if successful. 
- * 
- * If success, the hostname and pathname must be free'd later.
- * Each string is allocated enough space to hold the whole URL, 
- * which is more than necessary, allowing a little growth if needed.
- * 
- * burstURL is much simpler than parseURL and is used by 
- * webpage_fetch because it can't handle anything other than simple
- * http://hostname[:port][/path] forms of URL anyway.
+ * The hostname is looked up through the dnscache, which is safe to use
+ * from several crawler threads and skips the resolver for hosts seen
+ * recently.
  */
-static bool
-burstURL(const char* url, char** hostname, int* port, char** pathname)
+static int
+connectToHost(const char* hostname, const int port, const long start,
+              bool* timedOut)
 {
-  // make plenty of space for the resulting strings
-  int length = strlen(url);
-
-  // initialize hostname to empty string
-  *hostname = calloc(sizeof(char), length); // initialized to all nulls
-  if (*hostname == NULL) {
-    return false;
+  // Look up the hostname specified on command line
+  struct sockaddr_in server;  // address of the server
+  if (!dnscache_resolve(hostname, port, &server)) {
+    return -1;
   }
 
-  // initialize pathname to slash
-  *pathname = calloc(sizeof(char), length); // initialized to all nulls
-  if (*pathname == NULL) {
-    free(*hostname);
-    return false;
-  } else {
-    **pathname = '/';
+  // Create socket (a file descriptor)
+  int comm_sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (comm_sock < 0) {
+    return -1;
   }
 
-  // initialize port to default port
-  *port = HTTP_PORT;
-
-  // parse various forms of the URL
-  if (sscanf(url, "http://%[^:]:%d/%s", *hostname, port, *pathname+1) == 3) {
-    return true;
-  } else if (sscanf(url, "http://%[^/]/%s", *hostname, *pathname+1) == 2) {
-    return true;
-  } else if (sscanf(url, "http://%[^:]:%d", *hostname, port) == 2) {
-    return true;
-  } else if (sscanf(url, "http://%[^/]/", *hostname) == 1) {
-    return true;
-  } else if (sscanf(url, "http://%s", *hostname) == 1) {
-    return true;
-  } else {
-    free(*hostname); *hostname = NULL;
-    free(*pathname); *pathname = NULL;
-    return false;
+  // And connect that socket to that server, waiting no longer than the
+  // deadlines allow for it to open
+  long deadline = deadline_earlier(
+      connectMillis > 0 ? start + connectMillis : -1,
+      totalMillis > 0 ? start + totalMillis : -1);
+  int err = 0;
+  socklen_t errLen = sizeof(err);
+  if ((connect(comm_sock, (struct sockaddr *) &server, sizeof(server)) < 0
+       && errno != EINPROGRESS)
+      || !waitFor(comm_sock, POLLOUT, deadline, timedOut)
+      || getsockopt(comm_sock, SOL_SOCKET, SO_ERROR, &err, &errLen) < 0
+      || err != 0) {
+    close(comm_sock);
+    return -1;
   }
-}
 
+  return comm_sock;
+}
 
-/* ********************* connectToHost ************************** */
-/* Connect to the given hostname and port, 
- * returning an open FILE* for the socket,
- * or NULL on failure.
+/* ********************* exchange ************************** */
+/* Send the request on the connected, non-blocking socket, then read the
+ * response into resp, in blocks, until it is complete.
+ *
+ * Returns HTTP_DONE if a complete response was read, HTTP_ERROR if the
+ * request could not be sent or the response was cut short or malformed,
+ * or, setting *timedOut, if the first byte of the response or the last,
+ * did not arrive within the deadlines of an attempt begun at start.
+ * The socket is left open either way.
  */
-static FILE* 
-connectToHost(const char* hostname, const int port)
+static http_result_t
+exchange(const int comm_sock, const char* request, const size_t requestLen,
+         http_response_t* resp, const long start, bool* timedOut)
 {
-  // Look up the hostname specified on command line
-  struct hostent *hostp = gethostbyname(hostname);
-  if (hostp == NULL) {
-    return NULL;
+  long totalDeadline = totalMillis > 0 ? start + totalMillis : -1;
+
+  // send the whole request
+  for (size_t sent = 0; sent < requestLen; ) {
+    ssize_t n = send(comm_sock, &request[sent], requestLen - sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if ((errno != EAGAIN && errno != EWOULDBLOCK)
+          || !waitFor(comm_sock, POLLOUT, totalDeadline, timedOut)) {
+        return HTTP_ERROR;
+      }
+      continue;
+    }
+    sent += n;
   }
 
-  // Initialize fields of the server address
-  struct sockaddr_in server;  // address of the server
-  server.sin_family = AF_INET;
-  bcopy(hostp->h_addr_list[0], &server.sin_addr, hostp->h_length);
-  server.sin_port = htons(port);
+  // until the first byte arrives, the first-byte deadline applies too
+  long deadline = deadline_earlier(
+      totalDeadline,
+      firstByteMillis > 0 ? deadline_now() + firstByteMillis : -1);
+
+  // read the server's response; once into the body, read straight
+  // into the body's buffer rather than copying out of buf
+  char buf[READ_SIZE];
+  http_result_t result = HTTP_MORE;
+  while (result == HTTP_MORE) {
+    char* space;
+    size_t room = http_response_bodySpace(resp, &space);
+    ssize_t n = room > 0 ? read(comm_sock, space, room)
+                         : read(comm_sock, buf, sizeof(buf));
+    if (n > 0) {
+      result = room > 0 ? http_response_bodyFilled(resp, n)
+                        : http_response_feed(resp, buf, n);
+      deadline = totalDeadline;
+    } else if (n == 0) {
+      result = http_response_eof(resp);
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      if (!waitFor(comm_sock, POLLIN, deadline, timedOut)) {
+        result = HTTP_ERROR;
+      }
+    } else if (errno != EINTR) {
+      result = HTTP_ERROR;
+    }
+  }
+  return result;
+}
 
-  // Create socket (a file descriptor)
-  int comm_sock = socket(AF_INET, SOCK_STREAM, 0);
-  if (comm_sock < 0) {
-    return NULL;
+/* ********************* takeResponse ************************** */
+/* Take what a complete response says about the page: its html, if the
+ * status is 200 and the body was not skipped, or that it has not
+ * changed, if 304. Either way the page's validators become those of the
+ * copy we have now.
+ *
+ * Returns true if the fetch succeeded.
+ */
+static bool
+takeResponse(webpage_t* page, http_response_t* resp)
+{
+  int status = http_response_status(resp);
+  page->status = status;
+  const char* etag = http_response_etag(resp);
+  const char* lastModified = http_response_lastModified(resp);
+  if (status == 200 && !http_response_skipped(resp)) {
+    page->html = http_response_takeBody(resp, &page->html_len);
+    return (page->html != NULL)
+      && webpage_setValidators(page, etag, lastModified);
   }
+  if (status == 304 && webpage_setNotModified(page)) {
+    if (etag != NULL || lastModified != NULL) {
+      webpage_setValidators(page, etag, lastModified);
+    }
+    return true;
+  }
+  return false;
+}
 
-  // And connect that socket to that server   
-  if (connect(comm_sock, (struct sockaddr *) &server, sizeof(server)) < 0) {
-    return NULL;
+/* ********************* replayFetch ************************** */
+/* Fetch the page from the archive being replayed, as webpage_fetch
+ * would from the server. A page with validators is fetched
+ * conditionally here too: if the copy recorded still has the same
+ * ETag, or failing that the same Last-Modified, it has not changed.
+ *
+ * Returns true if the fetch succeeded; a page never recorded fails.
+ */
+static bool
+replayFetch(webpage_t* page)
+{
+  http_response_t* resp = http_response_new();
+  if (resp == NULL) {
+    return false;
   }
+  http_response_limit(resp, maxBodyBytes, true);
+  bool success = false;
+  if (archive_replay(replaying, page->url, resp) == HTTP_DONE) {
+    const char* etag = http_response_etag(resp);
+    const char* lastModified = http_response_lastModified(resp);
+    bool unchanged = (page->etag != NULL && etag != NULL)
+                     ? strcmp(page->etag, etag) == 0
+                     : (page->lastModified != NULL && lastModified != NULL
+                        && strcmp(page->lastModified, lastModified) == 0);
+    if (http_response_status(resp) == 200 && unchanged) {
+      success = webpage_setNotModified(page);
+      page->status = 304;
+    } else {
+      success = takeResponse(page, resp);
+    }
+  }
+  http_response_delete(resp);
+  return success;
+}
 
-  // to make it easier to work with, switch to stdio
-  FILE* http_fp = fdopen(comm_sock, "r+");
-  if (http_fp == NULL) {
-    return NULL;
+/* ********************* waitFor ************************** */
+/* Wait until the socket is ready for events (POLLIN or POLLOUT), or
+ * until deadline, by deadline_now(); -1 means no deadline.
+ *
+ * Returns true once ready (or in error, which the caller's next call on
+ * the socket reports), false if poll fails or, setting *timedOut, if the
+ * deadline passes first.
+ */
+static bool
+waitFor(const int fd, const short events, const long deadline,
+        bool* timedOut)
+{
+  struct pollfd pfd = { .fd = fd, .events = events };
+  while (true) {
+    int timeout = -1;
+    if (deadline >= 0) {
+      long left = deadline - deadline_now();
+      timeout = left > 0 ? left : 0;
+    }
+    int rc = poll(&pfd, 1, timeout);
+    if (rc > 0) {
+      return true;
+    }
+    if (rc == 0) {
+      *timedOut = true;
+      return false;
+    }
+    if (errno != EINTR) {
+      return false;
+    }
   }
+}
 
-  return http_fp;
+/* ********************* poolInit ************************** */
+/* Create the pool of kept-alive connections; run once, by pthread_once.
+ */
+static void
+poolInit(void)
+{
+  pool = connpool_new(POOL_PER_HOST, POOL_IDLE_SECS);
 }
 
 
 /* ***************************************************************** */
 /*
  * removeDotSegments - removes . and .. segments from url paths
- * @input: the character buffer to cleanse
+ * @input: the path to cleanse (need not be '\0'-terminated)
+ * @in_len: length of the path
+ * @out: where to write the result, with room for in_len characters
  *
- * Returns a newly allocated character buffer with . and .. segments removed
- * according to the algorithm in RFC 3986 section 5.2.4 "Remove Dot Segments".
+ * Writes the path with . and .. segments removed according to the
+ * algorithm in RFC 3986 section 5.2.4 "Remove Dot Segments", without a
+ * terminating '\0', and returns its length (never more than in_len).
  * See: http://www.ietf.org/rfc/rfc1738.txt
  *
  * Should have no use outside of this file, thus declared static.
@@ -916,58 +1286,39 @@ connectToHost(const char* hostname, const int port)
  * be used in advertising or otherwise to promote the sale, use or other dealings
  * in this Software without prior written authorization of the copyright holder.
  */
-static char* 
-removeDotSegments(char* input)
+static size_t
+removeDotSegments(const char* input, const size_t in_len, char* out)
 {
-  size_t in_len;                           // input length
-  size_t copy_len;                         // copy length
-  char* copy;                              // copy of input that is modified
-  char* copyptr;                           // handle for free'ing copy'
-  char* out;                               // output buffer
-  char* outptr;                            // pointer to current write point
-
-  if (!input || strlen(input) < 1)
-    return NULL;
-
-  // save lengths
-  in_len = copy_len = strlen(input);
+  const char* in = input;                  // rest of the input buffer
+  const char* in_end = input + in_len;     // end of the input buffer
+  char* outptr = out;                      // pointer to current write point
 
-  // create output buffer
-  out = outptr = calloc(in_len + 1, sizeof(char));
-  if (!out)
-    return NULL; /* out of memory */
-
-  // copy the input buffer
-  copy = copyptr = strdup(input);
-  if (!copy) {
-    free(out);
-    return NULL;
-  }
+  if (in_len < 1)
+    return 0;
 
   // 2.  While the input buffer is not empty, loop as follows:
   do {
+    size_t left = in_end - in;             // length of the input buffer
+
     // A. If the input buffer begins with a prefix of "../" or "./",
     //    then remove that prefix from the input buffer; otherwise,
-    if (!strncmp("./", copy, 2)) {
-      copy += 2;
-      copy_len -= 2;
+    if (left >= 2 && !strncmp("./", in, 2)) {
+      in += 2;
     }
-    else if (!strncmp("../", copy, 3)) {
-      copy += 3;
-      copy_len -= 3;
+    else if (left >= 3 && !strncmp("../", in, 3)) {
+      in += 3;
     }
 
     // B. if the input buffer begins with a prefix of "/./" or "/.",
     //    where "." is a complete path segment, then replace that
     //    prefix with "/" in the input buffer; otherwise,
-    else if (!strncmp("/./", copy, 3)) {
-      copy += 2;
-      copy_len -= 2;
+    else if (left >= 3 && !strncmp("/./", in, 3)) {
+      in += 2;
     }
-    else if (!strcmp("/.", copy)) {
-      copy[1] = '/';
-      copy++;
-      copy_len -= 1;
+    else if (left == 2 && !strncmp("/.", in, 2)) {
+      // the input buffer is now "/", which E moves to the output
+      *outptr++ = '/';
+      in = in_end;
     }
 
     // C. if the input buffer begins with a prefix of "/../" or "/..",
@@ -975,9 +1326,8 @@ removeDotSegments(char* input)
     //    prefix with "/" in the input buffer and remove the last
     //    segment and its preceding "/" (if any) from the output
     //    buffer; otherwise,
-    else if (!strncmp("/../", copy, 4)) {
-      copy += 3;
-      copy_len -= 3;
+    else if (left >= 4 && !strncmp("/../", in, 4)) {
+      in += 3;
 
       // remove the last segment
       while (outptr > out) {
@@ -985,26 +1335,25 @@ removeDotSegments(char* input)
         if (*outptr == '/')
           break;
       }
-      *outptr = 0;
     }
-    else if (!strcmp("/..", copy)) {
-      copy[2] = '/';
-      copy += 2;
-      copy_len -= 2;
-
+    else if (left == 3 && !strncmp("/..", in, 3)) {
       // remove the last segment
       while (outptr > out) {
         outptr--;
         if (*outptr == '/')
           break;
       }
-      *outptr = 0;
+
+      // the input buffer is now "/", which E moves to the output
+      *outptr++ = '/';
+      in = in_end;
     }
 
     // D. if the input buffer consists only of "." or "..", then remove
     //    that from the input buffer; otherwise, */
-    else if (!strcmp(".", copy) || !strcmp("..", copy)) {
-      *copy = 0;
+    else if ((left == 1 && *in == '.')
+             || (left == 2 && !strncmp("..", in, 2))) {
+      in = in_end;
     }
 
     // E. move the first path segment in the input buffer to the end of
@@ -1013,17 +1362,12 @@ removeDotSegments(char* input)
     //    the next "/" character or the end of the input buffer. */
     else {
       do {
-        *outptr++ = *copy++;
-        copy_len--;
-      } while (*copy && (*copy != '/'));
-      *outptr = '\0';
+        *outptr++ = *in++;
+      } while (in < in_end && (*in != '/'));
     }
-  } while (*copy != '\0');    // keep going
-
-  // cleanup copy
-  free(copyptr);
+  } while (in < in_end);    // keep going
 
-  return out;
+  return outptr - out;
 }
 
 /* ***************************************************************** */
@@ -1117,40 +1461,153 @@ fixRelativeURL(char* base, char* rel, size_t len)
 
 /* ***************************************************************** */
 /*
- * removeWhitespace - removes whitespace from str
- * @str: char buffer to modify
+ * scanTag - scans the tag starting at tag, which points to a '<'
+ * @tag: start of the tag
+ * @href: where to store the start of its href value, or NULL if it is
+ *        not an <a> tag with an href
+ * @hrefLen: where to store the length of the href value
  *
- * Eliminates whitespace by shifting and condensing all the non-whitespace
- * toward the beginning of the buffer. This does not alter the size of the
- * buffer.
+ * Attribute values are either quoted, and may then hold '>' or
+ * whitespace, or unquoted, and end at whitespace or '>'. The first href
+ * counts, as in a browser.
  *
- * Should have no use outside of this file, thus declared static.
+ * Returns the position after the tag's closing '>' (or the end of the
+ * html, if the tag is never closed); if tag is not followed by a letter
+ * it is not a start tag, and we return the position just after the '<'.
  */
-static void
-removeWhitespace(char* str)
+static const char*
+scanTag(const char* tag, const char** href, size_t* hrefLen)
 {
-  char* prev;                              // previous whitespace
-  char* cur;                               // current non-whitespace
+  const char* p = tag + 1;                 // current position
+  const char* name;                        // attribute name
+  size_t nameLen;                          // attribute name length
 
-  // start at beginning of str
-  cur = prev = str;
+  *href = NULL;
+  *hrefLen = 0;
 
-  do {
-    while (isspace(*cur)) cur++;           // consume any whitespace
-  } while ((*prev++ = *cur++));            // condense to front of str
+  if (*p == '/' || *p == '!' || *p == '?') {   // end tag, doctype, etc.
+    const char* end = strchr(p, '>');
+    return end ? end + 1 : p + strlen(p);
+  }
+  if (!isalpha((unsigned char)*p)) {       // a lone '<' in the text
+    return p;
+  }
+
+  // tag name
+  name = p;
+  while (isalnum((unsigned char)*p)) {
+    p++;
+  }
+  bool anchor = (p - name == 1 && tolower((unsigned char)*name) == 'a');
+
+  // attributes: name, or name=value, separated by whitespace or '/'
+  for (;;) {
+    while (isspace((unsigned char)*p) || *p == '/') {
+      p++;
+    }
+    if (*p == '\0') {                      // tag never closed
+      return p;
+    }
+    if (*p == '>') {                       // end of tag
+      return p + 1;
+    }
+
+    name = p;
+    while (*p != '\0' && *p != '=' && *p != '>' && *p != '/'
+           && !isspace((unsigned char)*p)) {
+      p++;
+    }
+    nameLen = p - name;
+    if (nameLen == 0) {                    // stray '='; skip it
+      p++;
+      continue;
+    }
+    while (isspace((unsigned char)*p)) {
+      p++;
+    }
+    if (*p != '=') {                       // attribute without a value
+      continue;
+    }
+    p++;
+    while (isspace((unsigned char)*p)) {
+      p++;
+    }
+
+    // value
+    const char* value;
+    size_t valueLen;
+    if (*p == '"' || *p == '\'') {         // quoted
+      char delim = *p++;
+      value = p;
+      const char* end = strchr(p, delim);
+      if (end == NULL) {                   // quote never closed
+        return p + strlen(p);
+      }
+      valueLen = end - value;
+      p = end + 1;
+    } else {                               // unquoted
+      value = p;
+      while (*p != '\0' && *p != '>' && !isspace((unsigned char)*p)) {
+        p++;
+      }
+      valueLen = p - value;
+    }
+
+    if (anchor && *href == NULL && nameLen == 4
+        && strncasecmp(name, "href", 4) == 0) {
+      *href = value;
+      *hrefLen = valueLen;
+    }
+  }
 }
 
-/* **************** isBlankLine ******************/
-/* Input: line, a non-NULL pointer to a string.
- * Return true if the string is pointing to a blank line, that is, 
- * an empty string, or
- * with only newline (LF), only carriage return (CR), or only CRLF.
+/* ***************************************************************** */
+/*
+ * hrefToURL - makes an absolute url from an href value
+ * @base: url of the page holding the href
+ * @href: the href value (not '\0'-terminated)
+ * @len: length of the href value
+ *
+ * Whitespace is removed, and anything from a '#' on; an href that is
+ * then empty, or absolute with a scheme other than http(s), is skipped.
+ *
+ * Returns a newly allocated absolute url, or NULL if the href is skipped
+ * or on memory allocation failure.
  */
-static inline bool
-isBlankLine(const char* line)
+static char*
+hrefToURL(char* base, const char* href, const size_t len)
 {
-  return (   (line[0] == '\0')
-             || (strcmp(line, "\n") == 0) 
-             || (strcmp(line, "\r") == 0) 
-             || (strcmp(line, "\r\n") == 0));
+  // copy href without whitespace, up to any #fragment
+  char* rel = malloc(len + 1);
+  if (rel == NULL) {
+    return NULL;
+  }
+  size_t relLen = 0;
+  for (size_t i = 0; i < len && href[i] != '#'; i++) {
+    if (!isspace((unsigned char)href[i])) {
+      rel[relLen++] = href[i];
+    }
+  }
+  rel[relLen] = '\0';
+
+  // nothing left: an empty link, or an internal reference
+  if (relLen == 0) {
+    free(rel);
+    return NULL;
+  }
+
+  // is the url absolute, i.e, ':' must precede any '/', '?', or '#'
+  char* ptr = strpbrk(rel, ":/?");
+  if (ptr != NULL && *ptr == ':') {
+    if (strncasecmp(rel, "http", 4) != 0) {   // absolute, but not http(s)
+      free(rel);
+      return NULL;
+    }
+    return rel;
+  }
+
+  // relative; fix it up against the base
+  char* url = fixRelativeURL(base, rel, relLen);
+  free(rel);
+  return url;       // may be NULL if Fixup failed.
 }
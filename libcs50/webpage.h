@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "archive.h"
 
 /***********************************************************************/
 /* webpage_t: opaque struct to represent a web page, and its contents.
@@ -37,6 +38,10 @@ typedef struct webpage webpage_t;
 int   webpage_getDepth(const webpage_t* page);
 char* webpage_getURL(const webpage_t* page);
 char* webpage_getHTML(const webpage_t* page);
+const char* webpage_getETag(const webpage_t* page);         // NULL if none
+const char* webpage_getLastModified(const webpage_t* page); // NULL if none
+bool  webpage_isNotModified(const webpage_t* page);
+int   webpage_getStatus(const webpage_t* page);   // 0 if no response
 
 /**************** webpage_new ****************/
 /* Allocate and initialize a new webpage_t structure.
@@ -62,6 +67,60 @@ char* webpage_getHTML(const webpage_t* page);
  */
 webpage_t* webpage_new(char* url, const int depth, char* html);
 
+/**************** webpage_setHTML ****************/
+/* Store html fetched for a page by code outside this module,
+ * such as the event-driven fetcher.
+ *
+ * Caller provides:
+ *   page, a valid webpage_t* whose html is still NULL;
+ *   html, a null-terminated string in malloc'd memory;
+ *   html_len, the length of html.
+ *
+ * We return:
+ *   true if the html was stored; false if any argument is invalid
+ *   or the page already has html.
+ *
+ * IMPORTANT:
+ *   on success the page adopts html, which webpage_delete will free.
+ */
+bool webpage_setHTML(webpage_t* page, char* html, const size_t html_len);
+
+/**************** webpage_setValidators ****************/
+/* Set the page's validators: the ETag and Last-Modified headers that
+ * came with a copy of it fetched earlier. webpage_fetch then asks for
+ * the page only if it has changed since that copy.
+ *
+ * Caller provides:
+ *   page, a valid webpage_t*;
+ *   etag and lastModified, either of which may be NULL for none.
+ *
+ * We return:
+ *   true if the validators were stored (as copies); false if page is
+ *   NULL or we are out of memory, leaving them as they were.
+ */
+bool webpage_setValidators(webpage_t* page, const char* etag,
+                           const char* lastModified);
+
+/**************** webpage_setNotModified ****************/
+/* Record that a conditional fetch of the page, by code outside this
+ * module such as the event-driven fetcher, found it unchanged (304).
+ *
+ * We return:
+ *   true if recorded; false if page is NULL, has html, or has no
+ *   validators (and so could not have been fetched conditionally).
+ */
+bool webpage_setNotModified(webpage_t* page);
+
+/**************** webpage_setStatus ****************/
+/* Record the HTTP status of the response to a fetch of the page by code
+ * outside this module, such as the event-driven fetcher; 0 if no whole
+ * response was received, as when the connection failed or timed out.
+ * webpage_getStatus returns it until the page is fetched again, so a
+ * caller can tell a failed fetch the server answered, such as a 404 or a
+ * page that is not HTML, from one it did not, or answered with a 5xx.
+ */
+void webpage_setStatus(webpage_t* page, const int status);
+
 /**************** webpage_delete ****************/
 /* Delete a webpage_t structure created by webpage_new().
  *
@@ -84,7 +143,15 @@ void webpage_delete(void* data);
  *
  * We return:
  *   true if the fetch was successful; otherwise, false;
- *   if the fetch succeeded, page->html will contain the content retrieved.
+ *   if the fetch succeeded, page->html will contain the content retrieved,
+ *   and the page's validators those sent with it (NULL if none).
+ *
+ * If the page has validators (see webpage_setValidators), the fetch is
+ * conditional: if the server says the page has not changed since, we
+ * return true with page->html still NULL, and webpage_isNotModified
+ * returns true until the page is fetched again. Whether or not the
+ * fetch succeeds, webpage_getStatus then returns the status of the
+ * response received, or 0 if none was.
  *
  * Caller is responsible for:
  *   If this function is successful, a new, null-terminated character
@@ -99,6 +166,21 @@ void webpage_delete(void* data);
  *  }
  *  webpage_delete(page);
  *
+ * Connections are kept alive and reused for later fetches from the same
+ * host and port; webpage_fetch may be called from several threads at once.
+ *
+ * webpage_fetch does not pause between fetches; a caller fetching many
+ * pages from one server must space its requests out itself (the crawler
+ * waits at least one second per host by default).
+ *
+ * Each attempt is bounded by the deadlines set with webpage_setTimeouts;
+ * an attempt that runs past one is abandoned and counts as failed.
+ *
+ * Only HTML is fetched: a page whose Content-Type says it is something
+ * else fails as soon as its headers arrive, without its body being
+ * read. A page longer than the limit set with webpage_setMaxBody is cut
+ * off there, and page->html holds only that much of it.
+ *
  * Limitations:
  *   * can only handle http (not https or other schemes)
  *   * can only handle URLs of form http://host[:port][/pathname]
@@ -106,6 +188,96 @@ void webpage_delete(void* data);
  */
 bool webpage_fetch(webpage_t* page);
 
+/***************** webpage_setTimeouts ******************************/
+/* Set the deadlines, in milliseconds, on each attempt to fetch a page,
+ * by webpage_fetch or the event-driven fetcher:
+ *   connectMillis, for the connection to open (default 5000);
+ *   firstByteMillis, from sending the request to the first byte of the
+ *     response (default 10000);
+ *   totalMillis, from the start of the attempt to the last byte of the
+ *     response (default 30000).
+ * 0 means no deadline; negative values are ignored. Call before fetching.
+ *
+ * An attempt that misses a deadline counts as failed, like a refused
+ * connection, and the page is tried again if any of its attempts are
+ * left; so no fetch takes much longer than three times the larger of
+ * connectMillis and totalMillis, however slowly a server answers.
+ */
+void webpage_setTimeouts(const int connectMillis, const int firstByteMillis,
+                         const int totalMillis);
+
+/***************** webpage_getTimeouts ******************************/
+/* Get the deadlines set by webpage_setTimeouts, for fetching code
+ * outside this module; any pointer may be NULL.
+ */
+void webpage_getTimeouts(int* connectMillis_p, int* firstByteMillis_p,
+                         int* totalMillis_p);
+
+/***************** webpage_setMaxBody ******************************/
+/* Set the most bytes of a page's html that webpage_fetch or the
+ * event-driven fetcher keeps, or 0 for no limit (the default). The rest
+ * of a longer page is never read. Call before fetching.
+ */
+void webpage_setMaxBody(const size_t maxBytes);
+
+/***************** webpage_getMaxBody ******************************/
+/* Get the limit set by webpage_setMaxBody, for fetching code outside
+ * this module.
+ */
+size_t webpage_getMaxBody(void);
+
+/***************** webpage_record ******************************/
+/* Record every response webpage_fetch or the event-driven fetcher
+ * receives, other than 304 Not Modified, in the archive at archivePath
+ * (see archive.h), after any records already there. Call before
+ * fetching; webpage_fetchCleanup closes the archive and indexes it.
+ *
+ * We return:
+ *   false if the archive cannot be opened, or one is already being
+ *   recorded or replayed.
+ */
+bool webpage_record(const char* archivePath);
+
+/***************** webpage_replay ******************************/
+/* Fetch every page from the archive at archivePath (see archive.h)
+ * instead of the network, as it was recorded: a page never recorded
+ * fails to fetch, and one whose recorded copy has the validators a
+ * conditional fetch asks about is not modified. No connection is ever
+ * opened, and the deadlines of webpage_setTimeouts do not apply; the
+ * limit of webpage_setMaxBody, and to HTML, do. Call before fetching.
+ *
+ * We return:
+ *   false if the archive cannot be read or indexed, or one is already
+ *   being recorded or replayed.
+ */
+bool webpage_replay(const char* archivePath);
+
+/***************** webpage_getRecording ******************************/
+/* Get the archive opened by webpage_record, or NULL if none, for
+ * fetching code outside this module to record its responses in.
+ */
+archive_t* webpage_getRecording(void);
+
+/***************** webpage_isReplaying ******************************/
+/* Return true if pages are fetched from an archive (webpage_replay);
+ * fetching code outside this module should then fetch each with
+ * webpage_fetch, which returns without waiting on the network.
+ */
+bool webpage_isReplaying(void);
+
+/***************** webpage_fetchCleanup ******************************/
+/* Close the idle connections webpage_fetch keeps for reuse, forget
+ * cached hostname lookups, and close any archive being recorded or
+ * replayed, indexing one recorded.
+ *
+ * Call once no more fetches are in progress, e.g., at the end of a crawl;
+ * webpage_fetch must not be called afterward.
+ *
+ * We return:
+ *   false if an archive recorded could not be written completely.
+ */
+bool webpage_fetchCleanup(void);
+
 
 /**************** webpage_getNextWord ***********************************/
 /* return the next word from page->html[pos]
@@ -144,17 +316,17 @@ char* webpage_getNextWord(webpage_t* page, int* pos);
  *   page: pointer to valid webpage_t with page->html not NULL.
  *   pos: pointer to an int representing current position in html buffer;
  *        should be 0 on the initial call.
- *        After return, *pos is the index after the URL returned.
+ *        After return, *pos is the index after the tag holding the URL.
  *
  * We return:
  *   pointer to string containing the next URL, if any; otherwise NULL.
  *
- * Side effect:
- *   page->html will be compressed to remove white space.
- *
  * Caller is responsible for:
  *   later free()ing the string returned.
  *
+ * Notes:
+ *   same as webpage_getURLs with max 1; use that to take many at once.
+ *
  * Known bugs:
  *   Does not work well on directory-type URLs like
  *      http://cs50tse.cs.dartmouth.edu/tse/letters
@@ -173,6 +345,47 @@ char* webpage_getNextWord(webpage_t* page, int* pos);
 
 char* webpage_getNextURL(webpage_t* page, int* pos);
 
+/****************** webpage_getURLs **************************************/
+/* return the next batch of urls from page->html[pos]
+ *
+ * Caller provides:
+ *   page: pointer to valid webpage_t with page->html not NULL.
+ *   pos: pointer to an int representing current position in html buffer;
+ *        should be 0 on the initial call.
+ *        After return, *pos is the index after the last tag scanned.
+ *   urls: array with room for max strings.
+ *   max: most urls to return (> 0).
+ *
+ * We return:
+ *   the number of urls stored in urls[0..n), up to max; 0 once the page
+ *   has no more.
+ *
+ * Caller is responsible for:
+ *   later free()ing each string returned.
+ *
+ * Notes:
+ *   The html is scanned once, tag by tag, and never modified. Each url
+ *   is the href attribute of an <a> tag, quoted or not, with any
+ *   whitespace and #fragment removed; relative urls are made absolute
+ *   against page->url. Comments are skipped, as are hrefs that are
+ *   empty, only a #fragment, or absolute with a scheme other than http.
+ *
+ * Usage example: (retrieve all urls in a page)
+ * int pos = 0;
+ * char* urls[32];
+ * int n;
+ *
+ * while ((n = webpage_getURLs(page, &pos, urls, 32)) > 0) {
+ *     for (int i = 0; i < n; i++) {
+ *         printf("Found url: %s\n", urls[i]);
+ *         free(urls[i]);
+ *     }
+ * }
+ */
+
+int webpage_getURLs(const webpage_t* page, int* pos, char** urls,
+                    const int max);
+
 /***********************************************************************
  * normalizeURL - returns a normalized form of the url
  *
@@ -195,6 +408,27 @@ char* webpage_getNextURL(webpage_t* page, int* pos);
  */
 char* normalizeURL(const char* url);
 
+/***********************************************************************
+ * normalizeURLInto - writes a normalized form of the url into buf
+ *
+ * Caller provides:
+ *    url: string containing absolute url to normalize
+ *    buf: where to write the normalized url
+ *    size: size of buf, at least strlen(url) + 1
+ *
+ * Returns:
+ *  true if buf holds the normalized url, which is what normalizeURL
+ *  would return, or
+ *  false if url or buf is NULL, or size is too small, or
+ *  false if the url can't be parsed or normalized, or
+ *  false if the url refers to a file unlikely to contain html.
+ *
+ * Notes:
+ *  allocates no memory; with buf on the stack, normalizing a url that
+ *  is then thrown away costs no malloc or free.
+ */
+bool normalizeURLInto(const char* url, char* buf, const size_t size);
+
 
 /***********************************************************************
  * isInternalURL - verify whether the given url is 'internal' to CS50
@@ -210,6 +444,20 @@ char* normalizeURL(const char* url);
  */
 bool isInternalURL(const char* url);
 
+/***********************************************************************
+ * mayBeInternalURL - cheaply rule out urls that can't be 'internal'
+ *
+ * Caller provides:
+ *   url: string containing an absolute url, not yet normalized
+ *
+ * Returns:
+ *   false if the url, once normalized, can't be internal, because its
+ *   scheme and host (in any case) are not those of INTERNAL_PREFIX;
+ *   true otherwise, in which case it still needs normalizeURL and
+ *   isInternalURL to tell.
+ */
+bool mayBeInternalURL(const char* url);
+
 // All normalized URLs beginning with this prefix are considered "internal"
 static const
 char INTERNAL_PREFIX[] = "http://cs50tse.cs.dartmouth.edu/tse/";
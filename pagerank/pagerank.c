@@ -0,0 +1,392 @@
+/*
+ * pagerank.c    Hugo Fang    3/6/2024
+ *
+ * Reads the link graph a `crawler --links` wrote to a page directory,
+ * and computes the PageRank of each document, which it writes to
+ * pageDirectory/.pagerank (see linkgraph.h) for the querier to break
+ * ties with.
+ *
+ * The graph is kept as a sparse matrix, in compressed rows: for each
+ * document, the documents linking to it. Each iteration gives every
+ * document (1 - DAMPING) / n, plus DAMPING times the rank flowing into
+ * it: each document linking to it shares its rank among its links, and
+ * a document with no links shares its rank among all n. Iterations stop
+ * once the ranks change by less than TOLERANCE in total, or after
+ * MAX_ITERATIONS. The ranks sum to 1.
+ *
+ * With -j N, N threads share each iteration, each computing the ranks
+ * of a range of documents chosen so the ranges hold about as many links
+ * as each other; they meet at a barrier between the steps of an
+ * iteration. The ranges are made of whole blocks of BLOCK documents,
+ * and the sums over all documents are added up block by block, in
+ * order, so the ranks come out the same, to the last bit, however many
+ * threads there are.
+ *
+ * Usage: ./pagerank [-j numThreads] pageDirectory
+ *
+ * Exits with:
+ *   0 if normal return
+ *   errno 1 if error parsing arguments: pageDirectory doesn't exist or
+ *     doesn't contain ".crawler", or numThreads < 1
+ *   errno 2 if pageDirectory/.links is missing or damaged, or out of
+ *     memory
+ *   errno 3 if the scores could not be written
+ */
+
+#define _POSIX_C_SOURCE 200809L   // pthread_barrier_t
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+// common.a
+#include "pagedir.h"
+#include "print.h"
+#include "linkgraph.h"
+
+/* Local types */
+typedef struct ranker ranker_t;
+
+/*
+ * The graph, the ranks, and what the threads share
+ */
+typedef struct graph {
+  int numDocs;
+  // documents linking to document v (docID v + 1) are
+  // inFrom[inStart[v]..inStart[v + 1]), and outDegree[u] is how many
+  // document u links to
+  int* inStart;
+  int* inFrom;
+  int* outDegree;
+
+  // rank of each document this iteration, and the next; share[u] is
+  // what document u gives each document it links to
+  double* rank;
+  double* next;
+  double* share;
+
+  // for each block of BLOCK documents, the rank of those with no links,
+  // and how much their ranks changed
+  int numBlocks;
+  double* blockDangling;
+  double* blockChange;
+
+  int numThreads;
+  ranker_t* rankers;
+  pthread_barrier_t barrier;
+  int iterations;
+  bool done;
+} graph_t;
+
+/*
+ * One thread's part of each iteration: documents first..last-1, which
+ * are whole blocks, but for the last block of all
+ */
+typedef struct ranker {
+  graph_t* graph;
+  int id;
+  int first;
+  int last;
+} ranker_t;
+
+/* Local constants */
+static const double DAMPING = 0.85;
+static const double TOLERANCE = 1e-10;
+static const int MAX_ITERATIONS = 100;
+static const int BLOCK = 256;   // documents summed together, in order
+
+/* Private functions */
+static void parseArgs(const int argc, char* argv[], int* numThreads_p,
+                      char** pageDirectory_p);
+static bool str2int(const char* string, int* num_p);
+static graph_t* graphBuild(const linkedge_t* edges, const int numEdges,
+                           const int numDocs);
+static void graphDelete(graph_t* graph);
+static bool rank(graph_t* graph, const int numThreads);
+static void* rankWorker(void* arg);
+
+int main(const int argc, char* argv[])
+{
+  int numThreads = 1;
+  char* pageDirectory = NULL;
+  parseArgs(argc, argv, &numThreads, &pageDirectory);
+
+  int numDocs, numEdges;
+  linkedge_t* edges = linkgraph_load(pageDirectory, &numDocs, &numEdges);
+  if (edges == NULL) {
+    fprintf(stderr, "Pagerank: can't read the link graph in %s; crawl it "
+            "with --links\n", pageDirectory);
+    exit(2);
+  }
+  graph_t* graph = graphBuild(edges, numEdges, numDocs);
+  free(edges);
+  if (graph == NULL || !rank(graph, numThreads)) {
+    printerrln("Pagerank: out of memory");
+    exit(2);
+  }
+  if (!linkgraph_saveScores(pageDirectory, graph->rank, numDocs)) {
+    fprintf(stderr, "Pagerank: failed to write %s/.pagerank\n",
+            pageDirectory);
+    exit(3);
+  }
+  graphDelete(graph);
+  return 0;
+}
+
+/*
+ * Reads a leading -j numThreads, if any, into numThreads_p,
+ * checks 1 input remains after it,
+ * make sure pageDirectory exists and contains ".crawler"
+ * prints error to stderr and exit 1 on invalid argument
+ */
+static void parseArgs(const int argc, char* argv[], int* numThreads_p,
+                      char** pageDirectory_p)
+{
+  int arg = 1;
+  if (arg < argc && strcmp(argv[arg], "-j") == 0) {
+    if (arg + 1 >= argc || !str2int(argv[arg + 1], numThreads_p)
+        || *numThreads_p < 1) {
+      printerrln("Pagerank: -j requires a positive number of threads");
+      exit(1);
+    }
+    arg += 2;
+  }
+  if (argc - arg != 1) {
+    fprintf(stdout, "Usage: %s [-j numThreads] pageDirectory\n", argv[0]);
+    exit(1);
+  }
+
+  *pageDirectory_p = argv[arg];
+  if (!pagedir_isCrawlerDirectory(*pageDirectory_p)) {
+    printerrln("Pagerank: pageDirectory doesn't exist or doesn't contain \".crawler\"");
+    exit(1);
+  }
+}
+
+/*
+ * Converts a string to an int
+ *
+ * Returns:
+ *   true if the whole string is a number, stored in *num_p
+ */
+static bool str2int(const char* string, int* num_p)
+{
+  char extra;
+  return string != NULL && sscanf(string, "%d%c", num_p, &extra) == 1;
+}
+
+/*
+ * Builds the sparse matrix of the link graph, with every document
+ * ranked 1/n to start
+ *
+ * Inputs:
+ *   edges: the links, each docID 1 to numDocs
+ *   numEdges: number of links
+ *   numDocs: number of documents
+ *
+ * Returns:
+ *   the graph, or NULL if out of memory
+ *
+ * Caller needs to call graphDelete() on the returned graph
+ */
+static graph_t* graphBuild(const linkedge_t* edges, const int numEdges,
+                           const int numDocs)
+{
+  graph_t* graph = calloc(1, sizeof(graph_t));
+  if (graph == NULL) {
+    return NULL;
+  }
+  int n = numDocs > 0 ? numDocs : 1;
+  graph->numDocs = numDocs;
+  graph->inStart = calloc(n + 1, sizeof(int));
+  graph->inFrom = malloc(sizeof(int) * (numEdges > 0 ? numEdges : 1));
+  graph->outDegree = calloc(n, sizeof(int));
+  graph->rank = malloc(sizeof(double) * n);
+  graph->next = malloc(sizeof(double) * n);
+  graph->share = malloc(sizeof(double) * n);
+  graph->numBlocks = (n + BLOCK - 1) / BLOCK;
+  graph->blockDangling = malloc(sizeof(double) * graph->numBlocks);
+  graph->blockChange = malloc(sizeof(double) * graph->numBlocks);
+  if (graph->inStart == NULL || graph->inFrom == NULL
+      || graph->outDegree == NULL || graph->rank == NULL
+      || graph->next == NULL || graph->share == NULL
+      || graph->blockDangling == NULL || graph->blockChange == NULL) {
+    graphDelete(graph);
+    return NULL;
+  }
+
+  // count the links into each document, then place each link at the
+  // end of its document's row
+  for (int i = 0; i < numEdges; i++) {
+    graph->inStart[edges[i].to]++;
+    graph->outDegree[edges[i].from - 1]++;
+  }
+  for (int v = 0; v < numDocs; v++) {
+    graph->inStart[v + 1] += graph->inStart[v];
+  }
+  for (int i = 0; i < numEdges; i++) {
+    int v = edges[i].to - 1;
+    graph->inFrom[graph->inStart[v]++] = edges[i].from - 1;
+  }
+  // each row's start has moved to the next row's; move them back
+  for (int v = numDocs; v > 0; v--) {
+    graph->inStart[v] = graph->inStart[v - 1];
+  }
+  graph->inStart[0] = 0;
+
+  for (int v = 0; v < numDocs; v++) {
+    graph->rank[v] = 1.0 / numDocs;
+  }
+  return graph;
+}
+
+/*
+ * Deletes a graph built by graphBuild()
+ */
+static void graphDelete(graph_t* graph)
+{
+  if (graph != NULL) {
+    free(graph->inStart);
+    free(graph->inFrom);
+    free(graph->outDegree);
+    free(graph->rank);
+    free(graph->next);
+    free(graph->share);
+    free(graph->blockDangling);
+    free(graph->blockChange);
+    free(graph->rankers);
+    free(graph);
+  }
+}
+
+/*
+ * Iterates until the ranks settle, with numThreads threads (fewer if
+ * there are fewer documents), leaving the ranks in graph->rank
+ *
+ * Returns:
+ *   false if the threads could not be started
+ */
+static bool rank(graph_t* graph, const int numThreads)
+{
+  int n = graph->numDocs;
+  graph->numThreads = numThreads < n ? numThreads : (n > 0 ? n : 1);
+  graph->rankers = malloc(sizeof(ranker_t) * graph->numThreads);
+  if (graph->rankers == NULL) {
+    return false;
+  }
+
+  // split the documents, a block at a time, so each range holds about
+  // the same number of documents plus links into them
+  long total = n + graph->inStart[n];
+  int v = 0;
+  for (int t = 0; t < graph->numThreads; t++) {
+    ranker_t* ranker = &graph->rankers[t];
+    ranker->graph = graph;
+    ranker->id = t;
+    ranker->first = v;
+    long target = total * (t + 1) / graph->numThreads;
+    while (v < n && v + graph->inStart[v] < target) {
+      v = v + BLOCK < n ? v + BLOCK : n;
+    }
+    if (t == graph->numThreads - 1) {
+      v = n;
+    }
+    ranker->last = v;
+  }
+
+  graph->iterations = 0;
+  graph->done = n == 0;
+  if (graph->done) {
+    return true;
+  }
+  pthread_barrier_init(&graph->barrier, NULL, graph->numThreads);
+  pthread_t threads[graph->numThreads];
+  int started = 1;
+  for (; started < graph->numThreads; started++) {
+    if (pthread_create(&threads[started], NULL, rankWorker,
+                       &graph->rankers[started]) != 0) {
+      // those started would wait at the barrier forever
+      printerrln("Pagerank: error starting threads");
+      exit(2);
+    }
+  }
+  rankWorker(&graph->rankers[0]);
+  for (int t = 1; t < graph->numThreads; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  pthread_barrier_destroy(&graph->barrier);
+  return true;
+}
+
+/*
+ * Body of each thread, the calling one being the first: works out its
+ * range's part of each iteration, in three steps separated by the
+ * barrier. First, what each document gives each of its links, and how
+ * much rank sits in each block's documents with no links; then the new
+ * ranks, from the dangling rank of every block, which each thread adds
+ * up in block order, and so gets the same sum; then the first thread
+ * alone adds up the blocks' changes, also in order, to see whether to
+ * stop.
+ */
+static void* rankWorker(void* arg)
+{
+  ranker_t* ranker = arg;
+  graph_t* graph = ranker->graph;
+  const int n = graph->numDocs;
+  while (true) {
+    for (int b = ranker->first; b < ranker->last; b += BLOCK) {
+      int end = b + BLOCK < ranker->last ? b + BLOCK : ranker->last;
+      double dangling = 0;
+      for (int u = b; u < end; u++) {
+        if (graph->outDegree[u] > 0) {
+          graph->share[u] = graph->rank[u] / graph->outDegree[u];
+        } else {
+          graph->share[u] = 0;
+          dangling += graph->rank[u];
+        }
+      }
+      graph->blockDangling[b / BLOCK] = dangling;
+    }
+    pthread_barrier_wait(&graph->barrier);
+
+    double dangling = 0;
+    for (int i = 0; i < graph->numBlocks; i++) {
+      dangling += graph->blockDangling[i];
+    }
+    double base = (1 - DAMPING) / n + DAMPING * dangling / n;
+    for (int b = ranker->first; b < ranker->last; b += BLOCK) {
+      int end = b + BLOCK < ranker->last ? b + BLOCK : ranker->last;
+      double change = 0;
+      for (int v = b; v < end; v++) {
+        double in = 0;
+        for (int i = graph->inStart[v]; i < graph->inStart[v + 1]; i++) {
+          in += graph->share[graph->inFrom[i]];
+        }
+        graph->next[v] = base + DAMPING * in;
+        change += fabs(graph->next[v] - graph->rank[v]);
+      }
+      graph->blockChange[b / BLOCK] = change;
+    }
+    pthread_barrier_wait(&graph->barrier);
+
+    if (ranker->id == 0) {
+      double change = 0;
+      for (int i = 0; i < graph->numBlocks; i++) {
+        change += graph->blockChange[i];
+      }
+      double* swap = graph->rank;
+      graph->rank = graph->next;
+      graph->next = swap;
+      graph->iterations++;
+      graph->done = change < TOLERANCE
+                    || graph->iterations >= MAX_ITERATIONS;
+    }
+    pthread_barrier_wait(&graph->barrier);
+    if (graph->done) {
+      return NULL;
+    }
+  }
+}
@@ -0,0 +1,31 @@
+#!/bin/bash
+# testing script for pagerank
+
+# -----Invalid arguments-----
+# number of arguments
+./pagerank
+./pagerank arg1 arg2
+
+# non-positive numThreads
+./pagerank -j 0 ../data/letters
+
+# non-crawler pageDirectory
+./pagerank ./
+
+# crawled without --links
+mkdir -p ../data/nolinks
+../crawler/crawler http://cs50tse.cs.dartmouth.edu/tse/letters/ ../data/nolinks 1
+./pagerank ../data/nolinks
+
+
+# -----System tests-----
+lettersDir="../data/letters"
+mkdir -p $lettersDir
+../crawler/crawler --links http://cs50tse.cs.dartmouth.edu/tse/letters/ $lettersDir 10
+./pagerank $lettersDir
+ls -A $lettersDir | grep pagerank
+
+# same scores with 4 threads
+cp $lettersDir/.pagerank ../data/letters.pagerank
+./pagerank -j 4 $lettersDir
+cmp $lettersDir/.pagerank ../data/letters.pagerank && echo "same scores"
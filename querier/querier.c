@@ -8,6 +8,11 @@
  * words are assumed to have an "AND" in between, and adjacent "AND"/"OR"
  * pairs are not allowed
  * 
+ * Documents are ranked by score; if `pagerank pageDirectory` has left
+ * each document's static score in pageDirectory/.pagerank, documents
+ * with the same score are ranked by it, highest first, and otherwise by
+ * docID.
+ * 
  * Usage: ./querier pageDirectory indexFilename
  * 
  * Exits with:
@@ -33,18 +38,29 @@
 #include "index.h"
 #include "word.h"
 #include "pagedir.h"
+#include "linkgraph.h"
 
 /* Local types */
 typedef struct queryResult {
   // score corresponds to the count items in a counter
   int docID, score;
+  // the document's static score, 0 if none
+  double rank;
 } queryResult_t;
 
+// static scores of docIDs 1 to numDocs, from pageDirectory/.pagerank
+typedef struct staticScores {
+  double* scores;   // NULL if none
+  int numDocs;
+} staticScores_t;
+
 typedef struct queryResArr {
   // internal array of queryResult_t*
   queryResult_t** arr;
   // next pos to insert at
   int pos;
+  // where each result's rank comes from
+  const staticScores_t* ranks;
 } queryResArr_t;
 
 typedef struct counterPair {
@@ -54,17 +70,20 @@ typedef struct counterPair {
 
 /* Private functions */
 int fileno(FILE* stream);
-static index_t* parseArgs(const int argc, char* argv[], char** pageDirectory_p);
+static index_t* parseArgs(const int argc, char* argv[], char** pageDirectory_p,
+                          staticScores_t* ranks);
 static void queryResArr_delete(queryResArr_t* resArr);
 
 // processing queries
 static void prompt();
-static void processQuery(const index_t* idx, char* query, const char* pageDirectory);
+static void processQuery(const index_t* idx, char* query, const char* pageDirectory,
+                         const staticScores_t* ranks);
 static bool isValidQuery(char* query);
 static bool isAndOr(char* word);
 
 // processing results
-static queryResArr_t* getSortedResults(counters_t* res);
+static queryResArr_t* getSortedResults(counters_t* res,
+                                       const staticScores_t* ranks);
 static void getCounterSize(void* arg, const int key, const int count);
 static void addIntoArray(void* arg, const int key, const int count);
 static int compareQueryResult(const void* a, const void* b);
@@ -85,17 +104,19 @@ int main(const int argc, char* argv[])
 {
   // parse arguments
   char* pageDirectory = NULL;
-  index_t* idx = parseArgs(argc, argv, &pageDirectory);
+  staticScores_t ranks;
+  index_t* idx = parseArgs(argc, argv, &pageDirectory, &ranks);
   
   // answer queries until EOF
   prompt();
   char* query;
   while ((query = file_readLine(stdin)) != NULL) {
-    processQuery(idx, query, pageDirectory);
+    processQuery(idx, query, pageDirectory, &ranks);
     prompt();
     free(query);
   }
   index_delete(idx);
+  free(ranks.scores);
   return 0;
 }
 
@@ -104,13 +125,15 @@ int main(const int argc, char* argv[])
  * makes sure pageDirectory exists and contains ".crawler"
  * checks indexFilename is readable file, and tries to
  * build an index from it.
+ * reads the static scores in pageDirectory into ranks, if there are any
  * 
  * prints error to stderr and exit 1 on invalid argument
 
  * Returns:
  *   the index built from the file at indexFilename
  */
-static index_t* parseArgs(const int argc, char* argv[], char** pageDirectory_p)
+static index_t* parseArgs(const int argc, char* argv[], char** pageDirectory_p,
+                          staticScores_t* ranks)
 {
   if (argc != 3) {
     fprintf(stdout, "Usage: %s pageDirectory indexFilename\n", argv[0]);
@@ -136,6 +159,10 @@ static index_t* parseArgs(const int argc, char* argv[], char** pageDirectory_p)
   if (idx == NULL) {
     fprintf(stderr, "Querier: failed to build index from %s", indexFilename);
   }
+
+  // static scores are optional
+  ranks->numDocs = 0;
+  ranks->scores = linkgraph_loadScores(*pageDirectory_p, &ranks->numDocs);
   return idx;
 }
 
@@ -156,8 +183,10 @@ void prompt()
  * Inputs:
  *   idx: index of words in `pageDirectory`
  *   query to process
+ *   ranks: static scores to break ties with
  */
-void processQuery(const index_t* idx, char* query, const char* pageDirectory)
+void processQuery(const index_t* idx, char* query, const char* pageDirectory,
+                  const staticScores_t* ranks)
 {
   stripCompactNormalize(query);
   printf("Query: %s\n", query); // echo pre-processed query
@@ -214,7 +243,7 @@ void processQuery(const index_t* idx, char* query, const char* pageDirectory)
     unionCounters(temp, res);
   }
 
-  queryResArr_t* resArr = getSortedResults(res);
+  queryResArr_t* resArr = getSortedResults(res, ranks);
   if (resArr == NULL) {
     return;
   }
@@ -285,10 +314,10 @@ bool isAndOr(char* word)
 
 /*
  * Turn a counter into a queryResArr, containing queryResults sorted
- * by decreasing score
+ * by decreasing score, then decreasing static score from ranks
  * 
  */
-queryResArr_t* getSortedResults(counters_t* res)
+queryResArr_t* getSortedResults(counters_t* res, const staticScores_t* ranks)
 {
   int size = 0;
   counters_iterate(res, &size, getCounterSize);
@@ -302,12 +331,13 @@ queryResArr_t* getSortedResults(counters_t* res)
     return NULL;
   }
   resArr->pos = 0;
+  resArr->ranks = ranks;
 
   // add (docID, score) pairs from res into resArr
   counters_iterate(res, resArr, addIntoArray);
 
   // sort the array in resArr
-  qsort(resArr->arr, size, sizeof(queryResult_t), compareQueryResult);
+  qsort(resArr->arr, size, sizeof(queryResult_t*), compareQueryResult);
   return resArr;
 }
 
@@ -324,22 +354,32 @@ void addIntoArray(void* arg, const int key, const int count)
   if (queryRes == NULL) {
     return;
   }
+  queryResArr_t* resArr = arg;
+  const staticScores_t* ranks = resArr->ranks;
   queryRes->docID = key;
   queryRes->score = count;
+  queryRes->rank = (ranks->scores != NULL && key <= ranks->numDocs)
+                   ? ranks->scores[key - 1] : 0;
 
   // insert queryResult into queryResArr
-  queryResArr_t* resArr = arg;
   resArr->arr[resArr->pos++] = queryRes;
 }
 
 /*
- * Helper function to sort queryResults in decreasing score order
+ * Helper function to sort queryResults in decreasing score order; ties
+ * go to the higher static score, then the lower docID
  */
 int compareQueryResult(const void* a, const void* b)
 {
   queryResult_t* ptrA = *(queryResult_t**) a;
   queryResult_t* ptrB = *(queryResult_t**) b;
-  return ptrB->score - ptrA->score;
+  if (ptrA->score != ptrB->score) {
+    return ptrB->score - ptrA->score;
+  }
+  if (ptrA->rank != ptrB->rank) {
+    return ptrA->rank < ptrB->rank ? 1 : -1;
+  }
+  return ptrA->docID - ptrB->docID;
 }
 
 void outputQueryResults(const queryResArr_t* resArr, const char* pageDirectory)
@@ -41,6 +41,13 @@ echo $letters2
 echo $toscrape2
 echo $wikipedia2
 
+# letters crawled with --links and ranked, so equal scores go by rank
+lettersDir="../data/letters"
+../crawler/crawler --links http://cs50tse.cs.dartmouth.edu/tse/letters/ $lettersDir 10
+../indexer/indexer $lettersDir $lettersDir.index
+../pagerank/pagerank $lettersDir
+echo "page" | ./querier $lettersDir $lettersDir.index
+
 # tests below have long output
 $myvalgrind ./fuzzquery "${letters2}.index" 10 0 | ./querier $letters2 "${letters2}.index"
 $myvalgrind ./fuzzquery "${toscrape2}.index" 10 0 | ./querier $toscrape2 "${toscrape2}.index"